@@ -0,0 +1,473 @@
+﻿#include "resamcpp.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#    else
+#        include <x86intrin.h>
+#    endif
+#    define RESAMCPP_BENCH_RDTSC
+#endif
+
+namespace
+{
+    using namespace resamcpp;
+
+    struct Ratio
+    {
+        u32 src_;
+        u32 dst_;
+    };
+
+    const Ratio Ratios[] = {
+        {8000, 48000},
+        {44100, 48000},
+        {48000, 44100},
+        {96000, 44100},
+        {24000, 48000},
+        {48000, 24000},
+    };
+
+    //--- Ratios whose polyphase bank would be too large, the filter is interpolated for each output or its phases are quantized
+    const Ratio InterpolatedRatios[] = {
+        {44100, 44101},
+        {44100, 47999},
+    };
+
+    const u32 PhaseBits[] = {0, 12, 16}; //!< zero is the exact interpolation
+
+    //--- Large downsampling ratios, resampled directly and through a cascade of half-band stages
+    const Ratio CascadeRatios[] = {
+        {192000, 8000},
+        {192000, 44100},
+        {48000, 8000},
+    };
+
+    //--- Many mono streams in 10 ms blocks, like a conferencing server
+    const Ratio EngineRatios[] = {
+        {16000, 48000},
+        {48000, 16000},
+    };
+
+    const u32 EngineStreams = 2000;
+
+    //--- Sound effects of mixed rates from 0.2 s to 3 s, which are converted to 48 kHz one by one or in a batch
+    const u32 ClipRates[] = {22050, 32000, 44100, 48000, 96000};
+    const u32 Clips = 100;
+
+    const Resampler::Quality Qualities[] = {
+        Resampler::Quality::Fast,
+        Resampler::Quality::Best,
+    };
+
+    const u32 Channels[] = {1, 2, 6};
+
+    //--- Input frames per call, zero means the whole signal in one Resampler::run
+    const u32 BufferSizes[] = {256, 4096, 0};
+
+    const u32 SignalSeconds = 1;
+
+    struct Options
+    {
+        f64 minTime_;
+        const char* filter_;
+    };
+
+    struct Result
+    {
+        u64 iterations_;
+        f64 seconds_;
+        u64 cycles_;
+    };
+
+    u64 read_cycles()
+    {
+#ifdef RESAMCPP_BENCH_RDTSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    /**
+    @brief A few sines with a little of noise, which is not silent in any band
+    */
+    void make_signal(std::vector<s16>& signal, u32 frequency, u32 channels, u32 frames)
+    {
+        signal.resize(static_cast<size_t>(frames) * channels);
+        u32 noise = 0x12345678U;
+        const f64 pi = 3.14159265358979323846;
+        for(u32 i = 0; i < frames; ++i) {
+            f64 t = static_cast<f64>(i) / frequency;
+            for(u32 k = 0; k < channels; ++k) {
+                noise = noise * 1664525U + 1013904223U;
+                f64 x = 0.4 * sin(2.0 * pi * (440.0 + 110.0 * k) * t)
+                        + 0.2 * sin(2.0 * pi * 3520.0 * t)
+                        + 0.05 * (static_cast<f64>(noise >> 8) / 16777216.0 - 0.5);
+                signal[static_cast<size_t>(i) * channels + k] = static_cast<s16>(x * 32767.0);
+            }
+        }
+    }
+
+    u64 run_once(const Resampler& resampler, Stream& stream, u32 channels, u32 bufferSize, std::vector<s16>& dst, const std::vector<s16>& src)
+    {
+        u32 srcFrames = static_cast<u32>(src.size() / channels);
+        if(bufferSize <= 0) {
+            u32 dstFrames = static_cast<u32>(dst.size() / channels);
+            return resampler.run(channels, dstFrames, dst.data(), srcFrames, src.data());
+        }
+        stream.reset();
+        u32 dstCapacity = static_cast<u32>(dst.size() / channels);
+        u64 produced = 0;
+        for(u32 i = 0; i < srcFrames; i += bufferSize) {
+            u32 frames = (srcFrames - i < bufferSize) ? srcFrames - i : bufferSize;
+            produced += stream.process(src.data() + static_cast<size_t>(i) * channels, frames, dst.data(), dstCapacity);
+        }
+        produced += stream.flush(dst.data(), dstCapacity);
+        return produced;
+    }
+
+    template<class T>
+    Result measure(const Options& options, T run)
+    {
+        // Warm up the caches and the branch predictors
+        run();
+
+        Result result = {};
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        u64 cycles = read_cycles();
+        do {
+            run();
+            ++result.iterations_;
+            result.seconds_ = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+        } while(result.seconds_ < options.minTime_);
+        result.cycles_ = read_cycles() - cycles;
+        return result;
+    }
+
+    void print_result(const char* name, const Result& result, u64 dstFrames, u32 channels, f64 window)
+    {
+        f64 frames = static_cast<f64>(dstFrames) * result.iterations_;
+        f64 samples = frames * channels;
+        f64 taps = samples * window;
+        printf("%-36s %10.3f %12llu %14.4g %10.2f", name,
+               result.seconds_ * 1000.0 / result.iterations_,
+               static_cast<unsigned long long>(result.iterations_),
+               samples / result.seconds_,
+               result.seconds_ * 1.0e9 / frames);
+#ifdef RESAMCPP_BENCH_RDTSC
+        printf(" %10.3f\n", result.cycles_ / taps);
+#else
+        (void)taps;
+        printf(" %10s\n", "-");
+#endif
+    }
+
+    void print_usage()
+    {
+        printf("usage: resamcpp_bench [--min_time=<seconds>] [--filter=<substring>]\n");
+    }
+
+    bool parse(Options& options, int argc, char** argv)
+    {
+        options.minTime_ = 0.2;
+        options.filter_ = RESAMCPP_NULL;
+        for(int i = 1; i < argc; ++i) {
+            if(0 == strncmp(argv[i], "--min_time=", 11)) {
+                options.minTime_ = atof(argv[i] + 11);
+            } else if(0 == strncmp(argv[i], "--filter=", 9)) {
+                options.filter_ = argv[i] + 9;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parse(options, argc, argv)) {
+        print_usage();
+        return 1;
+    }
+    printf("kernel: %s\n", Resampler::kernel_name(Resampler::supported_kernel()));
+#ifndef RESAMCPP_BENCH_RDTSC
+    printf("cycles are not available on this CPU\n");
+#endif
+    printf("%-36s %10s %12s %14s %10s %10s\n", "Benchmark", "Time(ms)", "Iterations", "Samples/s", "ns/frame", "cycles/tap");
+    printf("----------------------------------------------------------------------------------------------------\n");
+
+    std::vector<s16> src;
+    std::vector<s16> dst;
+    for(const Ratio& ratio: Ratios) {
+        for(Resampler::Quality quality: Qualities) {
+            Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, quality);
+            for(u32 channels: Channels) {
+                make_signal(src, ratio.src_, channels, ratio.src_ * SignalSeconds);
+                u64 dstFrames = resampler.output_frames(ratio.src_ * SignalSeconds);
+                dst.resize(static_cast<size_t>(dstFrames) * channels);
+                Stream stream = Stream::initialize(resampler, channels);
+
+                for(u32 bufferSize: BufferSizes) {
+                    char name[64];
+                    char buffer[16];
+                    if(0 < bufferSize) {
+                        snprintf(buffer, sizeof(buffer), "%u", bufferSize);
+                    } else {
+                        snprintf(buffer, sizeof(buffer), "all");
+                    }
+                    snprintf(name, sizeof(name), "%u->%u/%s/%uch/%s",
+                             ratio.src_, ratio.dst_,
+                             Resampler::Quality::Fast == quality ? "fast" : "best",
+                             channels, buffer);
+                    if(RESAMCPP_NULL != options.filter_ && RESAMCPP_NULL == strstr(name, options.filter_)) {
+                        continue;
+                    }
+                    if(0 < bufferSize && !stream.valid()) {
+                        continue;
+                    }
+
+                    Result result = measure(options, [&]() {
+                        run_once(resampler, stream, channels, bufferSize, dst, src);
+                    });
+                    print_result(name, result, dstFrames, channels, resampler.window());
+                }
+            }
+        }
+    }
+
+    // s16 to s16 with f32 weights, with Q15 weights and with the ISPC kernel
+    for(const Ratio& ratio: Ratios) {
+        for(Resampler::Quality quality: Qualities) {
+            Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, quality);
+            for(u32 channels: Channels) {
+                make_signal(src, ratio.src_, channels, ratio.src_ * SignalSeconds);
+                u64 dstFrames = resampler.output_frames(ratio.src_ * SignalSeconds);
+                dst.resize(static_cast<size_t>(dstFrames) * channels);
+                const char* methods[] = {"f32", "q15", "ispc"};
+                for(const char* method: methods) {
+                    char name[64];
+                    snprintf(name, sizeof(name), "%u->%u/%s/%uch/%s",
+                             ratio.src_, ratio.dst_,
+                             Resampler::Quality::Fast == quality ? "fast" : "best",
+                             channels, method);
+                    if(RESAMCPP_NULL != options.filter_ && RESAMCPP_NULL == strstr(name, options.filter_)) {
+                        continue;
+                    }
+                    if(!resampler.set_fixed_point(method == methods[1])) {
+                        continue;
+                    }
+                    u32 srcFrames = static_cast<u32>(src.size() / channels);
+                    Result result = measure(options, [&]() {
+                        if(method == methods[2]) {
+                            resampler.run_ispc(channels, static_cast<u32>(dstFrames), dst.data(), srcFrames, src.data());
+                        } else {
+                            resampler.run(channels, static_cast<u32>(dstFrames), dst.data(), srcFrames, src.data());
+                        }
+                    });
+                    print_result(name, result, dstFrames, channels, resampler.window());
+                }
+                resampler.set_fixed_point(false);
+            }
+        }
+    }
+
+    for(const Ratio& ratio: InterpolatedRatios) {
+        for(Resampler::Quality quality: Qualities) {
+            Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, quality);
+            for(u32 channels: Channels) {
+                make_signal(src, ratio.src_, channels, ratio.src_ * SignalSeconds);
+                u64 dstFrames = resampler.output_frames(ratio.src_ * SignalSeconds);
+                dst.resize(static_cast<size_t>(dstFrames) * channels);
+                for(u32 bits: PhaseBits) {
+                    char name[64];
+                    snprintf(name, sizeof(name), "%u->%u/%s/%uch/phase%u",
+                             ratio.src_, ratio.dst_,
+                             Resampler::Quality::Fast == quality ? "fast" : "best",
+                             channels, bits);
+                    if(RESAMCPP_NULL != options.filter_ && RESAMCPP_NULL == strstr(name, options.filter_)) {
+                        continue;
+                    }
+                    if(!resampler.set_phase_bits(bits)) {
+                        continue;
+                    }
+                    u32 srcFrames = static_cast<u32>(src.size() / channels);
+                    Result result = measure(options, [&]() {
+                        resampler.run(channels, static_cast<u32>(dstFrames), dst.data(), srcFrames, src.data());
+                    });
+                    print_result(name, result, dstFrames, channels, resampler.window());
+                }
+                resampler.set_phase_bits(0);
+            }
+        }
+    }
+
+    for(const Ratio& ratio: CascadeRatios) {
+        for(Resampler::Quality quality: Qualities) {
+            Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, quality);
+            Cascade cascade = Cascade::initialize(ratio.src_, ratio.dst_, quality);
+            // The taps per output frame, half-band stages run at higher frequencies
+            f64 window = cascade.resampler().window();
+            for(u32 s = 0; s < cascade.stages(); ++s) {
+                window += static_cast<f64>(cascade.taps(s)) * ratio.src_ / (static_cast<f64>(ratio.dst_) * (2U << s));
+            }
+            for(u32 channels: Channels) {
+                make_signal(src, ratio.src_, channels, ratio.src_ * SignalSeconds);
+                u64 dstFrames = cascade.output_frames(ratio.src_ * SignalSeconds);
+                dst.resize(static_cast<size_t>(dstFrames) * channels);
+                const char* methods[] = {"direct", "cascade"};
+                for(const char* method: methods) {
+                    char name[64];
+                    snprintf(name, sizeof(name), "%u->%u/%s/%uch/%s",
+                             ratio.src_, ratio.dst_,
+                             Resampler::Quality::Fast == quality ? "fast" : "best",
+                             channels, method);
+                    if(RESAMCPP_NULL != options.filter_ && RESAMCPP_NULL == strstr(name, options.filter_)) {
+                        continue;
+                    }
+                    u32 srcFrames = static_cast<u32>(src.size() / channels);
+                    Result result;
+                    if(method == methods[0]) {
+                        // Ratios below 1/oversample are not supported by a single stage
+                        if(resampler.window() <= 0) {
+                            continue;
+                        }
+                        u32 frames = static_cast<u32>(resampler.output_frames(srcFrames));
+                        result = measure(options, [&]() {
+                            resampler.run(channels, frames, dst.data(), srcFrames, src.data());
+                        });
+                        print_result(name, result, frames, channels, resampler.window());
+                    } else {
+                        result = measure(options, [&]() {
+                            cascade.run(channels, static_cast<u32>(dstFrames), dst.data(), srcFrames, src.data());
+                        });
+                        print_result(name, result, dstFrames, channels, window);
+                    }
+                }
+            }
+        }
+    }
+
+    for(const Ratio& ratio: EngineRatios) {
+        for(Resampler::Quality quality: Qualities) {
+            Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, quality);
+            // Every stream reads the same signal, but has its own history and output
+            u32 block = ratio.src_ / 100;
+            u32 srcFrames = ratio.src_ * SignalSeconds;
+            make_signal(src, ratio.src_, 1, srcFrames);
+            u32 dstCapacity = static_cast<u32>(static_cast<u64>(block) * ratio.dst_ / ratio.src_) + 1;
+            u64 dstFrames = resampler.output_frames(srcFrames);
+            const char* methods[] = {"stream", "engine"};
+            for(const char* method: methods) {
+                char name[64];
+                snprintf(name, sizeof(name), "%u->%u/%s/%ux1ch/%s",
+                         ratio.src_, ratio.dst_,
+                         Resampler::Quality::Fast == quality ? "fast" : "best",
+                         EngineStreams, method);
+                if(RESAMCPP_NULL != options.filter_ && RESAMCPP_NULL == strstr(name, options.filter_)) {
+                    continue;
+                }
+                Result result;
+                if(method == methods[0]) {
+                    std::vector<Stream> streams(EngineStreams);
+                    for(Stream& stream: streams) {
+                        stream = Stream::initialize(resampler, 1);
+                    }
+                    dst.resize(static_cast<size_t>(dstCapacity) * EngineStreams);
+                    result = measure(options, [&]() {
+                        for(u32 i = 0; i < srcFrames; i += block) {
+                            for(u32 k = 0; k < EngineStreams; ++k) {
+                                streams[k].process(src.data() + i, block, dst.data() + static_cast<size_t>(k) * dstCapacity, dstCapacity);
+                            }
+                        }
+                    });
+                    print_result(name, result, dstFrames, EngineStreams, resampler.window());
+                } else {
+                    StreamEngine engine;
+                    for(u32 k = 0; k < EngineStreams; ++k) {
+                        engine.join(ratio.src_, ratio.dst_, quality);
+                    }
+                    dst.resize(static_cast<size_t>(dstCapacity) * engine.capacity());
+                    std::vector<const s16*> inputs(engine.capacity());
+                    std::vector<s16*> outputs(engine.capacity());
+                    std::vector<u32> frames(engine.capacity());
+                    for(u32 k = 0; k < engine.capacity(); ++k) {
+                        outputs[k] = dst.data() + static_cast<size_t>(k) * dstCapacity;
+                    }
+                    result = measure(options, [&]() {
+                        for(u32 i = 0; i < srcFrames; i += block) {
+                            for(const s16*& input: inputs) {
+                                input = src.data() + i;
+                            }
+                            engine.process(block, inputs.data(), outputs.data(), dstCapacity, frames.data());
+                        }
+                    });
+                    print_result(name, result, dstFrames, EngineStreams, resampler.window());
+                    // The throughput of the first batch, including the warm up
+                    StreamEngine::Statistics statistics;
+                    engine.statistics(statistics, 0);
+                    printf("  %u batches, batch 0: %u streams, %.4g samples/s\n",
+                           engine.batches(), statistics.streams_, statistics.samples_ / statistics.seconds_);
+                }
+            }
+        }
+    }
+
+    for(Resampler::Quality quality: Qualities) {
+        std::vector<BatchJob<s16, s16>> jobs(Clips);
+        std::vector<std::vector<s16>> clips(Clips);
+        u32 seed = 1;
+        u64 samples = 0;
+        f64 taps = 0.0;
+        for(u32 i = 0; i < Clips; ++i) {
+            BatchJob<s16, s16>& job = jobs[i];
+            seed = seed * 1664525U + 1013904223U;
+            job.srcFrequency_ = ClipRates[(seed >> 12) % (sizeof(ClipRates) / sizeof(ClipRates[0]))];
+            job.dstFrequency_ = 48000;
+            job.channels_ = 1 + (seed >> 20) % 2;
+            job.srcFrames_ = static_cast<u32>(job.srcFrequency_ * (0.2 + 2.8 * ((seed >> 8) % 1000) / 1000.0));
+            make_signal(clips[i], job.srcFrequency_, job.channels_, job.srcFrames_);
+            job.src_ = clips[i].data();
+            Resampler resampler = Resampler::initialize(job.srcFrequency_, job.dstFrequency_, quality);
+            u64 clipSamples = resampler.output_frames(job.srcFrames_) * job.channels_;
+            samples += clipSamples;
+            taps += static_cast<f64>(clipSamples) * resampler.window();
+        }
+        dst.resize(BatchResampler::arena_samples(Clips, jobs.data()));
+        const char* methods[] = {"each", "batch"};
+        for(const char* method: methods) {
+            char name[64];
+            snprintf(name, sizeof(name), "clips/%s/%uclips/%s",
+                     Resampler::Quality::Fast == quality ? "fast" : "best",
+                     Clips, method);
+            if(RESAMCPP_NULL != options.filter_ && RESAMCPP_NULL == strstr(name, options.filter_)) {
+                continue;
+            }
+            // Both set up their resamplers in every iteration, like a pipeline run
+            Result result = measure(options, [&]() {
+                if(method == methods[0]) {
+                    s16* output = dst.data();
+                    for(const BatchJob<s16, s16>& job: jobs) {
+                        Resampler resampler = Resampler::initialize(job.srcFrequency_, job.dstFrequency_, quality);
+                        u32 frames = static_cast<u32>(resampler.output_frames(job.srcFrames_));
+                        resampler.run(job.channels_, frames, output, job.srcFrames_, job.src_);
+                        output += static_cast<size_t>(frames) * job.channels_;
+                    }
+                } else {
+                    BatchResampler batch = BatchResampler::initialize(quality);
+                    batch.run(Clips, jobs.data(), dst.size(), dst.data());
+                }
+            });
+            print_result(name, result, samples, 1, taps / static_cast<f64>(samples));
+        }
+    }
+    return 0;
+}
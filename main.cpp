@@ -1,41 +1,366 @@
 ﻿#include "resamcpp.h"
-#include <cstdlib>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
 
-int main(void)
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#else
+#    include <dirent.h>
+#    include <sys/stat.h>
+#endif
+
+namespace
 {
-    resamcpp::WAVE wave = resamcpp::load("AirOnTheGString.wav");
+    using namespace resamcpp;
+
+    typedef std::chrono::steady_clock Clock;
+
+    enum Stage
+    {
+        Stage_Read,
+        Stage_Resample,
+        Stage_Write,
+        Stage_Max,
+    };
+
+    const char* StageNames[Stage_Max] = {"read", "resample", "write"};
+
+    struct Options
+    {
+        u32 frequency_;
+        Resampler::Quality quality_;
+        u32 bitsPerSample_; //!< zero keeps the one of each input
+        u32 jobs_;
+        std::string output_;
+        std::vector<std::string> files_;
+    };
+
+    struct Statistics
+    {
+        u64 files_;
+        u64 failures_;
+        u64 srcFrames_;
+        u64 dstFrames_;
+        f64 seconds_[Stage_Max];
+    };
+
+    /**
+    @brief The state of a worker, resamplers per source frequency and buffers are reused across files
+    */
+    struct Worker
+    {
+        struct Entry
+        {
+            u32 frequency_;
+            Cascade cascade_;
+        };
+
+        std::vector<Entry> cascades_;
+        std::vector<u8> src_;
+        std::vector<u8> dst_;
+        Statistics statistics_;
+    };
+
+    f64 seconds(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<f64>(end - start).count();
+    }
+
+    bool is_wave(const char* name)
+    {
+        size_t length = strlen(name);
+        if(length < 4) {
+            return false;
+        }
+        const char* extension = name + length - 4;
+        return '.' == extension[0]
+               && ('w' == extension[1] || 'W' == extension[1])
+               && ('a' == extension[2] || 'A' == extension[2])
+               && ('v' == extension[3] || 'V' == extension[3]);
+    }
+
+    /**
+    @brief Append the .wav files of a directory, or the path itself if it is not a directory
+    */
+    void add_path(std::vector<std::string>& files, const char* path)
+    {
+#ifdef _WIN32
+        DWORD attributes = GetFileAttributesA(path);
+        if(INVALID_FILE_ATTRIBUTES == attributes || 0 == (attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            files.push_back(path);
+            return;
+        }
+        std::string pattern = std::string(path) + "\\*";
+        WIN32_FIND_DATAA data;
+        HANDLE find = FindFirstFileA(pattern.c_str(), &data);
+        if(INVALID_HANDLE_VALUE == find) {
+            return;
+        }
+        do {
+            if(0 == (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && is_wave(data.cFileName)) {
+                files.push_back(std::string(path) + "\\" + data.cFileName);
+            }
+        } while(FindNextFileA(find, &data));
+        FindClose(find);
+#else
+        struct stat status;
+        if(0 != stat(path, &status) || !S_ISDIR(status.st_mode)) {
+            files.push_back(path);
+            return;
+        }
+        DIR* directory = opendir(path);
+        if(RESAMCPP_NULL == directory) {
+            return;
+        }
+        while(struct dirent* entry = readdir(directory)) {
+            if(is_wave(entry->d_name)) {
+                files.push_back(std::string(path) + "/" + entry->d_name);
+            }
+        }
+        closedir(directory);
+#endif
+    }
+
+    /**
+    @brief Append the paths of a list file, one per line
+    */
+    bool add_list(std::vector<std::string>& files, const char* filepath)
+    {
+        FILE* file = fopen(filepath, "rb");
+        if(RESAMCPP_NULL == file) {
+            return false;
+        }
+        char line[4096];
+        while(RESAMCPP_NULL != fgets(line, sizeof(line), file)) {
+            size_t length = strcspn(line, "\r\n");
+            line[length] = '\0';
+            if(0 < length) {
+                add_path(files, line);
+            }
+        }
+        fclose(file);
+        return true;
+    }
+
+    std::string get_output_path(const std::string& directory, const std::string& path)
+    {
+        size_t separator = path.find_last_of("/\\");
+        std::string name = (std::string::npos == separator) ? path : path.substr(separator + 1);
+        return directory + "/" + name;
+    }
 
-    resamcpp::WAVE wave2 = wave;
+    Cascade& get_cascade(Worker& worker, const Options& options, u32 frequency)
     {
-        wave2.format_.frequency_ = static_cast<resamcpp::u32>(44100*2.0);//48000;
-        wave2.format_.bytesPerSec_ = wave2.format_.frequency_ * wave2.format_.blockAlign_;
+        for(Worker::Entry& entry: worker.cascades_) {
+            if(entry.frequency_ == frequency) {
+                return entry.cascade_;
+            }
+        }
+        worker.cascades_.push_back({frequency, Cascade::initialize(frequency, options.frequency_, options.quality_)});
+        return worker.cascades_.back().cascade_;
+    }
+
+    template<class Dst, class Src>
+    u32 run(Cascade& cascade, u32 channels, u32 dstFrames, u8* dst, u32 srcFrames, const u8* src)
+    {
+        return cascade.run(channels, dstFrames, reinterpret_cast<Dst*>(dst), srcFrames, reinterpret_cast<const Src*>(src));
+    }
 
-        resamcpp::u64 numSamples = static_cast<resamcpp::u64>(static_cast<resamcpp::f64>(wave2.format_.frequency_) / wave.format_.frequency_ * wave.numSamples_);
+    template<class Dst>
+    u32 run(Cascade& cascade, u32 srcBits, u32 channels, u32 dstFrames, u8* dst, u32 srcFrames, const u8* src)
+    {
+        switch(srcBits) {
+        case 8:
+            return run<Dst, u8>(cascade, channels, dstFrames, dst, srcFrames, src);
+        case 16:
+            return run<Dst, s16>(cascade, channels, dstFrames, dst, srcFrames, src);
+        case 24:
+            return run<Dst, s24>(cascade, channels, dstFrames, dst, srcFrames, src);
+        default:
+            return run<Dst, s32>(cascade, channels, dstFrames, dst, srcFrames, src);
+        }
+    }
 
-        wave2.numSamples_ = numSamples;
-        wave2.data_ = reinterpret_cast<resamcpp::u8*>(::malloc(numSamples * wave2.format_.blockAlign_));
+    u32 run(Cascade& cascade, u32 dstBits, u32 srcBits, u32 channels, u32 dstFrames, u8* dst, u32 srcFrames, const u8* src)
+    {
+        switch(dstBits) {
+        case 8:
+            return run<u8>(cascade, srcBits, channels, dstFrames, dst, srcFrames, src);
+        case 16:
+            return run<s16>(cascade, srcBits, channels, dstFrames, dst, srcFrames, src);
+        case 24:
+            return run<s24>(cascade, srcBits, channels, dstFrames, dst, srcFrames, src);
+        default:
+            return run<s32>(cascade, srcBits, channels, dstFrames, dst, srcFrames, src);
+        }
     }
 
-    std::chrono::high_resolution_clock::time_point start;
-    std::chrono::high_resolution_clock::duration duration;
-    resamcpp::Resampler resampler = resamcpp::Resampler::initialize(wave.format_.frequency_, wave2.format_.frequency_);
-    //
-    start = std::chrono::high_resolution_clock::now();
-    resampler.run(wave2.format_.channels_, static_cast<resamcpp::u32>(wave2.numSamples_), reinterpret_cast<resamcpp::s16*>(wave2.data_), static_cast<resamcpp::u32>(wave.numSamples_), reinterpret_cast<resamcpp::s16*>(wave.data_));
-    duration = std::chrono::high_resolution_clock::now() - start;
-    std::cout << "samples: " << wave.numSamples_ << ", microsec: " << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << std::endl;
-    resamcpp::save("music00_1.wav", wave2);
+    bool convert(Worker& worker, const Options& options, const std::string& path)
+    {
+        Statistics& statistics = worker.statistics_;
+        Clock::time_point start = Clock::now();
+        WaveReader reader = WaveReader::initialize(path.c_str());
+        if(!reader.valid() || 0xFFFFFFFFULL < reader.frames()) {
+            return false;
+        }
+        const FMT& srcFormat = reader.format();
+        u32 srcFrames = static_cast<u32>(reader.frames());
+        worker.src_.resize(static_cast<size_t>(srcFrames) * srcFormat.blockAlign_);
+        for(u32 frames = 0; frames < srcFrames;) {
+            u32 read = reader.read(worker.src_.data() + static_cast<size_t>(frames) * srcFormat.blockAlign_, srcFrames - frames);
+            if(read <= 0) {
+                return false;
+            }
+            frames += read;
+        }
+        Clock::time_point read = Clock::now();
 
-    //
-    start = std::chrono::high_resolution_clock::now();
-    resampler.run_ispc(wave2.format_.channels_, static_cast<resamcpp::u32>(wave2.numSamples_), reinterpret_cast<resamcpp::s16*>(wave2.data_), static_cast<resamcpp::u32>(wave.numSamples_), reinterpret_cast<resamcpp::s16*>(wave.data_));
-    duration = std::chrono::high_resolution_clock::now() - start;
-    std::cout << "samples: " << wave.numSamples_ << ", microsec: " << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << std::endl;
-    resamcpp::save("music00_2.wav", wave2);
+        Cascade& cascade = get_cascade(worker, options, srcFormat.frequency_);
+        if(!cascade.valid() || 0xFFFFFFFFULL < cascade.output_frames(srcFrames)) {
+            return false;
+        }
+        FMT dstFormat = srcFormat;
+        dstFormat.frequency_ = options.frequency_;
+        if(0 < options.bitsPerSample_) {
+            dstFormat.bitsPerSample_ = static_cast<u16>(options.bitsPerSample_);
+        }
+        dstFormat.blockAlign_ = static_cast<u16>(dstFormat.channels_ * (dstFormat.bitsPerSample_ / 8));
+        dstFormat.bytesPerSec_ = dstFormat.frequency_ * dstFormat.blockAlign_;
+        u32 dstFrames = static_cast<u32>(cascade.output_frames(srcFrames));
+        worker.dst_.resize(static_cast<size_t>(dstFrames) * dstFormat.blockAlign_);
+        run(cascade, dstFormat.bitsPerSample_, srcFormat.bitsPerSample_, srcFormat.channels_, dstFrames, worker.dst_.data(), srcFrames, worker.src_.data());
+        Clock::time_point resampled = Clock::now();
 
-    resamcpp::destroy(wave2);
-    resamcpp::destroy(wave);
-    return 0;
+        WaveWriter writer = WaveWriter::initialize(get_output_path(options.output_, path).c_str(), dstFormat);
+        if(!writer.valid() || !writer.write(worker.dst_.data(), dstFrames) || !writer.close()) {
+            return false;
+        }
+        Clock::time_point written = Clock::now();
+
+        statistics.srcFrames_ += srcFrames;
+        statistics.dstFrames_ += dstFrames;
+        statistics.seconds_[Stage_Read] += seconds(start, read);
+        statistics.seconds_[Stage_Resample] += seconds(read, resampled);
+        statistics.seconds_[Stage_Write] += seconds(resampled, written);
+        return true;
+    }
+
+    void work(Worker* worker, const Options* options, std::atomic<size_t>* next)
+    {
+        worker->statistics_ = {};
+        for(size_t i = (*next)++; i < options->files_.size(); i = (*next)++) {
+            if(convert(*worker, *options, options->files_[i])) {
+                ++worker->statistics_.files_;
+            } else {
+                ++worker->statistics_.failures_;
+                fprintf(stderr, "failed: %s\n", options->files_[i].c_str());
+            }
+        }
+    }
+
+    void print_usage()
+    {
+        printf("usage: resamcpp --rate=<Hz> --output=<directory> [--quality=fast|best] [--bits=8|16|24|32] [--jobs=<n>] [--list=<file>] <file or directory>...\n");
+    }
+
+    bool parse(Options& options, int argc, char** argv)
+    {
+        options.frequency_ = 0;
+        options.quality_ = Resampler::Quality::Best;
+        options.bitsPerSample_ = 0;
+        options.jobs_ = std::thread::hardware_concurrency();
+        for(int i = 1; i < argc; ++i) {
+            if(0 == strncmp(argv[i], "--rate=", 7)) {
+                options.frequency_ = static_cast<u32>(strtoul(argv[i] + 7, RESAMCPP_NULL, 10));
+            } else if(0 == strncmp(argv[i], "--output=", 9)) {
+                options.output_ = argv[i] + 9;
+            } else if(0 == strcmp(argv[i], "--quality=fast")) {
+                options.quality_ = Resampler::Quality::Fast;
+            } else if(0 == strcmp(argv[i], "--quality=best")) {
+                options.quality_ = Resampler::Quality::Best;
+            } else if(0 == strncmp(argv[i], "--bits=", 7)) {
+                options.bitsPerSample_ = static_cast<u32>(atoi(argv[i] + 7));
+                if(8 != options.bitsPerSample_ && 16 != options.bitsPerSample_ && 24 != options.bitsPerSample_ && 32 != options.bitsPerSample_) {
+                    return false;
+                }
+            } else if(0 == strncmp(argv[i], "--jobs=", 7)) {
+                options.jobs_ = static_cast<u32>(atoi(argv[i] + 7));
+            } else if(0 == strncmp(argv[i], "--list=", 7)) {
+                if(!add_list(options.files_, argv[i] + 7)) {
+                    fprintf(stderr, "cannot read %s\n", argv[i] + 7);
+                    return false;
+                }
+            } else if(0 == strncmp(argv[i], "--", 2)) {
+                return false;
+            } else {
+                add_path(options.files_, argv[i]);
+            }
+        }
+        if(options.jobs_ <= 0) {
+            options.jobs_ = 1;
+        }
+        return 0 < options.frequency_ && !options.output_.empty();
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parse(options, argc, argv)) {
+        print_usage();
+        return 1;
+    }
+
+    // Each worker converts whole files, so reading and writing of one overlaps resampling of the others
+    u32 jobs = static_cast<u32>(std::min<size_t>(options.jobs_, options.files_.size()));
+    std::vector<Worker> workers(jobs);
+    std::atomic<size_t> next(0);
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for(u32 i = 0; i < jobs; ++i) {
+        threads.emplace_back(work, &workers[i], &options, &next);
+    }
+    for(std::thread& thread: threads) {
+        thread.join();
+    }
+    f64 wall = seconds(start, Clock::now());
+
+    Statistics total = {};
+    for(const Worker& worker: workers) {
+        total.files_ += worker.statistics_.files_;
+        total.failures_ += worker.statistics_.failures_;
+        total.srcFrames_ += worker.statistics_.srcFrames_;
+        total.dstFrames_ += worker.statistics_.dstFrames_;
+        for(u32 i = 0; i < Stage_Max; ++i) {
+            total.seconds_[i] += worker.statistics_.seconds_[i];
+        }
+    }
+    f64 busy = total.seconds_[Stage_Read] + total.seconds_[Stage_Resample] + total.seconds_[Stage_Write];
+    printf("files: %llu converted, %llu failed, %u workers, %.3f s\n",
+           static_cast<unsigned long long>(total.files_),
+           static_cast<unsigned long long>(total.failures_),
+           jobs, wall);
+    if(0.0 < wall) {
+        printf("throughput: %.1f files/s, %.0f input frames/s, %.0f output frames/s\n",
+               total.files_ / wall, total.srcFrames_ / wall, total.dstFrames_ / wall);
+    }
+    // Stage times are summed over workers
+    printf("%-10s %12s %8s\n", "stage", "seconds", "share");
+    for(u32 i = 0; i < Stage_Max; ++i) {
+        printf("%-10s %12.3f %7.1f%%\n", StageNames[i], total.seconds_[i], (0.0 < busy) ? 100.0 * total.seconds_[i] / busy : 0.0);
+    }
+    return 0 < total.failures_ ? 1 : 0;
 }
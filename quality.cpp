@@ -0,0 +1,1346 @@
+﻿#include "resamcpp.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace resamcpp;
+
+    const f64 Pi = 3.14159265358979323846;
+
+    struct Ratio
+    {
+        u32 src_;
+        u32 dst_;
+    };
+
+    //--- Both polyphase banks and interpolated filters, up and down
+    const Ratio Ratios[] = {
+        {44100, 48000},
+        {48000, 44100},
+        {8000, 48000},
+        {96000, 44100},
+        {44100, 44101},
+        {24000, 48000},
+        {16000, 48000},
+        {48000, 24000},
+        {48000, 12000},
+    };
+
+    //--- Ratios below 1/2, which are split into half-band stages and a fractional stage
+    const Ratio CascadeRatios[] = {
+        {192000, 48000},
+        {192000, 44100},
+    };
+
+    //--- Integer ratios, which have a Nyquist filter, whose Stream drifts by 1/DriftDivisor of the output frequency
+    const Ratio DriftRatios[] = {
+        {24000, 48000},
+        {16000, 48000},
+        {48000, 24000},
+    };
+    const u32 DriftDivisor = 1000;
+
+    //--- Mono streams of a StreamEngine, the conferencing case and a fractional ratio
+    const Ratio EngineRatios[] = {
+        {16000, 48000},
+        {44100, 48000},
+        {48000, 16000},
+    };
+
+    const f64 QuantizedSNR = 90.0; //!< the SNR of the phase bits, which is below the quantization of s16 outputs
+
+    const u32 BatchJobs = 48; //!< clips of mixed rates and lengths
+    const u32 BatchRates[] = {8000, 22050, 32000, 44100, 48000, 96000};
+
+    //--- Clips of a Best batch, whose first four ratios are below 1/oversample or have a zero rate and are rejected
+    const Ratio UnsupportedBatchRatios[] = {
+        {48000, 8000},
+        {96000, 8000},
+        {0, 48000},
+        {48000, 0},
+        {48000, 16000},
+    };
+
+    const u32 EngineStreams = 20; //!< a full batch and a partial one
+    const u32 EngineBlock = 160; //!< the input frames per call, 10 ms at 16 kHz
+
+    const u32 RealtimeChannels = 2;
+    const u32 RealtimeCapacity = 2048; //!< the input frames of the ring
+    const u32 RealtimePush = 97; //!< the input frames per push, which do not align with pulls
+    const u32 RealtimePull = 256; //!< the output frames per pull, like an audio callback
+
+    struct Design
+    {
+        const char* name_;
+        FilterDesign design_;
+    };
+
+    //--- The presets and a design, whose oversample is high enough for mastering
+    const Design Designs[] = {
+        {"fast", Resampler::design(Resampler::Quality::Fast)},
+        {"best", Resampler::design(Resampler::Quality::Best)},
+        {"hq", {14.769656459379492, 0.9475937167399596, 64, 128}},
+    };
+
+    const u32 Channels[] = {1, 2, 3, 6};
+
+    const f64 SignalSeconds = 0.25;
+    const f64 Amplitude = 0.25; //!< -12 dBFS
+    const f64 ToneFrequency = 997.0;
+    const f64 MaxDelayError = 0.25; //!< in input frames, the phase delay of a minimum phase filter at the tone differs from the group delay at DC
+    const f64 MaxGainError = 0.005; //!< the gain of the tone may differ from one by this, the interpolation of a coarse table droops
+    const f64 MinToneSNR = 40.0; //!< the minimum SNR of a linear phase tone to the exact sine at the output times in dB, the table of best limits it
+
+    struct Threshold
+    {
+        f64 maxError_; //!< the maximum absolute error to the reference, the full scale is 1
+        f64 minSNR_; //!< the minimum SNR to the reference in dB
+        f64 thdnMargin_; //!< how much THD+N of a tone can exceed the reference's in dB
+    };
+
+    struct Options
+    {
+        Threshold float_; //!< for f32 outputs
+        Threshold integer_; //!< for s16 outputs, which include the quantization noise
+        Threshold fixed_; //!< for s16 outputs of Q15 weights, which include the rounding noise of the weights too
+        Threshold ratio_; //!< for s16 outputs of a variable ratio, whose 32.32 time can pick other taps at the end of the table
+        f64 maxTHDN_; //!< the maximum THD+N of a tone in dB, which is limited by the filters
+        f64 thdnFloor_; //!< THD+N below this in dB is not compared with the reference, f32 arithmetic cannot reach it
+        bool verbose_;
+    };
+
+    struct Metrics
+    {
+        f64 maxError_;
+        f64 snr_;
+        f64 thdn_;
+    };
+
+    /**
+    @brief Interleaved signal, which is normalized to the full scale 1
+    */
+    struct Signal
+    {
+        u32 frequency_;
+        u32 channels_;
+        u32 frames_;
+        std::vector<f64> samples_;
+    };
+
+    /**
+    @brief Exponential sine sweep from 20 Hz to 0.45 of the sampling frequency, shifted per channel
+    */
+    void make_sweep(Signal& signal, u32 frequency, u32 channels, u32 frames)
+    {
+        signal.frequency_ = frequency;
+        signal.channels_ = channels;
+        signal.frames_ = frames;
+        signal.samples_.resize(static_cast<size_t>(frames) * channels);
+        f64 f0 = 20.0;
+        f64 f1 = 0.45 * frequency;
+        f64 duration = static_cast<f64>(frames) / frequency;
+        f64 k = log(f1 / f0) / duration;
+        for(u32 i = 0; i < frames; ++i) {
+            f64 t = static_cast<f64>(i) / frequency;
+            f64 phase = 2.0 * Pi * f0 * (exp(k * t) - 1.0) / k;
+            for(u32 c = 0; c < channels; ++c) {
+                signal.samples_[static_cast<size_t>(i) * channels + c] = Amplitude * sin(phase + c);
+            }
+        }
+    }
+
+    void make_tone(Signal& signal, u32 frequency, u32 channels, u32 frames)
+    {
+        signal.frequency_ = frequency;
+        signal.channels_ = channels;
+        signal.frames_ = frames;
+        signal.samples_.resize(static_cast<size_t>(frames) * channels);
+        for(u32 i = 0; i < frames; ++i) {
+            f64 phase = 2.0 * Pi * ToneFrequency * i / frequency;
+            for(u32 c = 0; c < channels; ++c) {
+                signal.samples_[static_cast<size_t>(i) * channels + c] = Amplitude * sin(phase + c);
+            }
+        }
+    }
+
+    /**
+    @brief The polyphase bank of Resampler in double precision, for the filters which are not a table of the symmetric sinc
+    */
+    void reference_bank(std::vector<f64>& dst, const Resampler& resampler, f64 scale, const std::vector<f64>& src, u32 channels, u32 srcFrames, u32 dstFrames)
+    {
+        const f32* bank = resampler.bank();
+        u32 window = resampler.window();
+        u64 wing = window - resampler.lookahead();
+        dst.assign(static_cast<size_t>(dstFrames) * channels, 0.0);
+        for(u32 i = 0; i < dstFrames; ++i) {
+            u64 n;
+            u32 p;
+            resampler.time_at(i, n, p);
+            const f32* row = bank + static_cast<size_t>(p) * resampler.width();
+            for(u32 k = 0; k < window; ++k) {
+                // The frames out of the signal are zeros
+                u64 frame = n + 1 + k;
+                if(frame < wing || srcFrames + wing <= frame) {
+                    continue;
+                }
+                frame -= wing;
+                for(u32 c = 0; c < channels; ++c) {
+                    dst[static_cast<size_t>(i) * channels + c] += scale * row[k] * src[frame * channels + c];
+                }
+            }
+        }
+    }
+
+    /**
+    @brief The same Kaiser windowed sinc as Resampler, evaluated in double precision from a filter table
+    */
+    void reference(std::vector<f64>& dst, const Resampler& resampler, const Filter& filter, const Ratio& ratio, const std::vector<f64>& src, u32 channels, u32 srcFrames, u32 dstFrames)
+    {
+        f32 ratioScale = (ratio.dst_ < ratio.src_) ? static_cast<f32>(static_cast<f64>(ratio.dst_) / ratio.src_) : 1.0f;
+        if(Resampler::Phase::Linear != resampler.phase()) {
+            reference_bank(dst, resampler, ratioScale, src, channels, srcFrames, dstFrames);
+            return;
+        }
+        // The table is stepped by whole indices, which scale the filter time and the output by indexStep/oversample
+        u32 indexStep = static_cast<u32>(ratioScale * filter.oversample_);
+        f64 scale = static_cast<f64>(indexStep) / filter.oversample_;
+        dst.assign(static_cast<size_t>(dstFrames) * channels, 0.0);
+        std::vector<f64> values(channels);
+        for(u32 i = 0; i < dstFrames; ++i) {
+            u64 n;
+            u32 p;
+            resampler.time_at(i, n, p);
+            u64 phases;
+            {
+                // The phase is relative to L of the reduced ratio L/M
+                u64 a = ratio.dst_;
+                u64 b = ratio.src_;
+                while(0 != b) {
+                    u64 t = a % b;
+                    a = b;
+                    b = t;
+                }
+                phases = ratio.dst_ / a;
+            }
+            for(u32 c = 0; c < channels; ++c) {
+                values[c] = 0.0;
+            }
+            f64 frac = scale * (static_cast<f64>(p) / phases);
+            for(u32 w = 0; w < 2; ++w) {
+                f64 indexFrac = frac * filter.oversample_;
+                u32 offset = static_cast<u32>(indexFrac);
+                f64 eta = indexFrac - offset;
+                u64 available = (0 == w) ? n + 1 : srcFrames - n - 1;
+                u64 maxi = (filter.taps_ - offset) / indexStep;
+                maxi = (available < maxi) ? available : maxi;
+                for(u64 j = 0; j < maxi; ++j) {
+                    u64 index = offset + j * indexStep;
+                    f64 weight = static_cast<f64>(filter.filter_[index]) + eta * filter.filterDelta_[index];
+                    u64 frame = (0 == w) ? n - j : n + 1 + j;
+                    for(u32 c = 0; c < channels; ++c) {
+                        values[c] += weight * src[frame * channels + c];
+                    }
+                }
+                frac = scale - frac;
+            }
+            for(u32 c = 0; c < channels; ++c) {
+                dst[static_cast<size_t>(i) * channels + c] = scale * values[c];
+            }
+        }
+    }
+
+    void reference(std::vector<f64>& dst, const Resampler& resampler, const Ratio& ratio, const std::vector<f64>& src, u32 channels, u32 srcFrames, u32 dstFrames)
+    {
+        reference(dst, resampler, resampler.filter(), ratio, src, channels, srcFrames, dstFrames);
+    }
+
+    /**
+    @brief The table of the design, which a Stream interpolates for a variable ratio instead of a Nyquist filter
+    */
+    struct RatioTable
+    {
+        const Resampler& resampler_;
+    };
+
+    void reference(std::vector<f64>& dst, const RatioTable& table, const Ratio& ratio, const std::vector<f64>& src, u32 channels, u32 srcFrames, u32 dstFrames)
+    {
+        reference(dst, table.resampler_, table.resampler_.ratio_filter(), ratio, src, channels, srcFrames, dstFrames);
+    }
+
+    /**
+    @brief The half-band stages of a cascade in double precision from its taps, followed by the reference of the final stage
+    */
+    void reference(std::vector<f64>& dst, const Cascade& cascade, const Ratio& ratio, const std::vector<f64>& src, u32 channels, u32 srcFrames, u32 dstFrames)
+    {
+        std::vector<f64> input(src);
+        std::vector<f64> output;
+        u32 frames = srcFrames;
+        for(u32 s = 0; s < cascade.stages(); ++s) {
+            u32 length = (cascade.taps(s) - 1) / 2;
+            const f32* taps = cascade.half_band(s);
+            u32 half = (frames + 1) / 2;
+            output.assign(static_cast<size_t>(half) * channels, 0.0);
+            for(u32 m = 0; m < half; ++m) {
+                u64 n = static_cast<u64>(m) * 2;
+                for(u32 c = 0; c < channels; ++c) {
+                    f64 value = 0.5 * input[n * channels + c];
+                    for(u32 j = 0; j < length; ++j) {
+                        u64 distance = j * 2 + 1;
+                        if(distance <= n) {
+                            value += taps[j] * input[(n - distance) * channels + c];
+                        }
+                        if(n + distance < frames) {
+                            value += taps[j] * input[(n + distance) * channels + c];
+                        }
+                    }
+                    output[static_cast<size_t>(m) * channels + c] = value;
+                }
+            }
+            input.swap(output);
+            frames = half;
+        }
+        Ratio last = {ratio.src_, ratio.dst_ << cascade.stages()};
+        reference(dst, cascade.resampler(), last, input, channels, frames, dstFrames);
+    }
+
+    f64 to_db(f64 x)
+    {
+        return 10.0 * log10((x < 1.0e-300) ? 1.0e-300 : x);
+    }
+
+    /**
+    @brief Max absolute error and SNR to the reference
+    */
+    void compare(Metrics& metrics, const std::vector<f64>& result, const std::vector<f64>& expected)
+    {
+        f64 maxError = 0.0;
+        f64 signal = 0.0;
+        f64 noise = 0.0;
+        for(size_t i = 0; i < expected.size(); ++i) {
+            f64 error = result[i] - expected[i];
+            maxError = (maxError < fabs(error)) ? fabs(error) : maxError;
+            signal += expected[i] * expected[i];
+            noise += error * error;
+        }
+        metrics.maxError_ = maxError;
+        metrics.snr_ = to_db(signal) - to_db(noise);
+    }
+
+    /**
+    @brief Least squares fit of a*cos + b*sin + d of the tone to a channel, excluding the guard frames at the edges
+    */
+    void fit_tone(f64 x[3], const std::vector<f64>& result, u32 channels, u32 channel, u32 frames, u32 frequency, u32 guard)
+    {
+        f64 omega = 2.0 * Pi * ToneFrequency / frequency;
+        // Normal equations of a*cos + b*sin + d
+        f64 m[3][4] = {};
+        for(u32 i = guard; i < frames - guard; ++i) {
+            f64 basis[3] = {cos(omega * i), sin(omega * i), 1.0};
+            f64 y = result[static_cast<size_t>(i) * channels + channel];
+            for(u32 r = 0; r < 3; ++r) {
+                for(u32 k = 0; k < 3; ++k) {
+                    m[r][k] += basis[r] * basis[k];
+                }
+                m[r][3] += basis[r] * y;
+            }
+        }
+        for(u32 r = 0; r < 3; ++r) {
+            for(u32 k = r + 1; k < 3; ++k) {
+                f64 f = m[k][r] / m[r][r];
+                for(u32 l = r; l < 4; ++l) {
+                    m[k][l] -= f * m[r][l];
+                }
+            }
+        }
+        for(u32 r = 3; 0 < r--;) {
+            f64 v = m[r][3];
+            for(u32 k = r + 1; k < 3; ++k) {
+                v -= m[r][k] * x[k];
+            }
+            x[r] = v / m[r][r];
+        }
+    }
+
+    /**
+    @brief THD+N of the tone, the worst of channels
+
+    The fundamental is fitted with least squares, and the residual is distortion plus noise.
+    The edges, where the filter is clipped, are excluded.
+    */
+    f64 thdn(const std::vector<f64>& result, u32 channels, u32 frames, u32 frequency, u32 guard)
+    {
+        f64 worst = -1000.0;
+        if(frames <= guard * 2) {
+            return worst;
+        }
+        f64 omega = 2.0 * Pi * ToneFrequency / frequency;
+        for(u32 c = 0; c < channels; ++c) {
+            f64 x[3];
+            fit_tone(x, result, channels, c, frames, frequency, guard);
+            f64 fundamental = 0.0;
+            f64 residual = 0.0;
+            for(u32 i = guard; i < frames - guard; ++i) {
+                f64 fit = x[0] * cos(omega * i) + x[1] * sin(omega * i);
+                f64 error = result[static_cast<size_t>(i) * channels + c] - fit - x[2];
+                fundamental += fit * fit;
+                residual += error * error;
+            }
+            f64 value = to_db(residual) - to_db(fundamental);
+            worst = (worst < value) ? value : worst;
+        }
+        return worst;
+    }
+
+    /**
+    @brief Delay of the tone in the channel 0 in input frames, which is wrapped to a half period of the tone
+
+    The tone sin(w*t) delayed by d is cos(w*d)*sin(w*t) - sin(w*d)*cos(w*t), so that w*d is atan2(-a, b) of the fit.
+    */
+    f64 tone_delay(const std::vector<f64>& result, u32 channels, u32 frames, const Ratio& ratio, u32 guard)
+    {
+        f64 x[3];
+        fit_tone(x, result, channels, 0, frames, ratio.dst_, guard);
+        f64 omega = 2.0 * Pi * ToneFrequency / ratio.src_;
+        return atan2(-x[0], x[1]) / omega;
+    }
+
+    /**
+    @brief Gain of the tone in the channel 0, the amplitude of its fit to the one of the input
+    */
+    f64 tone_gain(const std::vector<f64>& result, u32 channels, u32 frames, u32 frequency, u32 guard)
+    {
+        f64 x[3];
+        fit_tone(x, result, channels, 0, frames, frequency, guard);
+        return sqrt(x[0] * x[0] + x[1] * x[1]) / Amplitude;
+    }
+
+    /**
+    @brief SNR of the tone to the exact sine at the output times, which are delayed by delay input frames, excluding the guard frames
+    */
+    f64 tone_snr(const std::vector<f64>& result, u32 channels, u32 frames, const Ratio& ratio, f64 delay, u32 guard)
+    {
+        f64 signal = 0.0;
+        f64 noise = 0.0;
+        for(u32 i = guard; i + guard < frames; ++i) {
+            f64 phase = 2.0 * Pi * ToneFrequency * (static_cast<f64>(i) / ratio.dst_ - delay / ratio.src_);
+            for(u32 c = 0; c < channels; ++c) {
+                f64 expected = Amplitude * sin(phase + c);
+                f64 error = result[static_cast<size_t>(i) * channels + c] - expected;
+                signal += expected * expected;
+                noise += error * error;
+            }
+        }
+        return to_db(signal) - to_db(noise);
+    }
+
+    //--- Variants of the resampler, which take and return normalized samples
+    enum class Path
+    {
+        RunS16,
+        RunF32,
+        Parallel,
+        Planar,
+        Stream,
+        ISPC,
+        Fixed,
+        FixedStream,
+        StreamRatio,
+        Quantized,
+        QuantizedStream,
+    };
+
+    const char* path_name(Path path)
+    {
+        switch(path) {
+        case Path::RunS16:
+            return "run/s16";
+        case Path::RunF32:
+            return "run/f32";
+        case Path::Parallel:
+            return "run_parallel/f32";
+        case Path::Planar:
+            return "run_planar/f32";
+        case Path::Stream:
+            return "stream/s16";
+        case Path::ISPC:
+            return "run_ispc/s16";
+        case Path::Fixed:
+            return "run_fixed/s16";
+        case Path::FixedStream:
+            return "stream_fixed/s16";
+        case Path::StreamRatio:
+            return "stream_ratio/s16";
+        case Path::Quantized:
+            return "run_quantized/s16";
+        case Path::QuantizedStream:
+            return "stream_quantized/s16";
+        default:
+            return "unknown";
+        }
+    }
+
+    bool is_fixed(Path path)
+    {
+        return Path::Fixed == path || Path::FixedStream == path;
+    }
+
+    bool is_quantized(Path path)
+    {
+        return Path::Quantized == path || Path::QuantizedStream == path;
+    }
+
+    bool is_integer(Path path)
+    {
+        return Path::RunS16 == path || Path::Stream == path || Path::ISPC == path || Path::StreamRatio == path || is_fixed(path) || is_quantized(path);
+    }
+
+    s16 to_s16(f64 x)
+    {
+        f64 v = floor(x * 32768.0 + 0.5);
+        v = (v < -32768.0) ? -32768.0 : v;
+        v = (32767.0 < v) ? 32767.0 : v;
+        return static_cast<s16>(v);
+    }
+
+    s16 truncate_s16(f64 x)
+    {
+        f64 v = x * 32768.0;
+        v = (v < -32768.0) ? -32768.0 : v;
+        v = (32767.0 < v) ? 32767.0 : v;
+        return static_cast<s16>(v);
+    }
+
+    bool process(std::vector<f64>& dst, Path path, const Resampler& resampler, const Signal& src, u32 dstFrames)
+    {
+        u32 channels = src.channels_;
+        size_t srcSize = src.samples_.size();
+        size_t dstSize = static_cast<size_t>(dstFrames) * channels;
+        dst.assign(dstSize, 0.0);
+        switch(path) {
+        case Path::RunS16:
+        case Path::ISPC:
+        case Path::Stream:
+        case Path::Fixed:
+        case Path::FixedStream:
+        case Path::StreamRatio:
+        case Path::Quantized:
+        case Path::QuantizedStream: {
+            std::vector<s16> input(srcSize);
+            std::vector<s16> output(dstSize);
+            for(size_t i = 0; i < srcSize; ++i) {
+                input[i] = to_s16(src.samples_[i]);
+            }
+            u32 frames = 0;
+            if(Path::RunS16 == path || Path::Fixed == path || Path::Quantized == path) {
+                frames = resampler.run(channels, dstFrames, output.data(), src.frames_, input.data());
+            } else if(Path::ISPC == path) {
+                frames = resampler.run_ispc(channels, dstFrames, output.data(), src.frames_, input.data());
+            } else {
+                // Feed odd sized blocks to cross the ring buffer in many ways
+                Stream stream = Stream::initialize(resampler, channels);
+                if(!stream.valid()) {
+                    return false;
+                }
+                // The same ratio in 32.32 fixed point instead of the exact register
+                if((Path::StreamRatio == path || Path::QuantizedStream == path) && !stream.set_ratio(stream.ratio())) {
+                    return false;
+                }
+                const u32 block = 333;
+                for(u32 i = 0; i < src.frames_; i += block) {
+                    u32 count = (src.frames_ - i < block) ? src.frames_ - i : block;
+                    frames += stream.process(input.data() + static_cast<size_t>(i) * channels, count, output.data() + static_cast<size_t>(frames) * channels, dstFrames - frames);
+                }
+                frames += stream.flush(output.data() + static_cast<size_t>(frames) * channels, dstFrames - frames);
+            }
+            for(size_t i = 0; i < dstSize; ++i) {
+                dst[i] = output[i] / 32768.0;
+            }
+            return frames == dstFrames;
+        }
+        case Path::RunF32:
+        case Path::Parallel: {
+            std::vector<f32> input(srcSize);
+            std::vector<f32> output(dstSize);
+            for(size_t i = 0; i < srcSize; ++i) {
+                input[i] = static_cast<f32>(src.samples_[i]);
+            }
+            u32 frames = (Path::RunF32 == path)
+                             ? resampler.run(channels, dstFrames, output.data(), src.frames_, input.data())
+                             : resampler.run_parallel(channels, dstFrames, output.data(), src.frames_, input.data(), 3);
+            for(size_t i = 0; i < dstSize; ++i) {
+                dst[i] = output[i];
+            }
+            return frames == dstFrames;
+        }
+        case Path::Planar: {
+            std::vector<std::vector<f32>> input(channels, std::vector<f32>(src.frames_));
+            std::vector<std::vector<f32>> output(channels, std::vector<f32>(dstFrames));
+            std::vector<const f32*> inputs(channels);
+            std::vector<f32*> outputs(channels);
+            for(u32 c = 0; c < channels; ++c) {
+                for(u32 i = 0; i < src.frames_; ++i) {
+                    input[c][i] = static_cast<f32>(src.samples_[static_cast<size_t>(i) * channels + c]);
+                }
+                inputs[c] = input[c].data();
+                outputs[c] = output[c].data();
+            }
+            u32 frames = resampler.run_planar(channels, dstFrames, outputs.data(), src.frames_, inputs.data());
+            for(u32 c = 0; c < channels; ++c) {
+                for(u32 i = 0; i < dstFrames; ++i) {
+                    dst[static_cast<size_t>(i) * channels + c] = output[c][i];
+                }
+            }
+            return frames == dstFrames;
+        }
+        default:
+            return false;
+        }
+    }
+
+    bool process(std::vector<f64>& dst, bool integer, Cascade& cascade, const Signal& src, u32 dstFrames)
+    {
+        u32 channels = src.channels_;
+        size_t srcSize = src.samples_.size();
+        size_t dstSize = static_cast<size_t>(dstFrames) * channels;
+        dst.assign(dstSize, 0.0);
+        u32 frames = 0;
+        if(integer) {
+            std::vector<s16> input(srcSize);
+            std::vector<s16> output(dstSize);
+            for(size_t i = 0; i < srcSize; ++i) {
+                input[i] = to_s16(src.samples_[i]);
+            }
+            frames = cascade.run(channels, dstFrames, output.data(), src.frames_, input.data());
+            for(size_t i = 0; i < dstSize; ++i) {
+                dst[i] = output[i] / 32768.0;
+            }
+        } else {
+            std::vector<f32> input(srcSize);
+            std::vector<f32> output(dstSize);
+            for(size_t i = 0; i < srcSize; ++i) {
+                input[i] = static_cast<f32>(src.samples_[i]);
+            }
+            frames = cascade.run(channels, dstFrames, output.data(), src.frames_, input.data());
+            for(size_t i = 0; i < dstSize; ++i) {
+                dst[i] = output[i];
+            }
+        }
+        return frames == dstFrames;
+    }
+
+    /**
+    @brief Push from a producer thread and pull from this thread through a RealtimeStream
+
+    Both threads wait for the ring without overruns or underruns. At the end, the ring can not fill a pull,
+    and it can not take more frames than its capacity, each is counted once.
+    */
+    bool process(std::vector<f64>& dst, const Resampler& resampler, const Signal& src, u32 dstFrames)
+    {
+        u32 channels = src.channels_;
+        dst.assign(static_cast<size_t>(dstFrames) * channels, 0.0);
+        RealtimeStream stream = RealtimeStream::initialize(resampler, channels, RealtimeCapacity);
+        if(!stream.valid()) {
+            return false;
+        }
+        std::vector<s16> input(src.samples_.size());
+        for(size_t i = 0; i < input.size(); ++i) {
+            input[i] = to_s16(src.samples_[i]);
+        }
+        std::thread producer([&stream, &input, &src, channels]() {
+            for(u32 i = 0; i < src.frames_;) {
+                u32 count = (src.frames_ - i < RealtimePush) ? src.frames_ - i : RealtimePush;
+                if(stream.space() < count) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                i += stream.push(input.data() + static_cast<size_t>(i) * channels, count);
+            }
+        });
+        std::vector<s16> output(static_cast<size_t>(RealtimePull) * channels);
+        bool ok = true;
+        for(u32 frames = 0; frames < dstFrames;) {
+            u32 count = (dstFrames - frames < RealtimePull) ? dstFrames - frames : RealtimePull;
+            if(stream.queued() < stream.input_frames(count)) {
+                std::this_thread::yield();
+                continue;
+            }
+            ok = stream.pull(output.data(), count) == count && ok;
+            for(size_t i = 0; i < static_cast<size_t>(count) * channels; ++i) {
+                dst[static_cast<size_t>(frames) * channels + i] = output[i] / 32768.0;
+            }
+            frames += count;
+        }
+        producer.join();
+        ok = 0 == stream.underruns() && 0 == stream.overruns() && ok;
+
+        // The last frames of the input do not have their right wings
+        u32 pulled = stream.pull(output.data(), RealtimePull);
+        for(size_t i = static_cast<size_t>(pulled) * channels; i < output.size(); ++i) {
+            ok = 0 == output[i] && ok;
+        }
+        ok = RealtimePull != pulled && 1 == stream.underruns() && ok;
+        std::vector<s16> overflow(static_cast<size_t>(stream.capacity() + 1) * channels);
+        ok = stream.push(overflow.data(), stream.capacity() + 1) <= stream.capacity() && 1 == stream.overruns() && ok;
+        return ok;
+    }
+
+    /**
+    @brief Resample every channel as a mono stream of a StreamEngine in blocks
+
+    At the end, a stream leaves and joins again, which must start from silence in the same lane.
+    */
+    bool process(std::vector<f64>& dst, const Ratio& ratio, Resampler::Quality quality, const Signal& src, u32 dstFrames)
+    {
+        u32 streams = src.channels_;
+        dst.assign(static_cast<size_t>(dstFrames) * streams, 0.0);
+        StreamEngine engine;
+        std::vector<u32> handles(streams);
+        for(u32 k = 0; k < streams; ++k) {
+            handles[k] = engine.join(ratio.src_, ratio.dst_, quality);
+            if(StreamEngine::InvalidStream == handles[k]) {
+                return false;
+            }
+        }
+        // All batches share one resampler
+        if(1 != engine.groups()) {
+            return false;
+        }
+        u32 dstCapacity = static_cast<u32>(static_cast<u64>(EngineBlock) * ratio.dst_ / ratio.src_) + 1;
+        std::vector<std::vector<s16>> input(engine.capacity(), std::vector<s16>(EngineBlock));
+        std::vector<std::vector<s16>> output(engine.capacity(), std::vector<s16>(dstCapacity));
+        std::vector<const s16*> inputs(engine.capacity(), RESAMCPP_NULL);
+        std::vector<s16*> outputs(engine.capacity());
+        std::vector<u32> dstFramesOf(engine.capacity());
+        for(u32 i = 0; i < engine.capacity(); ++i) {
+            outputs[i] = output[i].data();
+        }
+        u32 frames = 0;
+        for(u32 i = 0; i < src.frames_; i += EngineBlock) {
+            u32 count = (src.frames_ - i < EngineBlock) ? src.frames_ - i : EngineBlock;
+            for(u32 k = 0; k < streams; ++k) {
+                for(u32 j = 0; j < count; ++j) {
+                    input[handles[k]][j] = to_s16(src.samples_[static_cast<size_t>(i + j) * streams + k]);
+                }
+                inputs[handles[k]] = input[handles[k]].data();
+            }
+            engine.process(count, inputs.data(), outputs.data(), dstCapacity, dstFramesOf.data());
+            u32 produced = dstFramesOf[handles[0]];
+            for(u32 k = 0; k < streams; ++k) {
+                if(dstFramesOf[handles[k]] != produced || dstFrames < frames + produced) {
+                    return false;
+                }
+                for(u32 j = 0; j < produced; ++j) {
+                    dst[static_cast<size_t>(frames + j) * streams + k] = output[handles[k]][j] / 32768.0;
+                }
+            }
+            frames += produced;
+        }
+
+        u32 last = handles[streams - 1];
+        engine.leave(last);
+        if(last != engine.join(ratio.src_, ratio.dst_, quality)) {
+            return false;
+        }
+        inputs.assign(engine.capacity(), RESAMCPP_NULL);
+        engine.process(EngineBlock, inputs.data(), outputs.data(), dstCapacity, dstFramesOf.data());
+        for(u32 j = 0; j < dstFramesOf[last]; ++j) {
+            if(0 != output[last][j]) {
+                return false;
+            }
+        }
+        return frames == dstFrames;
+    }
+
+    /**
+    @brief A ratio below 1/oversample does not step through the table, every run fails instead of dividing by zero, and a zero rate is not valid
+    */
+    bool check_unsupported()
+    {
+        Resampler resampler = Resampler::initialize(48000, 8000, Resampler::Quality::Best);
+        const u32 srcFrames = 4800;
+        const u32 dstFrames = 800;
+        std::vector<s16> input(srcFrames);
+        std::vector<s16> output(dstFrames);
+        std::vector<f32> planarInput(srcFrames);
+        std::vector<f32> planarOutput(dstFrames);
+        const f32* inputs[] = {planarInput.data()};
+        f32* outputs[] = {planarOutput.data()};
+        return !resampler.valid()
+               && 0 == resampler.window()
+               && 0 == resampler.run(1, dstFrames, output.data(), srcFrames, input.data())
+               && 0 == resampler.run_parallel(1, dstFrames, output.data(), srcFrames, input.data(), 2)
+               && 0 == resampler.run_planar(1, dstFrames, outputs, srcFrames, inputs)
+               && 0 == resampler.run_ispc(1, dstFrames, output.data(), srcFrames, input.data())
+               && !Resampler::initialize(0, 48000, Resampler::Quality::Best).valid()
+               && !Resampler::initialize(48000, 0, Resampler::Quality::Best).valid();
+    }
+
+    /**
+    @brief Count an overdriven run and a Stream, the counters are all zero without RESAMCPP_STATS
+    */
+    bool check_statistics()
+    {
+        const u32 channels = 2;
+        const u32 srcFrames = 4410;
+        Resampler resampler = Resampler::initialize(44100, 48000);
+        u32 dstFrames = static_cast<u32>(resampler.output_frames(srcFrames));
+        std::vector<f32> src(static_cast<size_t>(srcFrames) * channels);
+        for(u32 i = 0; i < srcFrames; ++i) {
+            f32 x = 1.5f * static_cast<f32>(sin(2.0 * Pi * 1000.0 * i / 44100.0));
+            src[i * channels] = src[i * channels + 1] = x;
+        }
+        std::vector<s16> dst(static_cast<size_t>(dstFrames) * channels);
+        resampler.run(channels, dstFrames, dst.data(), srcFrames, src.data());
+        Stream stream = Stream::initialize(resampler, channels);
+        std::vector<s16> input(src.size(), 0);
+        u32 produced = stream.process(input.data(), srcFrames, dst.data(), dstFrames, RESAMCPP_NULL);
+        produced += stream.flush(dst.data() + static_cast<size_t>(produced) * channels, dstFrames - produced);
+
+        Resampler::Statistics statistics;
+        resampler.statistics(statistics);
+        u64 calls = 0;
+        for(u32 i = 0; i < Resampler::Statistics::Paths; ++i) {
+            calls += statistics.calls_[i];
+        }
+        u64 timed = 0;
+        for(u32 i = 0; i < Resampler::Statistics::LatencyBuckets; ++i) {
+            timed += statistics.latency_[i];
+        }
+        bool ok;
+        if(Resampler::Statistics::Enabled) {
+            u64 outputs = static_cast<u64>(dstFrames) + produced;
+            ok = statistics.outputFrames_ == outputs
+                 && statistics.calls_[static_cast<u32>(Resampler::Statistics::Path::Bank)] == 1
+                 && statistics.calls_[static_cast<u32>(Resampler::Statistics::Path::Stream)] == 2
+                 && calls == 3 && timed == calls
+                 && 0 < statistics.clippedWindows_ && statistics.clippedWindows_ < outputs
+                 && 0 < statistics.taps_ && statistics.taps_ <= outputs * resampler.window()
+                 && 0 < statistics.clippedSamples_ && statistics.inputFrames_ <= 2ULL * srcFrames;
+        } else {
+            ok = 0 == statistics.outputFrames_ && 0 == calls && 0 == timed;
+        }
+        resampler.reset_statistics();
+        resampler.statistics(statistics);
+        return ok && 0 == statistics.outputFrames_ && 0 == statistics.taps_;
+    }
+
+    /**
+    @brief A batch rejects the jobs of unsupported ratios with no output frames, and still runs the others
+    */
+    bool check_unsupported_batch()
+    {
+        const u32 count = sizeof(UnsupportedBatchRatios) / sizeof(UnsupportedBatchRatios[0]);
+        std::vector<BatchJob<s16, s16>> jobs(count);
+        std::vector<std::vector<s16>> clips(count);
+        for(u32 i = 0; i < count; ++i) {
+            BatchJob<s16, s16>& job = jobs[i];
+            job.srcFrequency_ = UnsupportedBatchRatios[i].src_;
+            job.dstFrequency_ = UnsupportedBatchRatios[i].dst_;
+            job.channels_ = 1;
+            job.srcFrames_ = 4800;
+            clips[i].resize(job.srcFrames_);
+            for(u32 j = 0; j < job.srcFrames_; ++j) {
+                clips[i][j] = to_s16(0.5 * sin(0.01 * j));
+            }
+            job.src_ = clips[i].data();
+        }
+        BatchResampler batch = BatchResampler::initialize(Resampler::Quality::Best);
+        u64 samples = BatchResampler::arena_samples(count, jobs.data());
+        std::vector<s16> arena(samples, 0);
+        if(1 != batch.run(count, jobs.data(), samples, arena.data(), 2) || 1 != batch.groups()) {
+            return false;
+        }
+        u64 offset = 0;
+        std::vector<s16> expected;
+        for(u32 i = 0; i < count; ++i) {
+            const BatchJob<s16, s16>& job = jobs[i];
+            Resampler resampler = Resampler::initialize(job.srcFrequency_, job.dstFrequency_, Resampler::Quality::Best);
+            u32 dstFrames = resampler.valid() ? resampler.output_frames(job.srcFrames_) : 0;
+            if(job.offset_ != offset || job.dstFrames_ != dstFrames) {
+                return false;
+            }
+            // The arena still holds the frames of a rejected ratio, the clips are whole multiples of the ratios
+            offset += (0 < job.srcFrequency_) ? static_cast<u64>(job.srcFrames_) * job.dstFrequency_ / job.srcFrequency_ : 0;
+            if(dstFrames <= 0) {
+                continue;
+            }
+            expected.assign(dstFrames, 0);
+            resampler.run(1, dstFrames, expected.data(), job.srcFrames_, job.src_);
+            if(0 != memcmp(expected.data(), arena.data() + job.offset_, sizeof(s16) * expected.size())) {
+                return false;
+            }
+        }
+        return offset == samples;
+    }
+
+    /**
+    @brief Resample clips of mixed ratios in a batch, each output is the same as Resampler::run of the clip
+    */
+    bool check_batch()
+    {
+        std::vector<BatchJob<f32, f32>> jobs(BatchJobs);
+        std::vector<std::vector<f32>> clips(BatchJobs);
+        u32 seed = 12345;
+        for(u32 i = 0; i < BatchJobs; ++i) {
+            BatchJob<f32, f32>& job = jobs[i];
+            seed = seed * 1664525U + 1013904223U;
+            job.srcFrequency_ = BatchRates[i % (sizeof(BatchRates) / sizeof(BatchRates[0]))];
+            job.dstFrequency_ = (0 == (i / 6) % 2) ? 48000 : 44100;
+            job.channels_ = 1 + i % 2;
+            // From 20 ms to 300 ms, the long ones are stolen less
+            job.srcFrames_ = job.srcFrequency_ / 50 + (seed >> 8) % (job.srcFrequency_ * 28 / 100);
+            clips[i].resize(static_cast<size_t>(job.srcFrames_) * job.channels_);
+            for(size_t j = 0; j < clips[i].size(); ++j) {
+                clips[i][j] = static_cast<f32>(0.5 * sin(0.01 * static_cast<f64>(j) * (i + 1)));
+            }
+            job.src_ = clips[i].data();
+        }
+        BatchResampler batch = BatchResampler::initialize(Resampler::Quality::Fast);
+        u64 samples = BatchResampler::arena_samples(BatchJobs, jobs.data());
+        std::vector<f32> arena(samples + 1, 0.0f);
+        if(0 != batch.run(BatchJobs, jobs.data(), samples - 1, arena.data(), 3)) {
+            return false;
+        }
+        if(BatchJobs != batch.run(BatchJobs, jobs.data(), samples, arena.data(), 3) || BatchJobs <= batch.groups()) {
+            return false;
+        }
+        u64 offset = 0;
+        std::vector<f32> expected;
+        for(u32 i = 0; i < BatchJobs; ++i) {
+            const BatchJob<f32, f32>& job = jobs[i];
+            Resampler resampler = Resampler::initialize(job.srcFrequency_, job.dstFrequency_, Resampler::Quality::Fast);
+            if(job.offset_ != offset || job.dstFrames_ != resampler.output_frames(job.srcFrames_)) {
+                return false;
+            }
+            expected.assign(static_cast<size_t>(job.dstFrames_) * job.channels_, 0.0f);
+            resampler.run(job.channels_, job.dstFrames_, expected.data(), job.srcFrames_, job.src_);
+            if(0 != memcmp(expected.data(), arena.data() + offset, sizeof(f32) * expected.size())) {
+                return false;
+            }
+            offset += expected.size();
+        }
+        return offset == samples && 0.0f == arena[samples] && check_unsupported_batch();
+    }
+
+    /**
+    @brief THD+N of a mono tone through a Stream, whose ratio drifts to dstFrequency
+    @param guard ... the output frames excluded at either edge
+    */
+    f64 drift_thdn(const Resampler& resampler, const Signal& tone, u32 dstFrequency, u32 guard)
+    {
+        std::vector<s16> input(tone.frames_);
+        for(u32 i = 0; i < tone.frames_; ++i) {
+            input[i] = to_s16(tone.samples_[i]);
+        }
+        Stream stream = Stream::initialize(resampler, 1);
+        if(!stream.valid() || !stream.set_ratio(static_cast<f64>(dstFrequency) / tone.frequency_)) {
+            return 0.0;
+        }
+        std::vector<s16> output(static_cast<size_t>(tone.frames_) * dstFrequency / tone.frequency_ + 1);
+        u32 capacity = static_cast<u32>(output.size());
+        u32 frames = stream.process(input.data(), tone.frames_, output.data(), capacity);
+        frames += stream.flush(output.data() + frames, capacity - frames);
+        std::vector<f64> result(frames);
+        for(u32 i = 0; i < frames; ++i) {
+            result[i] = output[i] / 32768.0;
+        }
+        return thdn(result, 1, frames, dstFrequency, guard);
+    }
+
+    /**
+    @brief THD+N of the reference tone, of the filter itself and with the quantization of s16 inputs and outputs
+    */
+    template<class T>
+    void reference_thdn(f64& floatTHDN, f64& integerTHDN, const T& resampler, const Ratio& ratio, const Signal& tone, u32 dstFrames, u32 guard)
+    {
+        u32 channels = tone.channels_;
+        std::vector<f64> expected;
+        reference(expected, resampler, ratio, tone.samples_, channels, tone.frames_, dstFrames);
+        floatTHDN = thdn(expected, channels, dstFrames, ratio.dst_, guard);
+        std::vector<f64> quantized(tone.samples_.size());
+        for(size_t i = 0; i < quantized.size(); ++i) {
+            quantized[i] = to_s16(tone.samples_[i]) / 32768.0;
+        }
+        reference(expected, resampler, ratio, quantized, channels, tone.frames_, dstFrames);
+        for(f64& x: expected) {
+            x = truncate_s16(x) / 32768.0;
+        }
+        integerTHDN = thdn(expected, channels, dstFrames, ratio.dst_, guard);
+    }
+
+    /**
+    @brief Judge a variant by the thresholds, and print it if it failed or verbose
+    */
+    bool judge(const Options& options, const char* name, const Ratio& ratio, const char* design, const Threshold& threshold, bool integer, bool ok, const Metrics& metrics, f64 floatTHDN, f64 integerTHDN)
+    {
+        f64 referenceTHDN = integer ? integerTHDN : floatTHDN;
+        f64 allowedTHDN = ((referenceTHDN < options.thdnFloor_) ? options.thdnFloor_ : referenceTHDN) + threshold.thdnMargin_;
+        bool passed = ok
+                      && metrics.maxError_ <= threshold.maxError_
+                      && threshold.minSNR_ <= metrics.snr_
+                      && metrics.thdn_ <= allowedTHDN
+                      && metrics.thdn_ <= options.maxTHDN_;
+        if(passed && !options.verbose_) {
+            return true;
+        }
+        char ratioName[32];
+        snprintf(ratioName, sizeof(ratioName), "%u->%u", ratio.src_, ratio.dst_);
+        printf("%-36s %-14s %-5s %12.3e %10.2f %10.2f %10.2f %s\n",
+               name, ratioName,
+               design,
+               metrics.maxError_, metrics.snr_, metrics.thdn_, referenceTHDN,
+               passed ? "ok" : "FAILED");
+        return passed;
+    }
+
+    bool parse(Options& options, int argc, char** argv)
+    {
+        // s16 is truncated, so that the error can be 1 LSB more than rounding
+        options.float_ = {1.0e-5, 110.0, 1.0};
+        options.integer_ = {3.0 / 32768.0, 70.0, 1.0};
+        options.fixed_ = {5.0 / 32768.0, 70.0, 7.0};
+        options.ratio_ = {3.0 / 32768.0, 70.0, 3.0};
+        options.maxTHDN_ = -30.0;
+        options.thdnFloor_ = -120.0;
+        options.verbose_ = false;
+        struct Flag
+        {
+            const char* name_;
+            f64* value_;
+        };
+        const Flag flags[] = {
+            {"--max_error=", &options.float_.maxError_},
+            {"--min_snr=", &options.float_.minSNR_},
+            {"--thdn_margin=", &options.float_.thdnMargin_},
+            {"--s16_max_error=", &options.integer_.maxError_},
+            {"--s16_min_snr=", &options.integer_.minSNR_},
+            {"--s16_thdn_margin=", &options.integer_.thdnMargin_},
+            {"--fixed_max_error=", &options.fixed_.maxError_},
+            {"--fixed_min_snr=", &options.fixed_.minSNR_},
+            {"--fixed_thdn_margin=", &options.fixed_.thdnMargin_},
+            {"--ratio_max_error=", &options.ratio_.maxError_},
+            {"--ratio_min_snr=", &options.ratio_.minSNR_},
+            {"--ratio_thdn_margin=", &options.ratio_.thdnMargin_},
+            {"--max_thdn=", &options.maxTHDN_},
+            {"--thdn_floor=", &options.thdnFloor_},
+        };
+        for(int i = 1; i < argc; ++i) {
+            if(0 == strcmp(argv[i], "--verbose")) {
+                options.verbose_ = true;
+                continue;
+            }
+            bool found = false;
+            for(const Flag& flag: flags) {
+                size_t length = strlen(flag.name_);
+                if(0 == strncmp(argv[i], flag.name_, length)) {
+                    *flag.value_ = atof(argv[i] + length);
+                    found = true;
+                    break;
+                }
+            }
+            if(!found) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void print_usage()
+    {
+        printf("usage: resamcpp_quality [--verbose] [--max_error=<x>] [--min_snr=<dB>] [--thdn_margin=<dB>]\n"
+               "                        [--s16_max_error=<x>] [--s16_min_snr=<dB>] [--s16_thdn_margin=<dB>] [--max_thdn=<dB>]\n"
+               "                        [--fixed_max_error=<x>] [--fixed_min_snr=<dB>] [--fixed_thdn_margin=<dB>]\n"
+               "                        [--ratio_max_error=<x>] [--ratio_min_snr=<dB>] [--ratio_thdn_margin=<dB>] [--thdn_floor=<dB>]\n");
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parse(options, argc, argv)) {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<Resampler::Kernel> kernels;
+    kernels.push_back(Resampler::Kernel::Scalar);
+    {
+        Resampler::Kernel candidates[] = {Resampler::Kernel::AVX2, Resampler::Kernel::AVX512, Resampler::Kernel::NEON};
+        Resampler probe = Resampler::initialize(44100, 48000);
+        for(Resampler::Kernel kernel: candidates) {
+            if(probe.set_kernel(kernel)) {
+                kernels.push_back(kernel);
+            }
+        }
+    }
+    const Path paths[] = {Path::RunS16, Path::RunF32, Path::Parallel, Path::Planar, Path::Stream, Path::ISPC, Path::Fixed, Path::FixedStream, Path::StreamRatio, Path::Quantized, Path::QuantizedStream};
+    const Resampler::Phase phases[] = {Resampler::Phase::Linear, Resampler::Phase::Minimum};
+
+    printf("%-36s %-14s %-5s %12s %10s %10s %10s\n", "variant", "ratio", "qual", "max error", "SNR(dB)", "THD+N(dB)", "ref(dB)");
+    u32 failures = 0;
+    u32 count = 0;
+    Signal sweep;
+    Signal tone;
+    std::vector<f64> expectedSweep;
+    std::vector<f64> expectedRatioSweep;
+    std::vector<f64> result;
+    for(const Ratio& ratio: Ratios) {
+        for(const Design& design: Designs) {
+            for(Resampler::Phase phase: phases) {
+                Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, design.design_, phase);
+                // Minimum phase needs a polyphase bank
+                if(!resampler.valid()) {
+                    continue;
+                }
+                bool linear = Resampler::Phase::Linear == phase;
+                u32 srcFrames = static_cast<u32>(ratio.src_ * SignalSeconds);
+                u32 dstFrames = static_cast<u32>(resampler.output_frames(srcFrames));
+                // Skip the output frames, whose window is clipped at the edges
+                u32 guard = static_cast<u32>(static_cast<u64>(resampler.window()) * ratio.dst_ / ratio.src_) + 1;
+                // The delay of a block conversion is the latency without the lookahead, which only a stream waits for
+                f64 delay = resampler.input_latency() - resampler.lookahead();
+                for(u32 channels: Channels) {
+                    make_sweep(sweep, ratio.src_, channels, srcFrames);
+                    make_tone(tone, ratio.src_, channels, srcFrames);
+                    reference(expectedSweep, resampler, ratio, sweep.samples_, channels, srcFrames, dstFrames);
+                    f64 floatTHDN;
+                    f64 integerTHDN;
+                    reference_thdn(floatTHDN, integerTHDN, resampler, ratio, tone, dstFrames, guard);
+                    // A variable ratio interpolates the table of the design instead of a Nyquist filter
+                    bool nyquist = resampler.ratio_filter().filter_ != resampler.filter().filter_;
+                    f64 ratioFloatTHDN = floatTHDN;
+                    f64 ratioIntegerTHDN = integerTHDN;
+                    if(nyquist) {
+                        RatioTable table = {resampler};
+                        reference(expectedRatioSweep, table, ratio, sweep.samples_, channels, srcFrames, dstFrames);
+                        reference_thdn(ratioFloatTHDN, ratioIntegerTHDN, table, ratio, tone, dstFrames, guard);
+                    }
+
+                    for(Resampler::Kernel kernel: kernels) {
+                        resampler.set_kernel(kernel);
+                        for(Path path: paths) {
+                            // ISPC does not depend on the kernel
+                            if(Path::ISPC == path && Resampler::Kernel::Scalar != kernel) {
+                                continue;
+                            }
+                            // A variable ratio needs the linear phase table
+                            if((Path::StreamRatio == path || is_quantized(path)) && !linear) {
+                                continue;
+                            }
+                            // run takes the rows of a bank instead of quantized phases
+                            if(Path::Quantized == path && RESAMCPP_NULL != resampler.bank()) {
+                                continue;
+                            }
+                            // The finer bins of downsampling may not fit in the cache
+                            if(is_quantized(path) && !resampler.set_phase_bits(resampler.required_phase_bits(QuantizedSNR))) {
+                                continue;
+                            }
+                            // Fixed point needs a polyphase bank
+                            if(is_fixed(path) && !resampler.set_fixed_point(true)) {
+                                continue;
+                            }
+                            char name[64];
+                            snprintf(name, sizeof(name), "%s/%s/%uch%s", path_name(path), Resampler::kernel_name(kernel), channels, linear ? "" : "/min");
+                            bool variable = Path::StreamRatio == path || Path::QuantizedStream == path;
+                            Metrics metrics = {};
+                            bool ok = process(result, path, resampler, sweep, dstFrames);
+                            compare(metrics, result, (variable && nyquist) ? expectedRatioSweep : expectedSweep);
+                            ok = process(result, path, resampler, tone, dstFrames) && ok;
+                            metrics.thdn_ = thdn(result, channels, dstFrames, ratio.dst_, guard);
+                            if(Path::RunF32 == path && MaxDelayError < fabs(tone_delay(result, channels, dstFrames, ratio, guard) - delay)) {
+                                printf("%s %u->%u %s: the tone is delayed by %.3f, not %.3f frames\n", name, ratio.src_, ratio.dst_, design.name_, tone_delay(result, channels, dstFrames, ratio, guard), delay);
+                                ok = false;
+                            }
+                            // Absolute checks, which do not depend on the reference
+                            if(Path::RunF32 == path) {
+                                f64 gain = tone_gain(result, channels, dstFrames, ratio.dst_, guard);
+                                f64 toneSNR = linear ? tone_snr(result, channels, dstFrames, ratio, delay, guard) : MinToneSNR;
+                                if(MaxGainError < fabs(gain - 1.0) || toneSNR < MinToneSNR) {
+                                    printf("%s %u->%u %s: the gain of the tone is %.5f, its SNR to the exact sine is %.2f dB\n", name, ratio.src_, ratio.dst_, design.name_, gain, toneSNR);
+                                    ok = false;
+                                }
+                            }
+                            resampler.set_fixed_point(false);
+                            resampler.set_phase_bits(0);
+                            ++count;
+                            const Threshold& threshold = is_fixed(path) ? options.fixed_ : ((Path::StreamRatio == path || is_quantized(path)) ? options.ratio_ : (is_integer(path) ? options.integer_ : options.float_));
+                            if(!judge(options, name, ratio, design.name_, threshold, is_integer(path), ok, metrics, variable ? ratioFloatTHDN : floatTHDN, variable ? ratioIntegerTHDN : integerTHDN)) {
+                                ++failures;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for(const Ratio& ratio: CascadeRatios) {
+        for(const Design& design: Designs) {
+            Cascade cascade = Cascade::initialize(ratio.src_, ratio.dst_, design.design_);
+            u32 srcFrames = static_cast<u32>(ratio.src_ * SignalSeconds);
+            u32 dstFrames = static_cast<u32>(cascade.output_frames(srcFrames));
+            // Every stage clips its filter at the edges, count their taps at the frequency of the last stage
+            u64 reach = cascade.resampler().window();
+            for(u32 s = 0; s < cascade.stages(); ++s) {
+                reach += cascade.taps(s);
+            }
+            u32 guard = static_cast<u32>(reach * (static_cast<u64>(ratio.dst_) << cascade.stages()) / ratio.src_) + 1;
+            for(u32 channels: Channels) {
+                make_sweep(sweep, ratio.src_, channels, srcFrames);
+                make_tone(tone, ratio.src_, channels, srcFrames);
+                reference(expectedSweep, cascade, ratio, sweep.samples_, channels, srcFrames, dstFrames);
+                f64 floatTHDN;
+                f64 integerTHDN;
+                reference_thdn(floatTHDN, integerTHDN, cascade, ratio, tone, dstFrames, guard);
+
+                for(Resampler::Kernel kernel: kernels) {
+                    cascade.resampler().set_kernel(kernel);
+                    for(u32 integer = 0; integer < 2; ++integer) {
+                        char name[64];
+                        snprintf(name, sizeof(name), "cascade/%s/%s/%uch", integer ? "s16" : "f32", Resampler::kernel_name(kernel), channels);
+                        Metrics metrics = {};
+                        bool ok = process(result, 0 != integer, cascade, sweep, dstFrames);
+                        compare(metrics, result, expectedSweep);
+                        ok = process(result, 0 != integer, cascade, tone, dstFrames) && ok;
+                        metrics.thdn_ = thdn(result, channels, dstFrames, ratio.dst_, guard);
+                        // The stages of a block conversion do not delay the tone
+                        if(0 == integer) {
+                            f64 gain = tone_gain(result, channels, dstFrames, ratio.dst_, guard);
+                            f64 toneSNR = tone_snr(result, channels, dstFrames, ratio, 0.0, guard);
+                            if(MaxGainError < fabs(gain - 1.0) || toneSNR < MinToneSNR) {
+                                printf("%s %u->%u %s: the gain of the tone is %.5f, its SNR to the exact sine is %.2f dB\n", name, ratio.src_, ratio.dst_, design.name_, gain, toneSNR);
+                                ok = false;
+                            }
+                        }
+                        ++count;
+                        const Threshold& threshold = (0 != integer) ? options.integer_ : options.float_;
+                        if(!judge(options, name, ratio, design.name_, threshold, 0 != integer, ok, metrics, floatTHDN, integerTHDN)) {
+                            ++failures;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for(const Ratio& ratio: Ratios) {
+        for(const Design& design: Designs) {
+            Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, design.design_);
+            u32 srcFrames = static_cast<u32>(ratio.src_ * SignalSeconds);
+            // Pulls do not flush, the outputs need their whole window
+            u32 dstFrames = static_cast<u32>(resampler.output_frames(srcFrames - resampler.lookahead()));
+            u32 guard = static_cast<u32>(static_cast<u64>(resampler.window()) * ratio.dst_ / ratio.src_) + 1;
+            make_sweep(sweep, ratio.src_, RealtimeChannels, srcFrames);
+            make_tone(tone, ratio.src_, RealtimeChannels, srcFrames);
+            reference(expectedSweep, resampler, ratio, sweep.samples_, RealtimeChannels, srcFrames, dstFrames);
+            f64 floatTHDN;
+            f64 integerTHDN;
+            reference_thdn(floatTHDN, integerTHDN, resampler, ratio, tone, dstFrames, guard);
+
+            char name[64];
+            snprintf(name, sizeof(name), "realtime/s16/%uch", RealtimeChannels);
+            Metrics metrics = {};
+            bool ok = process(result, resampler, sweep, dstFrames);
+            compare(metrics, result, expectedSweep);
+            ok = process(result, resampler, tone, dstFrames) && ok;
+            metrics.thdn_ = thdn(result, RealtimeChannels, dstFrames, ratio.dst_, guard);
+            ++count;
+            if(!judge(options, name, ratio, design.name_, options.integer_, true, ok, metrics, floatTHDN, integerTHDN)) {
+                ++failures;
+            }
+        }
+    }
+
+    for(const Ratio& ratio: EngineRatios) {
+        for(u32 q = 0; q < 2; ++q) {
+            Resampler::Quality quality = (0 == q) ? Resampler::Quality::Fast : Resampler::Quality::Best;
+            const char* qualityName = (0 == q) ? "fast" : "best";
+            Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, quality);
+            u32 srcFrames = static_cast<u32>(ratio.src_ * SignalSeconds);
+            // The engine does not flush, the outputs need their whole window
+            u32 dstFrames = static_cast<u32>(resampler.output_frames(srcFrames - resampler.lookahead()));
+            u32 guard = static_cast<u32>(static_cast<u64>(resampler.window()) * ratio.dst_ / ratio.src_) + 1;
+            make_sweep(sweep, ratio.src_, EngineStreams, srcFrames);
+            make_tone(tone, ratio.src_, EngineStreams, srcFrames);
+            reference(expectedSweep, resampler, ratio, sweep.samples_, EngineStreams, srcFrames, dstFrames);
+            f64 floatTHDN;
+            f64 integerTHDN;
+            reference_thdn(floatTHDN, integerTHDN, resampler, ratio, tone, dstFrames, guard);
+
+            char name[64];
+            snprintf(name, sizeof(name), "engine/s16/%ustreams", EngineStreams);
+            Metrics metrics = {};
+            bool ok = process(result, ratio, quality, sweep, dstFrames);
+            compare(metrics, result, expectedSweep);
+            ok = process(result, ratio, quality, tone, dstFrames) && ok;
+            metrics.thdn_ = thdn(result, EngineStreams, dstFrames, ratio.dst_, guard);
+            ++count;
+            if(!judge(options, name, ratio, qualityName, options.integer_, true, ok, metrics, floatTHDN, integerTHDN)) {
+                ++failures;
+            }
+        }
+    }
+
+    for(const Ratio& ratio: DriftRatios) {
+        for(u32 q = 0; q < 2; ++q) {
+            Resampler::Quality quality = (0 == q) ? Resampler::Quality::Fast : Resampler::Quality::Best;
+            Resampler resampler = Resampler::initialize(ratio.src_, ratio.dst_, quality);
+            // The drift is as good as a resampler of the drifted ratio, which interpolates the table of the design
+            Ratio drifted = {ratio.src_, ratio.dst_ + ratio.dst_ / DriftDivisor};
+            Resampler expected = Resampler::initialize(drifted.src_, drifted.dst_, quality);
+            u32 srcFrames = static_cast<u32>(ratio.src_ * SignalSeconds);
+            u32 dstFrames = static_cast<u32>(expected.output_frames(srcFrames));
+            // The tenth at either edge covers the wings of any table
+            u32 guard = dstFrames / 10;
+            make_tone(tone, ratio.src_, 1, srcFrames);
+            f64 floatTHDN;
+            f64 integerTHDN;
+            reference_thdn(floatTHDN, integerTHDN, expected, drifted, tone, dstFrames, guard);
+            f64 driftTHDN = drift_thdn(resampler, tone, drifted.dst_, guard);
+            f64 allowedTHDN = ((integerTHDN < options.thdnFloor_) ? options.thdnFloor_ : integerTHDN) + options.ratio_.thdnMargin_;
+            bool passed = driftTHDN <= allowedTHDN && driftTHDN <= options.maxTHDN_;
+            ++count;
+            if(!passed) {
+                ++failures;
+            }
+            if(!passed || options.verbose_) {
+                char ratioName[32];
+                snprintf(ratioName, sizeof(ratioName), "%u->%u", ratio.src_, ratio.dst_);
+                printf("%-36s %-14s %-5s %12s %10s %10.2f %10.2f %s\n", "stream_drift/s16/1ch", ratioName, (0 == q) ? "fast" : "best", "-", "-", driftTHDN, integerTHDN, passed ? "ok" : "FAILED");
+            }
+        }
+    }
+
+    bool batched = check_batch();
+    ++count;
+    if(!batched) {
+        ++failures;
+    }
+    if(!batched || options.verbose_) {
+        printf("%-36s %s\n", "batch/f32", batched ? "ok" : "FAILED");
+    }
+
+    bool unsupported = check_unsupported();
+    ++count;
+    if(!unsupported) {
+        ++failures;
+    }
+    if(!unsupported || options.verbose_) {
+        printf("%-36s %s\n", "unsupported", unsupported ? "ok" : "FAILED");
+    }
+
+    bool counted = check_statistics();
+    ++count;
+    if(!counted) {
+        ++failures;
+    }
+    if(!counted || options.verbose_) {
+        printf("%-36s %s\n", Resampler::Statistics::Enabled ? "statistics" : "statistics/disabled", counted ? "ok" : "FAILED");
+    }
+    printf("%u of %u variants passed\n", count - failures, count);
+    return (0 == failures) ? 0 : 1;
+}
@@ -24,15 +24,55 @@ ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
 OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 #include "resamcpp.h"
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#    define RESAMCPP_X86
+#    include <immintrin.h>
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#        define RESAMCPP_TARGET_AVX2
+#        define RESAMCPP_TARGET_AVX512
+#    else
+#        include <cpuid.h>
+#        define RESAMCPP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#        define RESAMCPP_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#    endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define RESAMCPP_NEON
+#    include <arm_neon.h>
+#endif
 
 #ifdef RESAMCPP_ISPC
 #include "resamcpp.ispc.h"
 #endif
 
+#ifdef RESAMCPP_WAV
+#    ifdef _WIN32
+#        ifndef NOMINMAX
+#            define NOMINMAX
+#        endif
+#        ifndef WIN32_LEAN_AND_MEAN
+#            define WIN32_LEAN_AND_MEAN
+#        endif
+#        include <windows.h>
+#    else
+#        include <fcntl.h>
+#        include <sys/mman.h>
+#        include <sys/stat.h>
+#        include <unistd.h>
+#    endif
+#endif
+
 namespace resamcpp
 {
 namespace
@@ -62,18 +102,39 @@ namespace
     }
 
 #ifdef RESAMCPP_WAV
-    bool read_fmt(WAVE& wave, FILE* file)
+    constexpr u32 FormatExtension = 10; //!< cbSize, wValidBitsPerSample, dwChannelMask, and the first 2 bytes of SubFormat
+
+    /**
+    @brief Whether a frame is exactly channels samples of bitsPerSample, readers and writers step the data by blockAlign
+    */
+    inline bool valid_block_align(const FMT& format)
+    {
+        return 0 < format.blockAlign_ && format.blockAlign_ == format.channels_ * (format.bitsPerSample_ / 8U);
+    }
+
+    /**
+    @brief Parse the first size bytes of a fmt chunk, the format of WAVE_FORMAT_EXTENSIBLE is the one of its SubFormat
+    */
+    bool parse_fmt(FMT& format, const u8* chunk, u32 size)
     {
-        if(fread(&wave.format_, sizeof(FMT), 1, file) <= 0) {
+        if(size < sizeof(FMT)) {
             return false;
         }
-        if(1 != wave.format_.format_) {
+        ::memcpy(&format, chunk, sizeof(FMT));
+        if(FMT::Format_Extensible == format.format_) {
+            if(size < sizeof(FMT) + FormatExtension) {
+                return false;
+            }
+            const u8* extension = chunk + sizeof(FMT);
+            format.format_ = static_cast<u16>(extension[8] | (extension[9] << 8));
+        }
+        if(FMT::Format_PCM != format.format_) {
             return false;
         }
-        if(wave.format_.channels_ <= 0 || 2 < wave.format_.channels_) {
+        if(format.channels_ <= 0 || Resampler::MaxChannels < format.channels_) {
             return false;
         }
-        switch(wave.format_.bitsPerSample_) {
+        switch(format.bitsPerSample_) {
         case 8:
         case 16:
         case 24:
@@ -82,28 +143,276 @@ namespace
         default:
             return false;
         }
-        return true;
+        return valid_block_align(format);
+    }
+
+    //--- RF64, which moves the sizes over 4 GB to a ds64 chunk right after the header
+    constexpr u32 RF64ID = 0x34364652U;
+    constexpr u32 JunkID = 0x4B4E554AU;
+    constexpr u32 SizeOverflow = 0xFFFFFFFFU; //!< the 32 bit size of a chunk, whose size is in the ds64 chunk
+
+    /**
+    @brief A ds64 chunk without its table, the 64 bit sizes are split to keep the 28 bytes layout
+    */
+    struct DS64
+    {
+        static constexpr u32 ID = 0x34367364U;
+        u32 riffSize_[2];
+        u32 dataSize_[2];
+        u32 sampleCount_[2];
+        u32 tableLength_;
+    };
+
+    inline u64 join(const u32 x[2])
+    {
+        return x[0] | (static_cast<u64>(x[1]) << 32);
+    }
+
+    inline void split(u32 x[2], u64 value)
+    {
+        x[0] = static_cast<u32>(value);
+        x[1] = static_cast<u32>(value >> 32);
+    }
+
+    //--- 64 bit file offsets
+    bool seek(FILE* file, s64 offset, int origin)
+    {
+#    ifdef _WIN32
+        return 0 == _fseeki64(file, offset, origin);
+#    else
+        return 0 == fseeko(file, static_cast<off_t>(offset), origin);
+#    endif
+    }
+
+    s64 tell(FILE* file)
+    {
+#    ifdef _WIN32
+        return _ftelli64(file);
+#    else
+        return static_cast<s64>(ftello(file));
+#    endif
     }
 
-    bool read_data(WAVE& wave, u64 chunkSize, FILE* file)
+    /**
+    @brief Skip the rest of a chunk and its padding to an even size
+    */
+    bool skip(FILE* file, u64 rest, u64 chunkSize)
     {
-        u64 bytesPerSec = wave.format_.frequency_ * wave.format_.blockAlign_;
-        if(bytesPerSec <= 0) {
+        return seek(file, static_cast<s64>(rest + (chunkSize & 1U)), SEEK_CUR);
+    }
+
+    bool read_fmt(FMT& format, u32 chunkSize, FILE* file)
+    {
+        u8 chunk[sizeof(FMT) + FormatExtension];
+        u32 size = minimum(chunkSize, static_cast<u32>(sizeof(chunk)));
+        if(fread(chunk, size, 1, file) <= 0) {
             return false;
         }
-        u64 numSamples = static_cast<u64>(static_cast<f64>(chunkSize) / bytesPerSec * wave.format_.frequency_);
-        u64 size = numSamples * wave.format_.blockAlign_;
-        wave.data_ = reinterpret_cast<u8*>(::malloc(size));
-        if(RESAMCPP_NULL == wave.data_) {
+        if(!skip(file, chunkSize - size, chunkSize)) {
             return false;
         }
-        if(fread(wave.data_, size, 1, file) <= 0) {
-            ::free(wave.data_);
+        return parse_fmt(format, chunk, size);
+    }
+
+    bool read_ds64(u64& dataSize, u32 chunkSize, FILE* file)
+    {
+        DS64 ds64;
+        if(chunkSize < sizeof(DS64) || fread(&ds64, sizeof(DS64), 1, file) <= 0) {
             return false;
         }
-        wave.numSamples_ = numSamples;
-        return true;
+        dataSize = join(ds64.dataSize_);
+        return skip(file, chunkSize - sizeof(DS64), chunkSize);
+    }
+
+    /**
+    @brief Ask the kernel to read a range of a file in the background
+    */
+    void read_ahead(FILE* file, u64 offset, u64 size)
+    {
+#    ifdef POSIX_FADV_WILLNEED
+        ::posix_fadvise(fileno(file), static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+#    else
+        (void)file;
+        (void)offset;
+        (void)size;
+#    endif
+    }
+
+    //--- Whole file mappings, which stay valid after the file is closed
+#    ifdef _WIN32
+    u8* map_file(const char* filepath, u64& size)
+    {
+        HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, RESAMCPP_NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, RESAMCPP_NULL);
+        if(INVALID_HANDLE_VALUE == file) {
+            return RESAMCPP_NULL;
+        }
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+            CloseHandle(file);
+            return RESAMCPP_NULL;
+        }
+        HANDLE mapping = CreateFileMappingA(file, RESAMCPP_NULL, PAGE_WRITECOPY, 0, 0, RESAMCPP_NULL);
+        CloseHandle(file);
+        if(RESAMCPP_NULL == mapping) {
+            return RESAMCPP_NULL;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        CloseHandle(mapping);
+        size = static_cast<u64>(fileSize.QuadPart);
+        return reinterpret_cast<u8*>(view);
+    }
+
+    u8* create_file(const char* filepath, u64 size)
+    {
+        HANDLE file = CreateFileA(filepath, GENERIC_READ | GENERIC_WRITE, 0, RESAMCPP_NULL, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, RESAMCPP_NULL);
+        if(INVALID_HANDLE_VALUE == file) {
+            return RESAMCPP_NULL;
+        }
+        // The mapping extends the file to its size
+        HANDLE mapping = CreateFileMappingA(file, RESAMCPP_NULL, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), RESAMCPP_NULL);
+        CloseHandle(file);
+        if(RESAMCPP_NULL == mapping) {
+            return RESAMCPP_NULL;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+        CloseHandle(mapping);
+        return reinterpret_cast<u8*>(view);
+    }
+
+    void unmap_file(void* mapping, u64)
+    {
+        UnmapViewOfFile(mapping);
+    }
+#    else
+    u8* map_file(const char* filepath, u64& size)
+    {
+        int file = ::open(filepath, O_RDONLY);
+        if(file < 0) {
+            return RESAMCPP_NULL;
+        }
+        struct stat status;
+        if(0 != ::fstat(file, &status) || status.st_size <= 0) {
+            ::close(file);
+            return RESAMCPP_NULL;
+        }
+        // Private and writable, so that data_ can be modified without touching the file
+        void* mapping = ::mmap(RESAMCPP_NULL, static_cast<size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if(MAP_FAILED == mapping) {
+            return RESAMCPP_NULL;
+        }
+        size = static_cast<u64>(status.st_size);
+        ::madvise(mapping, static_cast<size_t>(size), MADV_SEQUENTIAL);
+        return reinterpret_cast<u8*>(mapping);
+    }
+
+    u8* create_file(const char* filepath, u64 size)
+    {
+        int file = ::open(filepath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(file < 0) {
+            return RESAMCPP_NULL;
+        }
+        // Reserve the blocks up front, so that a full disk fails here instead of in a page fault
+#        ifdef __linux__
+        bool allocated = 0 == ::posix_fallocate(file, 0, static_cast<off_t>(size));
+#        else
+        bool allocated = 0 == ::ftruncate(file, static_cast<off_t>(size));
+#        endif
+        if(!allocated) {
+            ::close(file);
+            return RESAMCPP_NULL;
+        }
+        void* mapping = ::mmap(RESAMCPP_NULL, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        ::close(file);
+        if(MAP_FAILED == mapping) {
+            return RESAMCPP_NULL;
+        }
+        ::madvise(mapping, static_cast<size_t>(size), MADV_SEQUENTIAL);
+        return reinterpret_cast<u8*>(mapping);
+    }
+
+    void unmap_file(void* mapping, u64 size)
+    {
+        ::munmap(mapping, static_cast<size_t>(size));
+    }
+#    endif
+
+    /**
+    @brief The bytes to the next chunk, which is padded to an even size, the pad of the last chunk may be missing
+    */
+    inline u64 chunk_step(u32 size, u64 rest)
+    {
+        return minimum(static_cast<u64>(size) + (size & 1U), rest);
+    }
+
+    /**
+    @brief Walk the chunks of a mapped file until the data chunk, which needs a fmt chunk before it
+    */
+    bool parse_wave(WAVE& wave, u8* bytes, u64 size)
+    {
+        u64 offset = 0;
+        bool format = false;
+        bool rf64 = false;
+        u64 dataSize = 0;
+        while(offset + sizeof(HEAD) <= size) {
+            HEAD head;
+            ::memcpy(&head, bytes + offset, sizeof(HEAD));
+            offset += sizeof(HEAD);
+            u64 rest = size - offset;
+            switch(head.id_) {
+            case RIFF::ID:
+            case RF64ID: {
+                RIFF riff;
+                if(rest < sizeof(RIFF)) {
+                    return false;
+                }
+                ::memcpy(&riff, bytes + offset, sizeof(RIFF));
+                if(riff.format_ != RIFF::Format_Wave) {
+                    return false;
+                }
+                rf64 = RF64ID == head.id_;
+                offset += sizeof(RIFF);
+            } break;
+            case DS64::ID: {
+                DS64 ds64;
+                if(rest < head.size_ || head.size_ < sizeof(DS64)) {
+                    return false;
+                }
+                ::memcpy(&ds64, bytes + offset, sizeof(DS64));
+                dataSize = join(ds64.dataSize_);
+                offset += chunk_step(head.size_, rest);
+            } break;
+            case FMT::ID:
+                if(rest < head.size_ || !parse_fmt(wave.format_, bytes + offset, head.size_)) {
+                    return false;
+                }
+                format = true;
+                offset += chunk_step(head.size_, rest);
+                break;
+            case DATA::ID:
+                if(!format) {
+                    return false;
+                }
+                // A truncated file keeps the frames it has
+                if(!rf64 || SizeOverflow != head.size_) {
+                    dataSize = head.size_;
+                }
+                wave.numSamples_ = minimum(dataSize, rest) / wave.format_.blockAlign_;
+                wave.data_ = bytes + offset;
+                return true;
+            default:
+                // Skip unknown chunks, which are padded to even sizes
+                if(rest < head.size_) {
+                    return false;
+                }
+                offset += chunk_step(head.size_, rest);
+                break;
+            }
+        }
+        return false;
     }
+
+    constexpr u64 HeaderSize = sizeof(HEAD) + sizeof(RIFF) + sizeof(HEAD) + sizeof(FMT) + sizeof(HEAD);
 #endif
 }
 
@@ -115,36 +424,82 @@ bool WAVE::valid() const
 
 WAVE load(const char* filepath)
 {
-    RESAMCPP_ASSERT(RESAMCPP_NULL != filepath);
     WAVE wave = {};
-    FILE* file = fopen(filepath, "rb");
-    if(RESAMCPP_NULL == file) {
+    WaveReader reader = WaveReader::initialize(filepath);
+    if(!reader.valid()) {
         return wave;
     }
-    bool loop = true;
-    while(loop) {
-        HEAD head;
-        if(fread(&head, sizeof(HEAD), 1, file) <= 0) {
-            break;
-        }
-        switch(head.id_) {
-        case RIFF::ID: {
-            RIFF riff;
-            if(fread(&riff, sizeof(RIFF), 1, file) <= 0 || riff.format_ != RIFF::Format_Wave) {
-                loop = false;
-            }
-        } break;
-        case FMT::ID:
-            if(!read_fmt(wave, file)) {
-                loop = false;
-            }
-            break;
-        case DATA::ID:
-            read_data(wave, head.size_, file);
+    u64 size = reader.frames() * reader.format().blockAlign_;
+    wave.data_ = reinterpret_cast<u8*>(::malloc(size));
+    if(RESAMCPP_NULL == wave.data_) {
+        return wave;
+    }
+    // Read in blocks, which fit in u32 frames
+    u64 frames = 0;
+    while(frames < reader.frames()) {
+        u32 count = static_cast<u32>(minimum<u64>(reader.frames() - frames, 1U << 24));
+        u32 read = reader.read(wave.data_ + frames * reader.format().blockAlign_, count);
+        if(read <= 0) {
             break;
         }
+        frames += read;
     }
-    fclose(file);
+    if(frames <= 0) {
+        ::free(wave.data_);
+        return {};
+    }
+    wave.format_ = reader.format();
+    wave.numSamples_ = frames;
+    return wave;
+}
+
+WAVE map(const char* filepath)
+{
+    RESAMCPP_ASSERT(RESAMCPP_NULL != filepath);
+    WAVE wave = {};
+    u64 size = 0;
+    u8* mapping = map_file(filepath, size);
+    if(RESAMCPP_NULL == mapping) {
+        return wave;
+    }
+    if(!parse_wave(wave, mapping, size)) {
+        unmap_file(mapping, size);
+        return {};
+    }
+    wave.mapping_ = mapping;
+    wave.mappingSize_ = size;
+    return wave;
+}
+
+WAVE create(const char* filepath, const FMT& format, u64 numSamples)
+{
+    RESAMCPP_ASSERT(RESAMCPP_NULL != filepath);
+    WAVE wave = {};
+    u64 dataSize = numSamples * format.blockAlign_;
+    u64 totalSize = HeaderSize + dataSize + (dataSize & 1U);
+    if(!valid_block_align(format) || 0xFFFFFFFFULL < totalSize - sizeof(HEAD)) {
+        return wave;
+    }
+    u8* mapping = create_file(filepath, totalSize);
+    if(RESAMCPP_NULL == mapping) {
+        return wave;
+    }
+    u8* bytes = mapping;
+    HEAD head = {RIFF::ID, static_cast<u32>(totalSize - sizeof(HEAD))};
+    RIFF riff = {RIFF::Format_Wave};
+    ::memcpy(bytes, &head, sizeof(HEAD));
+    ::memcpy(bytes += sizeof(HEAD), &riff, sizeof(RIFF));
+    head = {FMT::ID, sizeof(FMT)};
+    ::memcpy(bytes += sizeof(RIFF), &head, sizeof(HEAD));
+    ::memcpy(bytes += sizeof(HEAD), &format, sizeof(FMT));
+    head = {DATA::ID, static_cast<u32>(dataSize)};
+    ::memcpy(bytes += sizeof(FMT), &head, sizeof(HEAD));
+
+    wave.format_ = format;
+    wave.numSamples_ = numSamples;
+    wave.data_ = mapping + HeaderSize;
+    wave.mapping_ = mapping;
+    wave.mappingSize_ = totalSize;
     return wave;
 }
 
@@ -208,330 +563,4867 @@ bool save(const char* filepath, const WAVE& wave)
 
 void destroy(WAVE& wave)
 {
-    ::free(wave.data_);
+    if(RESAMCPP_NULL != wave.mapping_) {
+        unmap_file(wave.mapping_, wave.mappingSize_);
+    } else {
+        ::free(wave.data_);
+    }
     wave = {};
 }
-#endif
 
-namespace
+//--- WaveReader
+WaveReader WaveReader::initialize(const char* filepath, u32 readAhead)
 {
-    // clang-format off
-const f32 KaiserFast[129] = {
-static_cast<f32>(8.499999999999999778e-01), static_cast<f32>(8.340987492996022601e-01), static_cast<f32>(7.874817237653068958e-01), static_cast<f32>(7.133193033383873338e-01), static_cast<f32>(6.166043268285958945e-01), 
-static_cast<f32>(5.037433166021544340e-01), static_cast<f32>(3.820372263464146823e-01), static_cast<f32>(2.590985046736161701e-01), static_cast<f32>(1.422564402710740916e-01), static_cast<f32>(3.800295451106208006e-02), 
-static_cast<f32>(-4.847372103729211124e-02), static_cast<f32>(-1.136291666718088900e-01), static_cast<f32>(-1.557509303598278994e-01), static_cast<f32>(-1.749836375038000824e-01), static_cast<f32>(-1.731953173923218847e-01), 
-static_cast<f32>(-1.537036940871576440e-01), static_cast<f32>(-1.208934245372049604e-01), static_cast<f32>(-7.976412029183363450e-02), static_cast<f32>(-3.545370033507769247e-02), static_cast<f32>(7.218130935140766591e-03), 
-static_cast<f32>(4.414556740837451143e-02), static_cast<f32>(7.223867270033920707e-02), static_cast<f32>(8.960943455800829405e-02), static_cast<f32>(9.563201636348074575e-02), static_cast<f32>(9.087998722109594252e-02), 
-static_cast<f32>(7.695504462429837711e-02), static_cast<f32>(5.623140839303890359e-02), static_cast<f32>(3.154679043100863667e-02), static_cast<f32>(5.874102559630261372e-03), static_cast<f32>(-1.799229292857106727e-02), 
-static_cast<f32>(-3.770572504416478538e-02), static_cast<f32>(-5.156823341405535749e-02), static_cast<f32>(-5.864847727104856995e-02), static_cast<f32>(-5.881105487722142894e-02), static_cast<f32>(-5.266120135939462987e-02), 
-static_cast<f32>(-4.141724069001181258e-02), static_cast<f32>(-2.672972331521002165e-02), static_cast<f32>(-1.047031537124061551e-02), static_cast<f32>(5.485060242212602341e-03), static_cast<f32>(1.945557122818850418e-02), 
-static_cast<f32>(3.011765848698802484e-02), static_cast<f32>(3.661583043700127743e-02), static_cast<f32>(3.861439470272986368e-02), static_cast<f32>(3.628934265770055595e-02), static_cast<f32>(3.026606850360209072e-02), 
-static_cast<f32>(2.151397957521417395e-02), static_cast<f32>(1.121283449937531505e-02), static_cast<f32>(6.075351376112679514e-04), static_cast<f32>(-9.131971506857397211e-03), static_cast<f32>(-1.703090284533520862e-02), 
-static_cast<f32>(-2.239852931485096510e-02), static_cast<f32>(-2.487864735977438763e-02), static_cast<f32>(-2.445931918639121863e-02), static_cast<f32>(-2.144421750164015456e-02), static_cast<f32>(-1.639194208896666005e-02), 
-static_cast<f32>(-1.003267813416712333e-02), static_cast<f32>(-3.173289702308694851e-03), static_cast<f32>(3.397705844709149846e-03), static_cast<f32>(8.994786128505863343e-03), static_cast<f32>(1.310123931903916031e-02), 
-static_cast<f32>(1.541050714500104973e-02), static_cast<f32>(1.584062628205268677e-02), static_cast<f32>(1.452255100398716636e-02), static_cast<f32>(1.176599055529931916e-02), static_cast<f32>(8.008591740126264763e-03), 
-static_cast<f32>(3.755646844225439193e-03), static_cast<f32>(-4.820719909357170404e-04), static_cast<f32>(-4.245226718190729491e-03), static_cast<f32>(-7.171691423526290431e-03), static_cast<f32>(-9.027107848387670372e-03), 
-static_cast<f32>(-9.718231427821312149e-03), static_cast<f32>(-9.289215083550093899e-03), static_cast<f32>(-7.902898679639353691e-03), static_cast<f32>(-5.810677620555117044e-03), static_cast<f32>(-3.315479023215594026e-03), 
-static_cast<f32>(-7.327188196118433880e-04), static_cast<f32>(1.646134982188931150e-03), static_cast<f32>(3.583524252907699381e-03), static_cast<f32>(4.916548178484244497e-03), static_cast<f32>(5.567090551683547169e-03), 
-static_cast<f32>(5.541285202439585889e-03), static_cast<f32>(4.919509329994644319e-03), static_cast<f32>(3.839062505555647549e-03), static_cast<f32>(2.472306428511776046e-03), static_cast<f32>(1.003269972914902497e-03), 
-static_cast<f32>(-3.944218334981119977e-04), static_cast<f32>(-1.575901615452450933e-03), static_cast<f32>(-2.437999478735780341e-03), static_cast<f32>(-2.925892868627905964e-03), static_cast<f32>(-3.033424714598279264e-03), 
-static_cast<f32>(-2.797794983831996055e-03), static_cast<f32>(-2.289910505253298003e-03), static_cast<f32>(-1.602039425152251275e-03), static_cast<f32>(-8.345406859202779762e-04), static_cast<f32>(-8.333714043518143340e-05), 
-static_cast<f32>(5.704888225629115191e-04), static_cast<f32>(1.068019367697101629e-03), static_cast<f32>(1.376273363136831709e-03), static_cast<f32>(1.488439244534648645e-03), static_cast<f32>(1.421004750094861241e-03), 
-static_cast<f32>(1.208537707901302660e-03), static_cast<f32>(8.970581968601451040e-04), static_cast<f32>(5.369897668825879006e-04), static_cast<f32>(1.765972437756705923e-04), static_cast<f32>(-1.433631589483458076e-04), 
-static_cast<f32>(-3.933036154236073238e-04), static_cast<f32>(-5.565710438726437529e-04), static_cast<f32>(-6.293798095637436309e-04), static_cast<f32>(-6.191903748303277319e-04), static_cast<f32>(-5.419678317269842381e-04), 
-static_cast<f32>(-4.188320791982775518e-04), static_cast<f32>(-2.726130127603548390e-04), static_cast<f32>(-1.247596248017244667e-04), static_cast<f32>(7.061196959677690653e-06), static_cast<f32>(1.104806275007797438e-04), 
-static_cast<f32>(1.790082307129259277e-04), static_cast<f32>(2.117564603983245635e-04), static_cast<f32>(2.124891944621316235e-04), static_cast<f32>(1.882350151771501211e-04), static_cast<f32>(1.477250981642127333e-04), 
-static_cast<f32>(9.989653268683285612e-05), static_cast<f32>(5.265291928215289936e-05), static_cast<f32>(1.200639590128984472e-05), static_cast<f32>(-1.834894346725894645e-05), static_cast<f32>(-3.705156545068235885e-05), 
-static_cast<f32>(-4.474961268482067833e-05), static_cast<f32>(-4.355089437696552183e-05), static_cast<f32>(-3.636981757389096982e-05), static_cast<f32>(-2.628865215979546915e-05), 
-};
-    // clang-format on
-
-    // clang-format off
-const f32 KaiserFastDiff[129] = {
-static_cast<f32>(-1.59012507003977177e-02), static_cast<f32>(-4.66170255342953643e-02), static_cast<f32>(-7.41624204269195619e-02), static_cast<f32>(-9.67149765097914393e-02), static_cast<f32>(-1.12861010226441461e-01), 
-static_cast<f32>(-1.21706090255739752e-01), static_cast<f32>(-1.22938721672798512e-01), static_cast<f32>(-1.16842064402542078e-01), static_cast<f32>(-1.04253485760012005e-01), static_cast<f32>(-8.64766755483541982e-02), 
-static_cast<f32>(-6.51554456345167787e-02), static_cast<f32>(-4.21217636880190094e-02), static_cast<f32>(-1.92327071439721831e-02), static_cast<f32>(1.78832011147819769e-03), static_cast<f32>(1.94916233051642407e-02), 
-static_cast<f32>(3.28102695499526836e-02), static_cast<f32>(4.11293042453713259e-02), static_cast<f32>(4.43104199567559420e-02), static_cast<f32>(4.26718312702184591e-02), static_cast<f32>(3.69274364732337448e-02), 
-static_cast<f32>(2.80931052919646956e-02), static_cast<f32>(1.73707618576690870e-02), static_cast<f32>(6.02258180547245170e-03), static_cast<f32>(-4.75202914238480323e-03), static_cast<f32>(-1.39249425967975654e-02), 
-static_cast<f32>(-2.07236362312594735e-02), static_cast<f32>(-2.46846179620302669e-02), static_cast<f32>(-2.56726878713783753e-02), static_cast<f32>(-2.38663954882013286e-02), static_cast<f32>(-1.97134321155937181e-02), 
-static_cast<f32>(-1.38625083698905721e-02), static_cast<f32>(-7.08024385699321246e-03), static_cast<f32>(-1.62577606172858991e-04), static_cast<f32>(6.14985351782679907e-03), static_cast<f32>(1.12439606693828173e-02), 
-static_cast<f32>(1.46875173748017909e-02), static_cast<f32>(1.62594079439694061e-02), static_cast<f32>(1.59553756134532196e-02), static_cast<f32>(1.39705109859759018e-02), static_cast<f32>(1.06620872587995207e-02), 
-static_cast<f32>(6.49817195001325260e-03), static_cast<f32>(1.99856426572858625e-03), static_cast<f32>(-2.32505204502930773e-03), static_cast<f32>(-6.02327415409846523e-03), static_cast<f32>(-8.75208892838791677e-03), 
-static_cast<f32>(-1.03011450758388589e-02), static_cast<f32>(-1.06052993617640479e-02), static_cast<f32>(-9.73950664446866440e-03), static_cast<f32>(-7.89893133847781141e-03), static_cast<f32>(-5.36762646951575648e-03), 
-static_cast<f32>(-2.48011804492342253e-03), static_cast<f32>(4.19328173383168995e-04), static_cast<f32>(3.01510168475106408e-03), static_cast<f32>(5.05227541267349450e-03), static_cast<f32>(6.35926395479953672e-03), 
-static_cast<f32>(6.85938843185842848e-03), static_cast<f32>(6.57099554701784470e-03), static_cast<f32>(5.59708028379671350e-03), static_cast<f32>(4.10645319053329697e-03), static_cast<f32>(2.30926782596188943e-03), 
-static_cast<f32>(4.30119137051637040e-04), static_cast<f32>(-1.31807527806552041e-03), static_cast<f32>(-2.75656044868784721e-03), static_cast<f32>(-3.75739881517305439e-03), static_cast<f32>(-4.25294489590082557e-03), 
-static_cast<f32>(-4.23771883516115607e-03), static_cast<f32>(-3.76315472725501261e-03), static_cast<f32>(-2.92646470533556094e-03), static_cast<f32>(-1.85541642486137994e-03), static_cast<f32>(-6.91123579433641777e-04), 
-static_cast<f32>(4.29016344271218250e-04), static_cast<f32>(1.38631640391074021e-03), static_cast<f32>(2.09222105908423665e-03), static_cast<f32>(2.49519859733952302e-03), static_cast<f32>(2.58276020360375053e-03), 
-static_cast<f32>(2.37885380180077443e-03), static_cast<f32>(1.93738927071876823e-03), static_cast<f32>(1.33302392557654512e-03), static_cast<f32>(6.50542373199302672e-04), static_cast<f32>(-2.58053492439612800e-05), 
-static_cast<f32>(-6.21775872444941570e-04), static_cast<f32>(-1.08044682443899677e-03), static_cast<f32>(-1.36675607704387150e-03), static_cast<f32>(-1.46903645559687355e-03), static_cast<f32>(-1.39769180641301444e-03), 
-static_cast<f32>(-1.18147978195433899e-03), static_cast<f32>(-8.62097863283329408e-04), static_cast<f32>(-4.87893389892125624e-04), static_cast<f32>(-1.07531845970373300e-04), static_cast<f32>(2.35629730766283210e-04), 
-static_cast<f32>(5.07884478578698052e-04), static_cast<f32>(6.87871080101046728e-04), static_cast<f32>(7.67498739231973299e-04), static_cast<f32>(7.51203545485096529e-04), static_cast<f32>(6.53825962998092966e-04), 
-static_cast<f32>(4.97530545134190110e-04), static_cast<f32>(3.08253995439730080e-04), static_cast<f32>(1.12165881397816936e-04), static_cast<f32>(-6.74344944397874037e-05), static_cast<f32>(-2.12467042193558581e-04), 
-static_cast<f32>(-3.11479511041157556e-04), static_cast<f32>(-3.60068429977557203e-04), static_cast<f32>(-3.60392523106917335e-04), static_cast<f32>(-3.19960402724016400e-04), static_cast<f32>(-2.49940456475261489e-04), 
-static_cast<f32>(-1.63267428449036429e-04), static_cast<f32>(-7.28087656910998780e-05), static_cast<f32>(1.01894347334158990e-05), static_cast<f32>(7.72225431033434937e-05), static_cast<f32>(1.23135752528706686e-04), 
-static_cast<f32>(1.46219066437922713e-04), static_cast<f32>(1.47853387958630372e-04), static_cast<f32>(1.31820821761402166e-04), static_cast<f32>(1.03419430541102058e-04), static_cast<f32>(6.85276032121461838e-05), 
-static_cast<f32>(3.27482296853986359e-05), static_cast<f32>(7.32734063807059972e-07), static_cast<f32>(-2.42541792849815024e-05), static_cast<f32>(-4.05099170129373878e-05), static_cast<f32>(-4.78285654773798771e-05), 
-static_cast<f32>(-4.72436134046799568e-05), static_cast<f32>(-4.06465233808630530e-05), static_cast<f32>(-3.03553393685487895e-05), static_cast<f32>(-1.87026219834234124e-05), static_cast<f32>(-7.69804723413831948e-06), 
-static_cast<f32>(1.19871830785515650e-06), static_cast<f32>(7.18107680307455200e-06), static_cast<f32>(1.00811654140955007e-05), 0.0f,
-};
-    // clang-format on
-
-    // clang-format off
-const f32 KaiserBest[257] = {
-static_cast<f32>(9.475937167399596239e-01), static_cast<f32>(8.624135863459860829e-01), static_cast<f32>(6.341878970614924782e-01), static_cast<f32>(3.344555394844956897e-01), static_cast<f32>(5.207910617885588844e-02), 
-static_cast<f32>(-1.390888908433684235e-01), static_cast<f32>(-2.049638378925058568e-01), static_cast<f32>(-1.590111955193286575e-01), static_cast<f32>(-5.110719159757131508e-02), static_cast<f32>(5.653395433538780518e-02), 
-static_cast<f32>(1.154270367012828064e-01), static_cast<f32>(1.079726177927421704e-01), static_cast<f32>(4.951898536900236486e-02), static_cast<f32>(-2.381925994269620817e-02), static_cast<f32>(-7.464952296045440638e-02), 
-static_cast<f32>(-8.166212679556161813e-02), static_cast<f32>(-4.736057134080128017e-02), static_cast<f32>(6.210793922854770076e-03), static_cast<f32>(5.038418088331499123e-02), static_cast<f32>(6.442786953978682507e-02), 
-static_cast<f32>(4.469375541357477333e-02), static_cast<f32>(4.557869578483456433e-03), static_cast<f32>(-3.388904834641004449e-02), static_cast<f32>(-5.157805950695695113e-02), static_cast<f32>(-4.159352445825559991e-02), 
-static_cast<f32>(-1.147461232883913509e-02), static_cast<f32>(2.183464567447396948e-02), static_cast<f32>(4.125927494464539519e-02), static_cast<f32>(3.814501091659006776e-02), static_cast<f32>(1.590124025646893688e-02), 
-static_cast<f32>(-1.268413706454708453e-02), static_cast<f32>(-3.261987976693820485e-02), static_cast<f32>(-3.444011722142438503e-02), static_cast<f32>(-1.856829042102058416e-02), static_cast<f32>(5.628139424318459594e-03), 
-static_cast<f32>(2.523080156469341417e-02), static_cast<f32>(3.057396828630531277e-02), static_cast<f32>(1.992292659667551161e-02), static_cast<f32>(-1.923769853178876538e-04), static_cast<f32>(-1.886135321949267141e-02), 
-static_cast<f32>(-2.664136455366422976e-02), static_cast<f32>(-2.027141059950477928e-02), static_cast<f32>(-3.929885718541407946e-03), static_cast<f32>(1.337934292255188277e-02), static_cast<f32>(2.273340244077692515e-02), 
-static_cast<f32>(1.984380005945496697e-02), static_cast<f32>(6.957048357353561203e-03), static_cast<f32>(-8.701862153048892448e-03), static_cast<f32>(-1.893441410935312735e-02), static_cast<f32>(-1.882526786892763093e-02), 
-static_cast<f32>(-9.059193761260809705e-03), static_cast<f32>(4.769332470309800044e-03), static_cast<f32>(1.531935551847190581e-02), static_cast<f32>(1.737173338109971807e-02), static_cast<f32>(1.037903537218197100e-02), 
-static_cast<f32>(-1.531323796931043958e-03), static_cast<f32>(-1.195174239599720682e-02), static_cast<f32>(-1.561764962937671301e-02), static_cast<f32>(-1.104289317671875402e-02), static_cast<f32>(-1.061153637704711312e-03), 
-static_cast<f32>(8.882200126551869496e-03), static_cast<f32>(1.367974368225591611e-02), static_cast<f32>(1.116618260463853735e-02), static_cast<f32>(3.059545247933707305e-03), static_cast<f32>(-6.147657848870015894e-03), 
-static_cast<f32>(-1.165868630417580057e-02), static_cast<f32>(-1.085580048601115719e-02), static_cast<f32>(-4.519288794771365685e-03), static_cast<f32>(3.771181562152897335e-03), static_cast<f32>(9.639779233408656348e-03), 
-static_cast<f32>(1.021076484601396266e-02), static_cast<f32>(5.499854640548336795e-03), static_cast<f32>(-1.762407917700164030e-03), static_cast<f32>(-7.693281208441664701e-03), static_cast<f32>(-9.321927183047291551e-03), 
-static_cast<f32>(-6.063846367385312616e-03), static_cast<f32>(1.185115108734274147e-04), static_cast<f32>(5.874729038284978895e-03), static_cast<f32>(8.271273333990301554e-03), static_cast<f32>(6.275548592271000189e-03), 
-static_cast<f32>(1.174384600966857112e-03), static_cast<f32>(-4.225448917118538802e-03), static_cast<f32>(-7.131145607786639785e-03), static_cast<f32>(-6.199205727128644788e-03), static_cast<f32>(-2.139461703133789961e-03), 
-static_cast<f32>(2.773349193346273493e-03), static_cast<f32>(5.963598743393953676e-03), static_cast<f32>(5.897245765669923041e-03), static_cast<f32>(2.807237026821082001e-03), static_cast<f32>(-1.534016009767162365e-03), 
-static_cast<f32>(-4.820017878079761904e-03), static_cast<f32>(-5.428610459015706900e-03), static_cast<f32>(-3.213491192855966617e-03), static_cast<f32>(5.120859653262437592e-04), static_cast<f32>(3.741064294189949419e-03), 
-static_cast<f32>(4.847309499178789616e-03), static_cast<f32>(3.397203213383940407e-03), static_cast<f32>(2.971610352769626083e-04), static_cast<f32>(-2.756967297491399928e-03), static_cast<f32>(-4.201277983869131788e-03), 
-static_cast<f32>(-3.398593443259232370e-03), static_cast<f32>(-9.060639163816152589e-04), static_cast<f32>(1.888144654084843816e-03), static_cast<f32>(3.531582195182417228e-03), static_cast<f32>(3.257358763100887730e-03), 
-static_cast<f32>(1.332780841988472856e-03), static_cast<f32>(-1.146107733022045782e-03), static_cast<f32>(-2.871988445829827281e-03), static_cast<f32>(-3.011164816146875544e-03), static_cast<f32>(-1.599511003078302879e-03), 
-static_cast<f32>(5.345897629122222479e-04), static_cast<f32>(2.248883790300547792e-03), static_cast<f32>(2.694438845065488027e-03), static_cast<f32>(1.730814102261153111e-03), static_cast<f32>(-5.082555095133911186e-05), 
-static_cast<f32>(-1.681516249107884798e-03), static_cast<f32>(-2.337485100262779673e-03), static_cast<f32>(-1.752092147026578211e-03), static_cast<f32>(-3.130922358275620176e-04), static_cast<f32>(1.182506237542255015e-03), 
-static_cast<f32>(1.965924313408897329e-03), static_cast<f32>(1.688283148779055973e-03), static_cast<f32>(5.688525439344847010e-04), static_cast<f32>(-7.585702905004003968e-04), static_cast<f32>(-1.600440534472678204e-03), 
-static_cast<f32>(-1.562799562392161619e-03), static_cast<f32>(-7.306261733328603880e-04), static_cast<f32>(4.113928221087177523e-04), static_cast<f32>(1.256803628554946286e-03), static_cast<f32>(1.396727222401605547e-03), 
-static_cast<f32>(8.138809794940206213e-04), static_cast<f32>(-1.385811653966457677e-04), static_cast<f32>(-9.461245184142249697e-04), static_cast<f32>(-1.208284384754270985e-03), static_cast<f32>(-8.343531565651654807e-04), 
-static_cast<f32>(-6.535713012515974329e-05), static_cast<f32>(6.752931137441025569e-04), static_cast<f32>(1.012526278092916888e-03), static_cast<f32>(8.072016047844744659e-04), static_cast<f32>(2.080686293537052731e-04), 
-static_cast<f32>(-4.475457529016986535e-04), static_cast<f32>(-8.212690439885122822e-04), static_cast<f32>(-7.463583517116818312e-04), static_cast<f32>(-2.984842605659872002e-04), static_cast<f32>(2.631095869473945277e-04), 
-static_cast<f32>(6.431985507329121728e-04), static_cast<f32>(6.640750067460789293e-04), static_cast<f32>(3.460587004156766289e-04), static_cast<f32>(-1.198751289491966981e-04), static_cast<f32>(-4.841244659303321871e-04), 
-static_cast<f32>(-5.706540373621950182e-04), static_cast<f32>(-3.601405233130335905e-04), static_cast<f32>(1.405448667379323292e-05), static_cast<f32>(3.473380754961624228e-04), static_cast<f32>(4.743447866081208406e-04), 
-static_cast<f32>(3.494834999475533418e-04), static_cast<f32>(5.920917985859432164e-05), static_cast<f32>(-2.340333282452700223e-04), static_cast<f32>(-3.813778879063339246e-04), static_cast<f32>(-3.218992523142501162e-04), 
-static_cast<f32>(-1.053064758050925890e-04), static_cast<f32>(1.437539866165487581e-04), static_cast<f32>(2.961081294835794082e-04), static_cast<f32>(2.840429038110876868e-04), static_cast<f32>(1.297172201102921398e-04), 
-static_cast<f32>(-7.483498724662225729e-05), static_cast<f32>(-2.212347293496766312e-04), static_cast<f32>(-2.413167508071564825e-04), static_cast<f32>(-1.376642099066444633e-04), static_cast<f32>(2.481252283142463069e-05), 
-static_cast<f32>(1.580690922334777664e-04), static_cast<f32>(1.978724806094157417e-04), static_cast<f32>(1.338653124996644849e-04), static_cast<f32>(9.215681979837423866e-06), static_cast<f32>(-1.068230055118902507e-04), 
-static_cast<f32>(-1.566900455961737473e-04), static_cast<f32>(-1.223775969917646278e-04), static_cast<f32>(-3.029149006356039240e-05), static_cast<f32>(6.689439837130584619e-05), static_cast<f32>(1.197107991117647604e-04), 
-static_cast<f32>(1.065225058761126411e-04), static_cast<f32>(4.136402784697268550e-05), static_cast<f32>(-3.713272495131588635e-05), static_cast<f32>(-8.800361505268712971e-05), static_cast<f32>(-8.887800554833402103e-05), 
-static_cast<f32>(-4.512353122107880509e-05), static_cast<f32>(1.607124995522908728e-05), static_cast<f32>(6.194508435295652217e-05), static_cast<f32>(7.132217147490020300e-05), static_cast<f32>(4.389655097880094909e-05), 
-static_cast<f32>(-2.118585077070912648e-06), static_cast<f32>(-4.139810756218419515e-05), static_cast<f32>(-5.511257857295570264e-05), static_cast<f32>(-3.959452493344489796e-05), static_cast<f32>(-6.293598630425989474e-06), 
-static_cast<f32>(2.587688584496377977e-05), static_cast<f32>(4.098692354497868260e-05), static_cast<f32>(3.370578388317479812e-05), static_cast<f32>(1.060592075460525509e-05), static_cast<f32>(-1.469008964334372257e-05), 
-static_cast<f32>(-2.927220340694936527e-05), static_cast<f32>(-2.732026535490722255e-05), static_cast<f32>(-1.206599098094592242e-05), static_cast<f32>(7.057549567545783669e-06), static_cast<f32>(1.999220138961530554e-05), 
-static_cast<f32>(2.117639389108467470e-05), static_cast<f32>(1.169672773642724934e-05), static_cast<f32>(-2.198935626740422506e-06), static_cast<f32>(-1.296569174653531268e-05), static_cast<f32>(-1.572053429515009009e-05), 
-static_cast<f32>(-1.029144676405795576e-05), static_cast<f32>(-6.045838193251553693e-07), static_cast<f32>(7.890410373941007991e-06), static_cast<f32>(1.117089904877507156e-05), static_cast<f32>(8.428548180715721380e-06), 
-static_cast<f32>(1.972857252700100825e-06), static_cast<f32>(-4.410242733681185211e-06), static_cast<f32>(-7.579560476830104587e-06), static_cast<f32>(-6.498958003643935799e-06), static_cast<f32>(-2.409412917725605183e-06), 
-static_cast<f32>(2.165109006770163950e-06), static_cast<f32>(4.888071947028446579e-06), static_cast<f32>(4.740285523554878853e-06), static_cast<f32>(2.299683716825349741e-06), static_cast<f32>(-8.245949261514169093e-07), 
-static_cast<f32>(-2.973966532379414817e-06), static_cast<f32>(-3.272764622651508543e-06), static_cast<f32>(-1.920174567174922909e-06), static_cast<f32>(1.074586433174825847e-07), static_cast<f32>(1.686946733714645200e-06), 
-static_cast<f32>(2.133290083890616283e-06), static_cast<f32>(1.454323911983146074e-06), static_cast<f32>(2.102392238104282554e-07), static_cast<f32>(-8.748228640743265134e-07), static_cast<f32>(-1.305097981420971763e-06), 
-static_cast<f32>(-1.011457266643626628e-06), static_cast<f32>(-2.954254631637524315e-07), static_cast<f32>(4.001634203526068684e-07), static_cast<f32>(7.417631285990475454e-07), static_cast<f32>(6.460262123094813200e-07), 
-static_cast<f32>(2.638826359977218364e-07), static_cast<f32>(-1.491902529050612046e-07), static_cast<f32>(-3.851223477532645345e-07), static_cast<f32>(-3.751605580127972301e-07), static_cast<f32>(-1.892022364936786593e-07), 
-static_cast<f32>(3.471732992546920545e-08), static_cast<f32>(1.774408093765072857e-07), static_cast<f32>(1.933461530163775297e-07), static_cast<f32>(1.128159505946651450e-07), static_cast<f32>(5.051910951393845730e-09), 
-static_cast<f32>(-6.861160281542139120e-08), static_cast<f32>(-8.371357096328895344e-08), static_cast<f32>(-5.364061067205831902e-08), static_cast<f32>(-1.022235215092043802e-08), static_cast<f32>(1.943267790374893566e-08), 
-static_cast<f32>(2.594732810196161353e-08), static_cast<f32>(1.640118306934728671e-08), 
-};
-    // clang-format on
-
-    // clang-format off
-const f32 KaiserBestDiff[257] = {
-static_cast<f32>(-8.51801303939735410e-02), static_cast<f32>(-2.28225689284493605e-01), static_cast<f32>(-2.99732357576996788e-01), static_cast<f32>(-2.82376433305639774e-01), static_cast<f32>(-1.91167997022224312e-01), 
-static_cast<f32>(-6.58749470491374334e-02), static_cast<f32>(4.59526423731771994e-02), static_cast<f32>(1.07904003921757335e-01), static_cast<f32>(1.07641145932959120e-01), static_cast<f32>(5.88930823658950012e-02), 
-static_cast<f32>(-7.45441890854063594e-03), static_cast<f32>(-5.84536324237398056e-02), static_cast<f32>(-7.33382453116985800e-02), static_cast<f32>(-5.08302630177581982e-02), static_cast<f32>(-7.01260383510721175e-03), 
-static_cast<f32>(3.43015554547603380e-02), static_cast<f32>(5.35713652636560511e-02), static_cast<f32>(4.41733869604602203e-02), static_cast<f32>(1.40436886564718338e-02), static_cast<f32>(-1.97341141262120517e-02), 
-static_cast<f32>(-4.01358858350913186e-02), static_cast<f32>(-3.84469179248934992e-02), static_cast<f32>(-1.76890111605469066e-02), static_cast<f32>(9.98453504870135122e-03), static_cast<f32>(3.01189121294164648e-02), 
-static_cast<f32>(3.33092580033131080e-02), static_cast<f32>(1.94246292701714257e-02), static_cast<f32>(-3.11426402805532743e-03), static_cast<f32>(-2.22437706601211309e-02), static_cast<f32>(-2.85853773210160214e-02), 
-static_cast<f32>(-1.99357427023911203e-02), static_cast<f32>(-1.82023745448618018e-03), static_cast<f32>(1.58718268004038009e-02), static_cast<f32>(2.41964298453390438e-02), static_cast<f32>(1.96026621403749546e-02), 
-static_cast<f32>(5.34316672161189860e-03), static_cast<f32>(-1.06510416896298012e-02), static_cast<f32>(-2.01153035819933990e-02), static_cast<f32>(-1.86689762341747841e-02), static_cast<f32>(-7.78001133417155835e-03), 
-static_cast<f32>(6.36995395415945048e-03), static_cast<f32>(1.63415248809633713e-02), static_cast<f32>(1.73092286410932925e-02), static_cast<f32>(9.35405951822504238e-03), static_cast<f32>(-2.88960238132195818e-03), 
-static_cast<f32>(-1.28867517021014066e-02), static_cast<f32>(-1.56589105104024545e-02), static_cast<f32>(-1.02325519563042349e-02), static_cast<f32>(1.09146240425496421e-04), static_cast<f32>(9.76607410766682123e-03), 
-static_cast<f32>(1.38285262315706106e-02), static_cast<f32>(1.05500230481621049e-02), static_cast<f32>(2.05237786262781226e-03), static_cast<f32>(-6.99269800891774707e-03), static_cast<f32>(-1.19103591691130141e-02), 
-static_cast<f32>(-1.04204185990661620e-02), static_cast<f32>(-3.66590723337950619e-03), static_cast<f32>(4.57475645265795899e-03), static_cast<f32>(9.98173953901404336e-03), static_cast<f32>(9.94335376425658016e-03), 
-static_cast<f32>(4.79754355570404661e-03), static_cast<f32>(-2.51356107761737876e-03), static_cast<f32>(-8.10663735670483047e-03), static_cast<f32>(-9.20720309680372363e-03), static_cast<f32>(-5.51102845530578467e-03), 
-static_cast<f32>(8.02885818164643383e-04), static_cast<f32>(6.33651169123979150e-03), static_cast<f32>(8.29047035692426215e-03), static_cast<f32>(5.86859767125575901e-03), static_cast<f32>(5.70985612605306309e-04), 
-static_cast<f32>(-4.71091020546562586e-03), static_cast<f32>(-7.26226255824850061e-03), static_cast<f32>(-5.93087329074150089e-03), static_cast<f32>(-1.62864597460562685e-03), static_cast<f32>(3.25808081566197894e-03), 
-static_cast<f32>(6.18235787825874034e-03), static_cast<f32>(5.75621752741155117e-03), static_cast<f32>(2.39654429570532266e-03), static_cast<f32>(-1.99572474171930136e-03), static_cast<f32>(-5.10116399130414351e-03), 
-static_cast<f32>(-5.39983351808539548e-03), static_cast<f32>(-2.90569669066810098e-03), static_cast<f32>(9.31939880657994997e-04), static_cast<f32>(4.05974402399485526e-03), static_cast<f32>(4.91281089648006389e-03), 
-static_cast<f32>(3.19024955004768018e-03), static_cast<f32>(-6.63529777240306345e-05), static_cast<f32>(-3.09000873884884104e-03), static_cast<f32>(-4.34125303658824437e-03), static_cast<f32>(-3.28600186831259954e-03), 
-static_cast<f32>(-6.08592580935944996e-04), static_cast<f32>(2.21511926615974028e-03), static_cast<f32>(3.72557715818221027e-03), static_cast<f32>(3.22897832886370577e-03), static_cast<f32>(1.10624520498884020e-03), 
-static_cast<f32>(-1.45010628579484921e-03), static_cast<f32>(-3.10004217810697785e-03), static_cast<f32>(-3.05412833276836248e-03), static_cast<f32>(-1.44431068637773186e-03), static_cast<f32>(8.02684540609899418e-04), 
-static_cast<f32>(2.49252952687761733e-03), static_cast<f32>(2.79420857046645908e-03), static_cast<f32>(1.64343754109757341e-03), static_cast<f32>(-2.74223432081529498e-04), static_cast<f32>(-1.92457792111241487e-03), 
-static_cast<f32>(-2.47888857501051864e-03), static_cast<f32>(-1.72588071280778150e-03), static_cast<f32>(-1.39176370317048263e-04), static_cast<f32>(1.41165381306857267e-03), static_cast<f32>(2.13410076599052523e-03), 
-static_cast<f32>(1.71429402738832544e-03), static_cast<f32>(4.45555054764940235e-04), static_cast<f32>(-9.63624742804334916e-04), static_cast<f32>(-1.78163965321249214e-03), static_cast<f32>(-1.63069069815654577e-03), 
-static_cast<f32>(-6.55968851154894875e-04), static_cast<f32>(5.85392953236201462e-04), static_cast<f32>(1.43899991119901625e-03), static_cast<f32>(1.49559847336981698e-03), static_cast<f32>(7.83418075866642314e-04), 
-static_cast<f32>(-2.77641164629841355e-04), static_cast<f32>(-1.11943060484457138e-03), static_cast<f32>(-1.32742283443488510e-03), static_cast<f32>(-8.41870243972277807e-04), static_cast<f32>(3.76409720805165847e-05), 
-static_cast<f32>(8.32173389059301231e-04), static_cast<f32>(1.14201899544157819e-03), static_cast<f32>(8.45410806446228588e-04), static_cast<f32>(1.39923593846659261e-04), static_cast<f32>(-5.82846242907584925e-04), 
-static_cast<f32>(-9.52462144890666362e-04), static_cast<f32>(-8.07543353017579229e-04), static_cast<f32>(-2.62159866340046016e-04), static_cast<f32>(3.73931228189105505e-04), static_cast<f32>(7.68996026440005765e-04), 
-static_cast<f32>(7.40650243869262273e-04), static_cast<f32>(3.37233164348814331e-04), static_cast<f32>(-2.05324673308442422e-04), static_cast<f32>(-5.99132975430769193e-04), static_cast<f32>(-6.55614382255403872e-04), 
-static_cast<f32>(-3.73723291086813629e-04), static_cast<f32>(7.49106922768304510e-05), static_cast<f32>(4.47874091145694631e-04), static_cast<f32>(5.61593847513381728e-04), static_cast<f32>(3.80088963785517645e-04), 
-static_cast<f32>(2.08764560131667566e-05), static_cast<f32>(-3.18016306330402300e-04), static_cast<f32>(-4.65933829364873300e-04), static_cast<f32>(-3.64249336981135462e-04), static_cast<f32>(-8.65295714318628311e-05), 
-static_cast<f32>(2.10513514049161428e-04), static_cast<f32>(3.74195009986826813e-04), static_cast<f32>(3.33283588822369200e-04), static_cast<f32>(1.27006711111958418e-04), static_cast<f32>(-1.24861286660567499e-04), 
-static_cast<f32>(-2.90274320088959007e-04), static_cast<f32>(-2.93242508103864357e-04), static_cast<f32>(-1.47344559661063902e-04), static_cast<f32>(5.94786355920838084e-05), static_cast<f32>(2.16592776509157527e-04), 
-static_cast<f32>(2.49060462421641347e-04), static_cast<f32>(1.52354142867030650e-04), static_cast<f32>(-1.20652256724917213e-05), static_cast<f32>(-1.54325683700795547e-04), static_cast<f32>(-2.04552207356914397e-04), 
-static_cast<f32>(-1.46399742103054374e-04), static_cast<f32>(-2.00820214574798513e-05), static_cast<f32>(1.03652540900512019e-04), static_cast<f32>(1.62476732738069108e-04), static_cast<f32>(1.33256569402053122e-04), 
-static_cast<f32>(3.98033883759379753e-05), static_cast<f32>(-6.40071681097512568e-05), static_cast<f32>(-1.24649630519827056e-04), static_cast<f32>(-1.16038687491727680e-04), static_cast<f32>(-4.98670400842834966e-05), 
-static_cast<f32>(3.43124486044091195e-05), static_cast<f32>(9.20861069282042320e-05), static_cast<f32>(9.71858884348662420e-05), static_cast<f32>(5.28164007404589142e-05), static_cast<f32>(-1.31882932356521194e-05), 
-static_cast<f32>(-6.51584780291399556e-05), static_cast<f32>(-7.84967527982885786e-05), static_cast<f32>(-5.08708901013712434e-05), static_cast<f32>(-8.74390495646891323e-07), static_cast<f32>(4.37544743272552159e-05), 
-static_cast<f32>(6.11947811763078958e-05), static_cast<f32>(4.58738343977274383e-05), static_cast<f32>(9.37708712194368083e-06), static_cast<f32>(-2.74256204960992539e-05), static_cast<f32>(-4.60151360558718630e-05), 
-static_cast<f32>(-3.92795224851132812e-05), static_cast<f32>(-1.37144710107715075e-05), static_cast<f32>(1.55180536395108047e-05), static_cast<f32>(3.33009263030189110e-05), static_cast<f32>(3.21704844753897701e-05), 
-static_cast<f32>(1.51100377000149028e-05), static_cast<f32>(-7.28113966180388448e-06), static_cast<f32>(-2.30998631285695430e-05), static_cast<f32>(-2.52960103979489777e-05), static_cast<f32>(-1.45821137636056427e-05), 
-static_cast<f32>(1.95193805204214272e-06), static_cast<f32>(1.52542743739613001e-05), static_cast<f32>(1.91235405484917061e-05), static_cast<f32>(1.29346518220695219e-05), static_cast<f32>(1.18419250146936916e-06), 
-static_cast<f32>(-9.47966615465742536e-06), static_cast<f32>(-1.38956633631676718e-05), static_cast<f32>(-1.07667561197948902e-05), static_cast<f32>(-2.75484254861477741e-06), static_cast<f32>(5.42908753109213433e-06), 
-static_cast<f32>(9.68686294473280018e-06), static_cast<f32>(8.49499419326616357e-06), static_cast<f32>(3.28048867483406357e-06), static_cast<f32>(-2.74235086805935018e-06), static_cast<f32>(-6.45569092801562013e-06), 
-static_cast<f32>(-6.38309998638128561e-06), static_cast<f32>(-3.16931774314891938e-06), static_cast<f32>(1.08060247318616879e-06), static_cast<f32>(4.08954508591833062e-06), static_cast<f32>(4.57452192449576956e-06), 
-static_cast<f32>(2.72296294025828263e-06), static_cast<f32>(-1.47786423473567726e-07), static_cast<f32>(-2.44060180672952911e-06), static_cast<f32>(-3.12427864297676676e-06), static_cast<f32>(-2.14937160622799780e-06), 
-static_cast<f32>(-2.98798090272093726e-07), static_cast<f32>(1.35259005547658563e-06), static_cast<f32>(2.02763321049240551e-06), static_cast<f32>(1.57948809039716260e-06), static_cast<f32>(4.46343350175971083e-07), 
-static_cast<f32>(-6.78966171907470209e-07), static_cast<f32>(-1.24408468817271787e-06), static_cast<f32>(-1.08506208788475472e-06), static_cast<f32>(-4.30275117346645250e-07), static_cast<f32>(2.93640714777345135e-07), 
-static_cast<f32>(7.16031803479874197e-07), static_cast<f32>(6.95588883516359300e-07), static_cast<f32>(3.41599708246440677e-07), static_cast<f32>(-9.57369162895662254e-08), static_cast<f32>(-3.82143576311759484e-07), 
-static_cast<f32>(-4.13072888902783041e-07), static_cast<f32>(-2.35932094848203330e-07), static_cast<f32>(9.96178974046730438e-09), static_cast<f32>(1.85958321519118571e-07), static_cast<f32>(2.23919566419147871e-07), 
-static_cast<f32>(1.42723479451038074e-07), static_cast<f32>(1.59053436398702440e-08), static_cast<f32>(-8.05302024217123848e-08), static_cast<f32>(-1.07764039643271304e-07), static_cast<f32>(-7.36635137668152320e-08), 
-static_cast<f32>(-1.51019681478675622e-08), static_cast<f32>(3.00729602912306344e-08), static_cast<f32>(4.34182585211378827e-08), static_cast<f32>(2.96550300546693720e-08), static_cast<f32>(6.51465019821267787e-09), 
-static_cast<f32>(-9.54614503261432682e-09), 0.0f,
-};
-    // clang-format on
-    struct Config
-    {
-        u32 oversample_;
-        u32 taps_;
-    };
+    RESAMCPP_ASSERT(RESAMCPP_NULL != filepath);
+    WaveReader reader;
+    FILE* file = fopen(filepath, "rb");
+    if(RESAMCPP_NULL == file) {
+        return reader;
+    }
+    s64 fileSize = -1;
+    if(seek(file, 0, SEEK_END)) {
+        fileSize = tell(file);
+    }
+    if(fileSize < 0 || !seek(file, 0, SEEK_SET)) {
+        fclose(file);
+        return reader;
+    }
 
-    Config Configs[] = {
-        {8, 129},
-        {4, 257},
-    };
-} // namespace
+    FMT format = {};
+    bool hasFormat = false;
+    bool rf64 = false;
+    u64 dataSize = 0;
+    bool loop = true;
+    while(loop) {
+        HEAD head;
+        if(fread(&head, sizeof(HEAD), 1, file) <= 0) {
+            break;
+        }
+        switch(head.id_) {
+        case RIFF::ID:
+        case RF64ID: {
+            RIFF riff;
+            if(fread(&riff, sizeof(RIFF), 1, file) <= 0 || riff.format_ != RIFF::Format_Wave) {
+                loop = false;
+            }
+            rf64 = RF64ID == head.id_;
+        } break;
+        case DS64::ID:
+            loop = read_ds64(dataSize, head.size_, file);
+            break;
+        case FMT::ID:
+            loop = hasFormat = read_fmt(format, head.size_, file);
+            break;
+        case DATA::ID: {
+            s64 offset = tell(file);
+            if(!hasFormat || offset < 0) {
+                loop = false;
+                break;
+            }
+            if(!rf64 || SizeOverflow != head.size_) {
+                dataSize = head.size_;
+            }
+            // A truncated file keeps the frames it has
+            dataSize = minimum(dataSize, static_cast<u64>(fileSize - offset));
+            reader.file_ = file;
+            reader.format_ = format;
+            reader.frames_ = dataSize / format.blockAlign_;
+            reader.dataOffset_ = static_cast<u64>(offset);
+            reader.readAhead_ = readAhead;
+#    ifdef POSIX_FADV_SEQUENTIAL
+            ::posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#    endif
+            read_ahead(file, reader.dataOffset_, readAhead);
+            return reader;
+        }
+        default:
+            loop = skip(file, head.size_, head.size_);
+            break;
+        }
+    }
+    fclose(file);
+    return reader;
+}
 
-Resampler Resampler::initialize(u32 srcFrequency, u32 dstFrequency, Quality quality)
+WaveReader::WaveReader()
+    : file_(RESAMCPP_NULL)
+    , format_()
+    , frames_(0)
+    , position_(0)
+    , dataOffset_(0)
+    , readAhead_(0)
 {
-    Resampler resampler;
-    resampler.srcFrequency_ = srcFrequency;
-    resampler.dstFrequency_ = dstFrequency;
-    resampler.sampleRatio_ = static_cast<f32>(dstFrequency) / srcFrequency;
-    resampler.quality_ = static_cast<u32>(quality);
-    return resampler;
 }
 
-u32 Resampler::run(u32 channels, u32 dstSamples, s16* dst, u32 srcSamples, const s16* src)
-{
-    u32 oversample;
-    u32 taps;
-    const f32* filter;
-    const f32* filterDelta;
-    switch(quality_) {
-    case static_cast<u32>(Quality::Fast):
-        oversample = Configs[static_cast<u32>(Quality::Fast)].oversample_;
-        taps = Configs[static_cast<u32>(Quality::Fast)].taps_;
-        filter = KaiserFast;
-        filterDelta = KaiserFastDiff;
-        break;
-    case static_cast<u32>(Quality::Best):
-        oversample = Configs[static_cast<u32>(Quality::Best)].oversample_;
-        taps = Configs[static_cast<u32>(Quality::Best)].taps_;
-        filter = KaiserBest;
-        filterDelta = KaiserBestDiff;
-        break;
-    default:
-        RESAMCPP_ASSERT(false);
-        return 0;
+WaveReader::WaveReader(WaveReader&& other)
+    : file_(other.file_)
+    , format_(other.format_)
+    , frames_(other.frames_)
+    , position_(other.position_)
+    , dataOffset_(other.dataOffset_)
+    , readAhead_(other.readAhead_)
+{
+    other.file_ = RESAMCPP_NULL;
+}
+
+WaveReader::~WaveReader()
+{
+    if(RESAMCPP_NULL != file_) {
+        fclose(file_);
     }
-    f32 sampleRatio = sampleRatio_;
-    f32 scale = minimum(1.0f, sampleRatio);
-    f32 timeStep = 1.0f / sampleRatio;
-    u32 indexStep = static_cast<u32>(scale * oversample);
+}
 
-    f32 time = 0.0f;
-    for(u32 i = 0; i < dstSamples; ++i) {
-        // Grab the top bits as an index to the input buffer
-        u32 n = static_cast<u32>(time);
+WaveReader& WaveReader::operator=(WaveReader&& other)
+{
+    if(this != &other) {
+        if(RESAMCPP_NULL != file_) {
+            fclose(file_);
+        }
+        file_ = other.file_;
+        format_ = other.format_;
+        frames_ = other.frames_;
+        position_ = other.position_;
+        dataOffset_ = other.dataOffset_;
+        readAhead_ = other.readAhead_;
+        other.file_ = RESAMCPP_NULL;
+    }
+    return *this;
+}
 
-        // Grab the fractional component ot the time index
-        f32 frac = scale * (time - n);
+bool WaveReader::valid() const
+{
+    return RESAMCPP_NULL != file_;
+}
 
-        // Offset into the filter
-        f32 indexFrac = frac * oversample;
-        u32 offset = static_cast<u32>(indexFrac);
+const FMT& WaveReader::format() const
+{
+    return format_;
+}
 
-        // Interpolation factor
-        f32 eta = indexFrac - offset;
+u64 WaveReader::frames() const
+{
+    return frames_;
+}
 
-        // Compute the left wing of the filter response
-        f32 values[2] = {};
-        u32 maxi = minimum(n + 1, (taps - offset) / indexStep);
-        for(u32 j = 0; j < maxi; ++j) {
-            RESAMCPP_ASSERT((offset + j * indexStep) < taps);
-            f32 weight = (filter[offset + j * indexStep] + eta * filterDelta[offset + j * indexStep]);
-            for(u32 k = 0; k < channels; ++k) {
-                RESAMCPP_ASSERT((i * channels + k) < (dstSamples*channels));
-                RESAMCPP_ASSERT(((n - j) * channels + k) < (srcSamples*channels));
-                values[k] += weight * src[(n - j) * channels + k];
-            }
-        }
-        // Invert P
-        frac = scale - frac;
-        indexFrac = frac * oversample;
-        offset = static_cast<u32>(indexFrac);
+u64 WaveReader::position() const
+{
+    return position_;
+}
 
-        // Offset into the filter
-        eta = indexFrac - offset;
+u32 WaveReader::read(void* dst, u32 frames)
+{
+    RESAMCPP_ASSERT(valid());
+    RESAMCPP_ASSERT(RESAMCPP_NULL != dst || frames <= 0);
+    u32 count = static_cast<u32>(minimum<u64>(frames, frames_ - position_));
+    if(count <= 0) {
+        return 0;
+    }
+    u32 read = static_cast<u32>(fread(dst, format_.blockAlign_, count, file_));
+    position_ += read;
+    if(0 < readAhead_ && position_ < frames_) {
+        read_ahead(file_, dataOffset_ + position_ * format_.blockAlign_, readAhead_);
+    }
+    return read;
+}
 
-        // Compute the right wing of the filter response
-        maxi = minimum(srcSamples - n - 1, (taps - offset) / indexStep);
-        for(u32 j = 0; j < maxi; ++j) {
-            RESAMCPP_ASSERT((offset + j * indexStep) < taps);
-            f32 weight = (filter[offset + j * indexStep] + eta * filterDelta[offset + j * indexStep]);
-            for(u32 k = 0; k < channels; ++k) {
-                RESAMCPP_ASSERT((i * channels + k) < (dstSamples*channels));
-                RESAMCPP_ASSERT(((n + j + 1) * channels + k) < (srcSamples*channels));
-                values[k] += weight * src[(n + j + 1) * channels + k];
-            }
-        }
-        for(u32 j = 0; j < channels; ++j) {
-            s32 x = (s32)(values[j] * scale);
-            dst[i * channels + j] = static_cast<s16>(clamp(x, -32768, 32767));
-        }
-        // Increment the time register
-        time += timeStep;
+//--- WaveWriter
+namespace
+{
+    //--- The header of a written file, RIFF, JUNK for a ds64, fmt, then the head of data
+    constexpr u64 JunkOffset = sizeof(HEAD) + sizeof(RIFF);
+    constexpr u64 FormatOffset = JunkOffset + sizeof(HEAD) + sizeof(DS64);
+    constexpr u64 DataOffset = FormatOffset + sizeof(HEAD) + sizeof(FMT);
+    constexpr u64 WriterHeaderSize = DataOffset + sizeof(HEAD);
+
+    bool write_at(FILE* file, u64 offset, const void* data, size_t size)
+    {
+        return seek(file, static_cast<s64>(offset), SEEK_SET) && 0 < fwrite(data, size, 1, file);
     }
-    return dstSamples;
+} // namespace
+
+WaveWriter WaveWriter::initialize(const char* filepath, const FMT& format)
+{
+    RESAMCPP_ASSERT(RESAMCPP_NULL != filepath);
+    WaveWriter writer;
+    if(!valid_block_align(format)) {
+        return writer;
+    }
+    FILE* file = fopen(filepath, "wb");
+    if(RESAMCPP_NULL == file) {
+        return writer;
+    }
+    // The sizes are zero until close
+    u8 header[WriterHeaderSize] = {};
+    HEAD head = {RIFF::ID, 0};
+    RIFF riff = {RIFF::Format_Wave};
+    ::memcpy(header, &head, sizeof(HEAD));
+    ::memcpy(header + sizeof(HEAD), &riff, sizeof(RIFF));
+    head = {JunkID, sizeof(DS64)};
+    ::memcpy(header + JunkOffset, &head, sizeof(HEAD));
+    head = {FMT::ID, sizeof(FMT)};
+    ::memcpy(header + FormatOffset, &head, sizeof(HEAD));
+    ::memcpy(header + FormatOffset + sizeof(HEAD), &format, sizeof(FMT));
+    head = {DATA::ID, 0};
+    ::memcpy(header + DataOffset, &head, sizeof(HEAD));
+    if(fwrite(header, sizeof(header), 1, file) <= 0) {
+        fclose(file);
+        return writer;
+    }
+    writer.file_ = file;
+    writer.format_ = format;
+    return writer;
 }
 
-u32 Resampler::run_ispc(u32 channels, u32 dstSamples, s16* dst, u32 srcSamples, const s16* src)
+WaveWriter::WaveWriter()
+    : file_(RESAMCPP_NULL)
+    , format_()
+    , frames_(0)
+    , failed_(false)
 {
-#ifdef RESAMCPP_ISPC
-    u32 oversample;
-    s32 taps;
-    const f32* filter;
-    const f32* filterDelta;
-    switch(quality_) {
-    case static_cast<u32>(Quality::Fast):
-        oversample = Configs[static_cast<u32>(Quality::Fast)].oversample_;
-        taps = static_cast<s32>(Configs[static_cast<s32>(Quality::Fast)].taps_);
-        filter = KaiserFast;
-        filterDelta = KaiserFastDiff;
-        break;
-    case static_cast<u32>(Quality::Best):
-        oversample = Configs[static_cast<u32>(Quality::Best)].oversample_;
-        taps = static_cast<s32>(Configs[static_cast<s32>(Quality::Best)].taps_);
-        filter = KaiserBest;
-        filterDelta = KaiserBestDiff;
-        break;
-    default:
-        RESAMCPP_ASSERT(false);
-        return 0;
+}
+
+WaveWriter::WaveWriter(WaveWriter&& other)
+    : file_(other.file_)
+    , format_(other.format_)
+    , frames_(other.frames_)
+    , failed_(other.failed_)
+{
+    other.file_ = RESAMCPP_NULL;
+}
+
+WaveWriter::~WaveWriter()
+{
+    close();
+}
+
+WaveWriter& WaveWriter::operator=(WaveWriter&& other)
+{
+    if(this != &other) {
+        close();
+        file_ = other.file_;
+        format_ = other.format_;
+        frames_ = other.frames_;
+        failed_ = other.failed_;
+        other.file_ = RESAMCPP_NULL;
     }
-    return ispc::resample(
-        channels,
-        sampleRatio_,
-        oversample,
-        dstSamples,
-        dst,
-        srcSamples,
-        src,
-        filter,
-        filterDelta);
-#else
-    return run(channels, dstSamples, dst, srcSamples, src);
-#endif
+    return *this;
+}
+
+bool WaveWriter::valid() const
+{
+    return RESAMCPP_NULL != file_;
+}
+
+const FMT& WaveWriter::format() const
+{
+    return format_;
+}
+
+u64 WaveWriter::frames() const
+{
+    return frames_;
 }
+
+bool WaveWriter::write(const void* src, u32 frames)
+{
+    RESAMCPP_ASSERT(valid());
+    RESAMCPP_ASSERT(RESAMCPP_NULL != src || frames <= 0);
+    if(frames <= 0) {
+        return true;
+    }
+    size_t written = fwrite(src, format_.blockAlign_, frames, file_);
+    frames_ += written;
+    if(written != frames) {
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool WaveWriter::close()
+{
+    if(RESAMCPP_NULL == file_) {
+        return false;
+    }
+    bool result = !failed_;
+    u64 dataSize = frames_ * format_.blockAlign_;
+    if(0 != (dataSize & 1U)) {
+        result = EOF != fputc(0, file_) && result;
+    }
+    u64 riffSize = WriterHeaderSize - sizeof(HEAD) + dataSize + (dataSize & 1U);
+    if(riffSize <= SizeOverflow) {
+        HEAD head = {RIFF::ID, static_cast<u32>(riffSize)};
+        result = write_at(file_, 0, &head, sizeof(HEAD)) && result;
+        head = {DATA::ID, static_cast<u32>(dataSize)};
+        result = write_at(file_, DataOffset, &head, sizeof(HEAD)) && result;
+    } else {
+        // The JUNK chunk becomes the ds64 chunk, and the 32 bit sizes point to it
+        HEAD head = {RF64ID, SizeOverflow};
+        result = write_at(file_, 0, &head, sizeof(HEAD)) && result;
+        u8 chunk[sizeof(HEAD) + sizeof(DS64)];
+        head = {DS64::ID, sizeof(DS64)};
+        DS64 ds64 = {};
+        split(ds64.riffSize_, riffSize);
+        split(ds64.dataSize_, dataSize);
+        split(ds64.sampleCount_, frames_);
+        ::memcpy(chunk, &head, sizeof(HEAD));
+        ::memcpy(chunk + sizeof(HEAD), &ds64, sizeof(DS64));
+        result = write_at(file_, JunkOffset, chunk, sizeof(chunk)) && result;
+        head = {DATA::ID, SizeOverflow};
+        result = write_at(file_, DataOffset, &head, sizeof(HEAD)) && result;
+    }
+    result = 0 == fclose(file_) && result;
+    file_ = RESAMCPP_NULL;
+    return result;
+}
+#endif
+
+#ifdef RESAMCPP_STATS
+/**
+@brief The counters of a resampler, which a call adds its counts to when it returns
+*/
+struct Counters
+{
+    std::atomic<u64> inputFrames_;
+    std::atomic<u64> outputFrames_;
+    std::atomic<u64> taps_;
+    std::atomic<u64> clippedWindows_;
+    std::atomic<u64> clippedSamples_;
+    std::atomic<u64> calls_[Resampler::Statistics::Paths];
+    std::atomic<u64> latency_[Resampler::Statistics::LatencyBuckets];
+};
+
+namespace
+{
+    /**
+    @brief The counts of this thread, the hot loops add to them without atomics
+    */
+    struct CallCounts
+    {
+        u64 inputFrames_;
+        u64 outputFrames_;
+        u64 taps_;
+        u64 clippedWindows_;
+        u64 clippedSamples_;
+    };
+
+    thread_local CallCounts callCounts = {};
+
+    /**
+    @brief The scope of a call, which adds the counts of this thread since its start and its duration to the counters
+    */
+    class CallStatistics
+    {
+    public:
+        CallStatistics(Counters* counters, Resampler::Statistics::Path path)
+            : counters_(counters)
+            , path_(path)
+            , counts_(callCounts)
+            , start_(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~CallStatistics()
+        {
+            if(RESAMCPP_NULL == counters_) {
+                return;
+            }
+            u64 nanoseconds = static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+            u32 bucket = 0;
+            while((bucket + 1) < Resampler::Statistics::LatencyBuckets && (2ULL << bucket) <= nanoseconds) {
+                ++bucket;
+            }
+            const std::memory_order relaxed = std::memory_order_relaxed;
+            counters_->inputFrames_.fetch_add(callCounts.inputFrames_ - counts_.inputFrames_, relaxed);
+            counters_->outputFrames_.fetch_add(callCounts.outputFrames_ - counts_.outputFrames_, relaxed);
+            counters_->taps_.fetch_add(callCounts.taps_ - counts_.taps_, relaxed);
+            counters_->clippedWindows_.fetch_add(callCounts.clippedWindows_ - counts_.clippedWindows_, relaxed);
+            counters_->clippedSamples_.fetch_add(callCounts.clippedSamples_ - counts_.clippedSamples_, relaxed);
+            counters_->calls_[static_cast<u32>(path_)].fetch_add(1, relaxed);
+            counters_->latency_[bucket].fetch_add(1, relaxed);
+        }
+
+    private:
+        CallStatistics(const CallStatistics&) = delete;
+        CallStatistics& operator=(const CallStatistics&) = delete;
+
+        Counters* counters_;
+        Resampler::Statistics::Path path_;
+        CallCounts counts_;
+        std::chrono::steady_clock::time_point start_;
+    };
+} // namespace
+
+#    define RESAMCPP_STATS_CALL(counters, path) CallStatistics callStatistics(counters, path)
+#    define RESAMCPP_STATS_WINDOWS(begin, end, srcSamples) count_windows(begin, end, srcSamples)
+#    define RESAMCPP_STATS_WINDOW(frames, window) (callCounts.taps_ += (frames), callCounts.clippedWindows_ += ((frames) < (window)) ? 1 : 0)
+#    define RESAMCPP_STATS_FRAMES(input, output) (callCounts.inputFrames_ += (input), callCounts.outputFrames_ += (output))
+#    define RESAMCPP_STATS_SATURATE(saturated) (callCounts.clippedSamples_ += (saturated) ? 1 : 0)
+#else
+#    define RESAMCPP_STATS_CALL(counters, path)
+#    define RESAMCPP_STATS_WINDOWS(begin, end, srcSamples)
+#    define RESAMCPP_STATS_WINDOW(frames, window)
+#    define RESAMCPP_STATS_FRAMES(input, output)
+#    define RESAMCPP_STATS_SATURATE(saturated)
+#endif
+
+namespace
+{
+    //--- Presets, which are the kaiser_fast and kaiser_best of the resampy at lower oversamples
+    constexpr FilterDesign Presets[] = {
+        {8.555504641634386, 0.85, 16, 8},
+        {14.769656459379492, 0.9475937167399596, 64, 4},
+    };
+
+    constexpr u32 get_taps(const FilterDesign& design)
+    {
+        return design.zeroCrossings_ * design.oversample_ + 1;
+    }
+
+    /**
+    @brief The zeroth order modified Bessel function of the first kind
+    */
+    f64 bessel_i0(f64 x)
+    {
+        f64 y = 0.25 * x * x;
+        f64 sum = 1.0;
+        f64 term = 1.0;
+        for(u32 k = 1; k < 1000; ++k) {
+            term *= y / (static_cast<f64>(k) * k);
+            sum += term;
+            if(term <= sum * 1.0e-17) {
+                break;
+            }
+        }
+        return sum;
+    }
+
+    bool valid_design(const FilterDesign& design)
+    {
+        return 0.0 <= design.beta_
+               && 0.0 < design.rolloff_ && design.rolloff_ <= 1.0
+               && 0 < design.zeroCrossings_ && design.zeroCrossings_ <= Resampler::MaxZeroCrossings
+               && 0 < design.oversample_ && design.oversample_ <= Resampler::MaxOversample;
+    }
+
+    bool equal(const FilterDesign& x0, const FilterDesign& x1)
+    {
+        return x0.beta_ == x1.beta_
+               && x0.rolloff_ == x1.rolloff_
+               && x0.zeroCrossings_ == x1.zeroCrossings_
+               && x0.oversample_ == x1.oversample_;
+    }
+
+    /**
+    @brief The Kaiser windowed sinc at x zero crossings from the center, zero outside of the window
+    @param scale ... 1/I0(beta)
+    */
+    f64 get_filter_value(const FilterDesign& design, f64 scale, f64 x)
+    {
+        const f64 pi = 3.14159265358979323846;
+        x = fabs(x);
+        if(design.zeroCrossings_ < x) {
+            return 0.0;
+        }
+        f64 t = pi * design.rolloff_ * x;
+        f64 sinc = (0.0 == x) ? 1.0 : sin(t) / t;
+        f64 r = x / design.zeroCrossings_;
+        f64 window = bessel_i0(design.beta_ * sqrt(maximum(0.0, 1.0 - r * r))) * scale;
+        return design.rolloff_ * sinc * window;
+    }
+
+    /**
+    @brief Sample the right half of a Kaiser windowed sinc in f64, then store it and the differences of neighbors in f32
+    */
+    void design_filter(f32* filter, f32* filterDelta, const FilterDesign& design)
+    {
+        u32 n = design.zeroCrossings_ * design.oversample_;
+        f64 scale = 1.0 / bessel_i0(design.beta_);
+        f64 previous = 0.0;
+        for(u32 k = 0; k <= n; ++k) {
+            f64 value = get_filter_value(design, scale, static_cast<f64>(k) / design.oversample_);
+            if(1.0 == design.rolloff_ && 0 < k && 0 == (k % design.oversample_)) {
+                // Exact zero crossings of a Nyquist filter
+                value = 0.0;
+            }
+            filter[k] = static_cast<f32>(value);
+            if(0 < k) {
+                filterDelta[k - 1] = static_cast<f32>(value - previous);
+            }
+            previous = value;
+        }
+        filterDelta[n] = 0.0f;
+    }
+
+    /**
+    @brief The stopband attenuation in dB of a Kaiser window, the inverse of beta = 0.1102 * (A - 8.7)
+    */
+    f64 get_attenuation(f64 beta)
+    {
+        return maximum(beta, 5.0) / 0.1102 + 8.7;
+    }
+
+    /**
+    @brief A Nyquist filter for an integer factor, whose passband is as flat as the design's
+
+    The cutoff is at the Nyquist frequency of the lower side, where the transition is centered,
+    so that every factor-th tap from the center is zero. Sampled at factor times per zero crossing,
+    every weight of an integer ratio is a sample of the table without interpolation.
+    */
+    FilterDesign get_nyquist_design(const FilterDesign& design, u32 factor)
+    {
+        const f64 pi = 3.14159265358979323846;
+        // Kaiser's estimate of the transition width relative to the lower frequency
+        f64 attenuation = get_attenuation(design.beta_);
+        f64 order = (attenuation - 7.95) / (2.285 * 2.0 * pi);
+        f64 width = order / (2.0 * design.zeroCrossings_);
+        f64 passband = 0.5 * maximum(0.0, design.rolloff_ - width);
+        u32 zeroCrossings = static_cast<u32>(ceil(order / (2.0 * (1.0 - passband * 2.0))));
+        zeroCrossings = clamp(zeroCrossings, 1U, design.zeroCrossings_);
+        return {design.beta_, 1.0, zeroCrossings, factor};
+    }
+
+    /**
+    @brief A designed filter shared by resamplers with the same design
+    */
+    struct FilterEntry
+    {
+        FilterDesign design_;
+        u32 references_;
+        Filter filter_;
+        FilterEntry* next_;
+    };
+
+    std::mutex filterMutex;
+    FilterEntry* filterCache = RESAMCPP_NULL;
+
+    /**
+    @brief Find a cached filter or design a new one, an acquired filter must be released
+    */
+    bool acquire_filter(Filter& filter, const FilterDesign& design)
+    {
+        if(!valid_design(design)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(filterMutex);
+        for(FilterEntry* entry = filterCache; RESAMCPP_NULL != entry; entry = entry->next_) {
+            if(equal(entry->design_, design)) {
+                ++entry->references_;
+                filter = entry->filter_;
+                return true;
+            }
+        }
+        // The entry and both tables in one allocation
+        u32 taps = get_taps(design);
+        FilterEntry* entry = reinterpret_cast<FilterEntry*>(::malloc(sizeof(FilterEntry) + sizeof(f32) * taps * 2));
+        if(RESAMCPP_NULL == entry) {
+            return false;
+        }
+        f32* tables = reinterpret_cast<f32*>(entry + 1);
+        design_filter(tables, tables + taps, design);
+        entry->design_ = design;
+        entry->references_ = 1;
+        entry->filter_ = {design.oversample_, taps, tables, tables + taps};
+        entry->next_ = filterCache;
+        filterCache = entry;
+        filter = entry->filter_;
+        return true;
+    }
+
+    /**
+    @brief Release an acquired filter, the last release frees it
+    */
+    void release_filter(Filter& filter)
+    {
+        if(RESAMCPP_NULL == filter.filter_) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(filterMutex);
+        for(FilterEntry** link = &filterCache; RESAMCPP_NULL != *link; link = &(*link)->next_) {
+            FilterEntry* entry = *link;
+            if(entry->filter_.filter_ != filter.filter_) {
+                continue;
+            }
+            if(0 == --entry->references_) {
+                *link = entry->next_;
+                ::free(entry);
+            }
+            filter = {};
+            return;
+        }
+        RESAMCPP_ASSERT(false);
+    }
+
+    constexpr u32 CustomQuality = ~0U; //!< a designed filter, whose taps and oversample are known only at runtime
+
+    /**
+    @brief The preset, which a design is equal to, or CustomQuality
+    */
+    u32 get_quality(const FilterDesign& design)
+    {
+        for(u32 i = 0; i < sizeof(Presets) / sizeof(Presets[0]); ++i) {
+            if(equal(Presets[i], design)) {
+                return i;
+            }
+        }
+        return CustomQuality;
+    }
+
+    //--- The taps and the oversample of a filter, which are constants for presets
+    template<u32 Q>
+    struct Preset
+    {
+        static constexpr u32 oversample(const Filter&)
+        {
+            return Presets[Q].oversample_;
+        }
+
+        static constexpr u32 taps(const Filter&)
+        {
+            return get_taps(Presets[Q]);
+        }
+    };
+
+    template<>
+    struct Preset<CustomQuality>
+    {
+        static u32 oversample(const Filter& filter)
+        {
+            return filter.oversample_;
+        }
+
+        static u32 taps(const Filter& filter)
+        {
+            return filter.taps_;
+        }
+    };
+
+    inline f32 load_sample(u8 x)
+    {
+        return static_cast<f32>(x) - 128.0f;
+    }
+
+    inline f32 load_sample(s16 x)
+    {
+        return static_cast<f32>(x);
+    }
+
+    inline f32 load_sample(const s24& x)
+    {
+        // Place the sample at the top of 32 bits, then shift back with the sign
+        u32 value = (static_cast<u32>(x.bytes_[0]) << 8) | (static_cast<u32>(x.bytes_[1]) << 16) | (static_cast<u32>(x.bytes_[2]) << 24);
+        return static_cast<f32>(static_cast<s32>(value) >> 8);
+    }
+
+    inline f32 load_sample(s32 x)
+    {
+        return static_cast<f32>(x);
+    }
+
+    inline f32 load_sample(f32 x)
+    {
+        return x;
+    }
+
+    /**
+    @brief Accumulate the filter response around the input frame src
+    @tparam Q ... the quality, which fixes the taps and the oversample of the filter
+    @tparam Up ... whether the ratio is one or more, then the index step is the oversample
+    @tparam C ... the number of channels, or zero for a runtime number
+    @param left ... the number of input frames available at and before src
+    @param right ... the number of input frames available after src
+    */
+    template<u32 Q, bool Up, u32 C, class T>
+    void resample_frame(f32* values, u32 channels, const Filter& filter, f32 scale, u32 indexStep, f32 frac, u32 left, u32 right, const T* src)
+    {
+        const u32 oversample = Preset<Q>::oversample(filter);
+        const u32 taps = Preset<Q>::taps(filter);
+        RESAMCPP_ASSERT(oversample == filter.oversample_ && taps == filter.taps_);
+        RESAMCPP_ASSERT(!Up || oversample == indexStep);
+        const u32 numChannels = (0 == C) ? channels : C;
+        const u32 step = Up ? oversample : indexStep;
+        const f32* weights = filter.filter_;
+        const f32* deltas = filter.filterDelta_;
+
+        // Offset into the filter
+        f32 indexFrac = frac * oversample;
+        u32 offset = static_cast<u32>(indexFrac);
+
+        // Interpolation factor
+        f32 eta = indexFrac - offset;
+
+        // Compute the left wing of the filter response
+        u32 maxi = minimum(left, (taps - offset) / step);
+        for(u32 j = 0; j < maxi; ++j) {
+            RESAMCPP_ASSERT((offset + j * step) < taps);
+            f32 weight = (weights[offset + j * step] + eta * deltas[offset + j * step]);
+            const T* s = src - j * numChannels;
+            for(u32 k = 0; k < numChannels; ++k) {
+                values[k] += weight * load_sample(s[k]);
+            }
+        }
+        // Invert P
+        frac = scale - frac;
+        indexFrac = frac * oversample;
+        offset = static_cast<u32>(indexFrac);
+
+        // Offset into the filter
+        eta = indexFrac - offset;
+
+        // Compute the right wing of the filter response
+        maxi = minimum(right, (taps - offset) / step);
+        for(u32 j = 0; j < maxi; ++j) {
+            RESAMCPP_ASSERT((offset + j * step) < taps);
+            f32 weight = (weights[offset + j * step] + eta * deltas[offset + j * step]);
+            const T* s = src + (j + 1) * numChannels;
+            for(u32 k = 0; k < numChannels; ++k) {
+                values[k] += weight * load_sample(s[k]);
+            }
+        }
+    }
+
+    template<class T>
+    using InterpolateFunction = void (*)(f32* values, u32 channels, const Filter& filter, f32 scale, u32 indexStep, f32 frac, u32 left, u32 right, const T* src);
+
+    //--- Interpolation kernels for the channel counts 1, 2, 6, 8 and others
+    constexpr u32 ChannelSlots = 5;
+
+    inline u32 channel_slot(u32 channels)
+    {
+        switch(channels) {
+        case 1:
+            return 1;
+        case 2:
+            return 2;
+        case 6:
+            return 3;
+        case 8:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    template<class T>
+    struct InterpolateTable
+    {
+        InterpolateFunction<T> functions_[ChannelSlots];
+    };
+
+    template<u32 Q, bool Up, class T>
+    constexpr InterpolateTable<T> make_table()
+    {
+        return {{
+            resample_frame<Q, Up, 0, T>,
+            resample_frame<Q, Up, 1, T>,
+            resample_frame<Q, Up, 2, T>,
+            resample_frame<Q, Up, 6, T>,
+            resample_frame<Q, Up, 8, T>,
+        }};
+    }
+} // namespace
+
+/**
+@brief Interpolation kernels of all sample types for a quality and a direction
+*/
+struct InterpolateKernels
+    : InterpolateTable<u8>
+    , InterpolateTable<s16>
+    , InterpolateTable<s24>
+    , InterpolateTable<s32>
+    , InterpolateTable<f32>
+{
+};
+
+namespace
+{
+    template<u32 Q, bool Up>
+    const InterpolateKernels* make_kernels()
+    {
+        static constexpr InterpolateKernels kernels = {
+            make_table<Q, Up, u8>(),
+            make_table<Q, Up, s16>(),
+            make_table<Q, Up, s24>(),
+            make_table<Q, Up, s32>(),
+            make_table<Q, Up, f32>(),
+        };
+        return &kernels;
+    }
+
+    /**
+    @brief Select the kernels specialized for a preset, then Resampler has no branch on the quality while running
+    */
+    const InterpolateKernels* get_kernels(u32 quality, bool up)
+    {
+        constexpr u32 Fast = static_cast<u32>(Resampler::Quality::Fast);
+        constexpr u32 Best = static_cast<u32>(Resampler::Quality::Best);
+        switch(quality) {
+        case Fast:
+            return up ? make_kernels<Fast, true>() : make_kernels<Fast, false>();
+        case Best:
+            return up ? make_kernels<Best, true>() : make_kernels<Best, false>();
+        default:
+            return up ? make_kernels<CustomQuality, true>() : make_kernels<CustomQuality, false>();
+        }
+    }
+
+    template<class T>
+    InterpolateFunction<T> get_interpolate(const InterpolateKernels* kernels, u32 channels)
+    {
+        RESAMCPP_ASSERT(RESAMCPP_NULL != kernels);
+        const InterpolateTable<T>& table = *kernels;
+        return table.functions_[channel_slot(channels)];
+    }
+
+    /**
+    @brief Evaluate the filter at the fractional time frac into a dense row like a polyphase bank
+    */
+    void build_row(f32* row, u32 width, u32 wing, const Filter& filter, f32 scale, u32 indexStep, f64 frac)
+    {
+        for(u32 k = 0; k < width; ++k) {
+            row[k] = 0.0f;
+        }
+        for(u32 w = 0; w < 2; ++w) {
+            f64 indexFrac = frac * filter.oversample_;
+            u32 offset = static_cast<u32>(indexFrac);
+            f64 eta = indexFrac - offset;
+            u32 maxi = (filter.taps_ - offset) / indexStep;
+            for(u32 j = 0; j < maxi; ++j) {
+                u32 index = offset + j * indexStep;
+                f64 weight = static_cast<f64>(filter.filter_[index]) + eta * filter.filterDelta_[index];
+                // The left wing goes backward from n, the right one goes forward from n+1
+                u32 k = (0 == w) ? wing - 1 - j : wing + j;
+                row[k] = static_cast<f32>(weight);
+            }
+            // Invert P
+            frac = scale - frac;
+        }
+    }
+
+    template<class T>
+    using DotFunction = void (*)(f32* values, u32 channels, u32 count, const f32* weights, const T* src);
+
+    template<u32 C, class T>
+    void dot_scalar(f32* values, u32 channels, u32 count, const f32* weights, const T* src)
+    {
+        const u32 numChannels = (0 == C) ? channels : C;
+        for(u32 j = 0; j < count; ++j) {
+            f32 weight = weights[j];
+            const T* s = src + j * numChannels;
+            for(u32 k = 0; k < numChannels; ++k) {
+                values[k] += weight * load_sample(s[k]);
+            }
+        }
+    }
+
+    typedef f32 (*DotPlanarFunction)(u32 count, const f32* weights, const f32* src);
+
+    f32 dot_planar_scalar(u32 count, const f32* weights, const f32* src)
+    {
+        f32 value = 0.0f;
+        for(u32 j = 0; j < count; ++j) {
+            value += weights[j] * src[j];
+        }
+        return value;
+    }
+
+    /**
+    @brief Whether a sample type has vector loads, 24 bit packed samples do not
+    */
+    template<class T>
+    struct Vectorizable
+    {
+        static constexpr bool value = true;
+    };
+
+    template<>
+    struct Vectorizable<s24>
+    {
+        static constexpr bool value = false;
+    };
+
+#ifdef RESAMCPP_X86
+    bool cpuid(u32 leaf, u32 subleaf, u32 registers[4])
+    {
+#    ifdef _MSC_VER
+        int r[4];
+        __cpuid(r, 0);
+        if(static_cast<u32>(r[0]) < leaf) {
+            return false;
+        }
+        __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for(u32 i = 0; i < 4; ++i) {
+            registers[i] = static_cast<u32>(r[i]);
+        }
+        return true;
+#    else
+        if(__get_cpuid_max(0, RESAMCPP_NULL) < leaf) {
+            return false;
+        }
+        __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+        return true;
+#    endif
+    }
+
+    u64 xgetbv()
+    {
+#    ifdef _MSC_VER
+        return _xgetbv(0);
+#    else
+        u32 eax;
+        u32 edx;
+        __asm__ volatile("xgetbv"
+                         : "=a"(eax), "=d"(edx)
+                         : "c"(0));
+        return (static_cast<u64>(edx) << 32) | eax;
+#    endif
+    }
+
+    Resampler::Kernel detect_x86()
+    {
+        u32 r[4];
+        if(!cpuid(1, 0, r)) {
+            return Resampler::Kernel::Scalar;
+        }
+        // FMA, OSXSAVE and AVX
+        const u32 features1 = (1U << 12) | (1U << 27) | (1U << 28);
+        if(features1 != (r[2] & features1)) {
+            return Resampler::Kernel::Scalar;
+        }
+        // The OS must save XMM and YMM, and also opmask and ZMM for AVX-512
+        u64 xcr0 = xgetbv();
+        if(0x06U != (xcr0 & 0x06U) || !cpuid(7, 0, r)) {
+            return Resampler::Kernel::Scalar;
+        }
+        const u32 avx2 = 1U << 5;
+        const u32 avx512f = 1U << 16;
+        if(0 == (r[1] & avx2)) {
+            return Resampler::Kernel::Scalar;
+        }
+        if(0 != (r[1] & avx512f) && 0xE6U == (xcr0 & 0xE6U)) {
+            return Resampler::Kernel::AVX512;
+        }
+        return Resampler::Kernel::AVX2;
+    }
+
+    RESAMCPP_TARGET_AVX2 inline f32 horizontal_add(__m256 x)
+    {
+        __m128 x4 = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+        x4 = _mm_add_ps(x4, _mm_movehl_ps(x4, x4));
+        x4 = _mm_add_ss(x4, _mm_shuffle_ps(x4, x4, 0x55));
+        return _mm_cvtss_f32(x4);
+    }
+
+    RESAMCPP_TARGET_AVX2 inline __m128 horizontal_add_2(__m256 x)
+    {
+        // Sum up the even and the odd lanes into the lane 0 and 1
+        __m128 x4 = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+        return _mm_add_ps(x4, _mm_movehl_ps(x4, x4));
+    }
+
+    //--- Convert 8 samples to floats
+    RESAMCPP_TARGET_AVX2 inline __m256 load8(const u8* src)
+    {
+        __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+        return _mm256_sub_ps(_mm256_cvtepi32_ps(x), _mm256_set1_ps(128.0f));
+    }
+
+    RESAMCPP_TARGET_AVX2 inline __m256 load8(const s16* src)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+    }
+
+    RESAMCPP_TARGET_AVX2 inline __m256 load8(const s32* src)
+    {
+        return _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+    }
+
+    RESAMCPP_TARGET_AVX2 inline __m256 load8(const f32* src)
+    {
+        return _mm256_loadu_ps(src);
+    }
+
+    template<class T>
+    RESAMCPP_TARGET_AVX2 void dot_avx2_1(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        u32 j = 0;
+        for(; (j + 16) <= count; j += 16) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(weights + j), load8(src + j), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(weights + j + 8), load8(src + j + 8), acc1);
+        }
+        if((j + 8) <= count) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(weights + j), load8(src + j), acc0);
+            j += 8;
+        }
+        f32 value = horizontal_add(_mm256_add_ps(acc0, acc1));
+        for(; j < count; ++j) {
+            value += weights[j] * load_sample(src[j]);
+        }
+        values[0] += value;
+    }
+
+    template<class T>
+    RESAMCPP_TARGET_AVX2 void dot_avx2_2(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        // Duplicate each weight for the interleaved left and right samples
+        const __m256i duplicate = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        u32 j = 0;
+        for(; (j + 8) <= count; j += 8) {
+            __m256 w0 = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(weights + j)), duplicate);
+            __m256 w1 = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(weights + j + 4)), duplicate);
+            acc0 = _mm256_fmadd_ps(w0, load8(src + j * 2), acc0);
+            acc1 = _mm256_fmadd_ps(w1, load8(src + j * 2 + 8), acc1);
+        }
+        __m128 x4 = horizontal_add_2(_mm256_add_ps(acc0, acc1));
+        f32 left = _mm_cvtss_f32(x4);
+        f32 right = _mm_cvtss_f32(_mm_shuffle_ps(x4, x4, 0x55));
+        for(; j < count; ++j) {
+            left += weights[j] * load_sample(src[j * 2 + 0]);
+            right += weights[j] * load_sample(src[j * 2 + 1]);
+        }
+        values[0] += left;
+        values[1] += right;
+    }
+
+    template<class T>
+    RESAMCPP_TARGET_AVX2 void dot_avx2_6(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        // Load 8 samples per frame and ignore the last 2 lanes, the last frame is copied not to read over the input
+        __m256 acc = _mm256_setzero_ps();
+        if(0 < count) {
+            for(u32 j = 0; j < (count - 1); ++j) {
+                acc = _mm256_fmadd_ps(_mm256_broadcast_ss(weights + j), load8(src + j * 6), acc);
+            }
+            T last[8] = {};
+            ::memcpy(last, src + (count - 1) * 6, sizeof(T) * 6);
+            acc = _mm256_fmadd_ps(_mm256_broadcast_ss(weights + count - 1), load8(last), acc);
+        }
+        f32 x[8];
+        _mm256_storeu_ps(x, acc);
+        for(u32 k = 0; k < 6; ++k) {
+            values[k] += x[k];
+        }
+    }
+
+    template<class T>
+    RESAMCPP_TARGET_AVX2 void dot_avx2_8(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        // A frame fills a register, broadcast the weight
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        u32 j = 0;
+        for(; (j + 2) <= count; j += 2) {
+            acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(weights + j), load8(src + j * 8), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_broadcast_ss(weights + j + 1), load8(src + j * 8 + 8), acc1);
+        }
+        if(j < count) {
+            acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(weights + j), load8(src + j * 8), acc0);
+        }
+        _mm256_storeu_ps(values, _mm256_add_ps(_mm256_loadu_ps(values), _mm256_add_ps(acc0, acc1)));
+    }
+
+    template<class T>
+    RESAMCPP_TARGET_AVX2 void dot_avx2_16(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        // A frame fills two registers, broadcast the weight
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for(u32 j = 0; j < count; ++j) {
+            __m256 w = _mm256_broadcast_ss(weights + j);
+            acc0 = _mm256_fmadd_ps(w, load8(src + j * 16), acc0);
+            acc1 = _mm256_fmadd_ps(w, load8(src + j * 16 + 8), acc1);
+        }
+        _mm256_storeu_ps(values, _mm256_add_ps(_mm256_loadu_ps(values), acc0));
+        _mm256_storeu_ps(values + 8, _mm256_add_ps(_mm256_loadu_ps(values + 8), acc1));
+    }
+
+    RESAMCPP_TARGET_AVX2 f32 dot_planar_avx2(u32 count, const f32* weights, const f32* src)
+    {
+        f32 value = 0.0f;
+        dot_avx2_1<f32>(&value, 1, count, weights, src);
+        return value;
+    }
+
+#    if defined(__GNUC__) && !defined(__clang__)
+    // GCC warns about the undefined vectors inside of the AVX-512 intrinsics
+#        pragma GCC diagnostic push
+#        pragma GCC diagnostic ignored "-Wuninitialized"
+#        pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#    endif
+    RESAMCPP_TARGET_AVX512 inline __m256 reduce256(__m512 x)
+    {
+        return _mm256_add_ps(_mm512_castps512_ps256(x), _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)));
+    }
+
+    //--- Convert 16 samples to floats
+    RESAMCPP_TARGET_AVX512 inline __m512 load16(const u8* src)
+    {
+        __m512i x = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+        return _mm512_sub_ps(_mm512_cvtepi32_ps(x), _mm512_set1_ps(128.0f));
+    }
+
+    RESAMCPP_TARGET_AVX512 inline __m512 load16(const s16* src)
+    {
+        return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src))));
+    }
+
+    RESAMCPP_TARGET_AVX512 inline __m512 load16(const s32* src)
+    {
+        return _mm512_cvtepi32_ps(_mm512_loadu_si512(src));
+    }
+
+    RESAMCPP_TARGET_AVX512 inline __m512 load16(const f32* src)
+    {
+        return _mm512_loadu_ps(src);
+    }
+
+    template<class T>
+    RESAMCPP_TARGET_AVX512 void dot_avx512_1(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        __m512 acc0 = _mm512_setzero_ps();
+        __m512 acc1 = _mm512_setzero_ps();
+        u32 j = 0;
+        for(; (j + 32) <= count; j += 32) {
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(weights + j), load16(src + j), acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(weights + j + 16), load16(src + j + 16), acc1);
+        }
+        if((j + 16) <= count) {
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(weights + j), load16(src + j), acc0);
+            j += 16;
+        }
+        __m256 acc = reduce256(_mm512_add_ps(acc0, acc1));
+        if((j + 8) <= count) {
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(weights + j), load8(src + j), acc);
+            j += 8;
+        }
+        f32 value = horizontal_add(acc);
+        for(; j < count; ++j) {
+            value += weights[j] * load_sample(src[j]);
+        }
+        values[0] += value;
+    }
+
+    template<class T>
+    RESAMCPP_TARGET_AVX512 void dot_avx512_2(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        // Duplicate each weight for the interleaved left and right samples
+        const __m512i duplicate = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+        __m512 acc0 = _mm512_setzero_ps();
+        __m512 acc1 = _mm512_setzero_ps();
+        u32 j = 0;
+        for(; (j + 16) <= count; j += 16) {
+            __m512 w0 = _mm512_permutexvar_ps(duplicate, _mm512_castps256_ps512(_mm256_loadu_ps(weights + j)));
+            __m512 w1 = _mm512_permutexvar_ps(duplicate, _mm512_castps256_ps512(_mm256_loadu_ps(weights + j + 8)));
+            acc0 = _mm512_fmadd_ps(w0, load16(src + j * 2), acc0);
+            acc1 = _mm512_fmadd_ps(w1, load16(src + j * 2 + 16), acc1);
+        }
+        __m128 x4 = horizontal_add_2(reduce256(_mm512_add_ps(acc0, acc1)));
+        f32 left = _mm_cvtss_f32(x4);
+        f32 right = _mm_cvtss_f32(_mm_shuffle_ps(x4, x4, 0x55));
+        for(; j < count; ++j) {
+            left += weights[j] * load_sample(src[j * 2 + 0]);
+            right += weights[j] * load_sample(src[j * 2 + 1]);
+        }
+        values[0] += left;
+        values[1] += right;
+    }
+
+    template<class T>
+    RESAMCPP_TARGET_AVX512 void dot_avx512_16(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        // A frame fills a register, broadcast the weight
+        __m512 acc0 = _mm512_setzero_ps();
+        __m512 acc1 = _mm512_setzero_ps();
+        u32 j = 0;
+        for(; (j + 2) <= count; j += 2) {
+            acc0 = _mm512_fmadd_ps(_mm512_set1_ps(weights[j]), load16(src + j * 16), acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_set1_ps(weights[j + 1]), load16(src + j * 16 + 16), acc1);
+        }
+        if(j < count) {
+            acc0 = _mm512_fmadd_ps(_mm512_set1_ps(weights[j]), load16(src + j * 16), acc0);
+        }
+        _mm512_storeu_ps(values, _mm512_add_ps(_mm512_loadu_ps(values), _mm512_add_ps(acc0, acc1)));
+    }
+
+    RESAMCPP_TARGET_AVX512 f32 dot_planar_avx512(u32 count, const f32* weights, const f32* src)
+    {
+        f32 value = 0.0f;
+        dot_avx512_1<f32>(&value, 1, count, weights, src);
+        return value;
+    }
+#    if defined(__GNUC__) && !defined(__clang__)
+#        pragma GCC diagnostic pop
+#    endif
+
+    template<class T, bool = Vectorizable<T>::value>
+    struct KernelsX86
+    {
+        static DotFunction<T> get(Resampler::Kernel, u32)
+        {
+            return RESAMCPP_NULL;
+        }
+    };
+
+    template<class T>
+    struct KernelsX86<T, true>
+    {
+        static DotFunction<T> get(Resampler::Kernel kernel, u32 channels)
+        {
+            bool avx512 = Resampler::Kernel::AVX512 == kernel;
+            switch(channels) {
+            case 1:
+                return avx512 ? dot_avx512_1<T> : dot_avx2_1<T>;
+            case 2:
+                return avx512 ? dot_avx512_2<T> : dot_avx2_2<T>;
+            case 6:
+                return dot_avx2_6<T>;
+            case 8:
+                return dot_avx2_8<T>;
+            case 16:
+                return avx512 ? dot_avx512_16<T> : dot_avx2_16<T>;
+            default:
+                return RESAMCPP_NULL;
+            }
+        }
+    };
+#endif
+
+#ifdef RESAMCPP_NEON
+    inline float32x4_t multiply_add(float32x4_t acc, float32x4_t x0, float32x4_t x1)
+    {
+#    if defined(__aarch64__) || defined(_M_ARM64)
+        return vfmaq_f32(acc, x0, x1);
+#    else
+        return vmlaq_f32(acc, x0, x1);
+#    endif
+    }
+
+    inline f32 horizontal_add(float32x4_t x)
+    {
+        float32x2_t x2 = vadd_f32(vget_low_f32(x), vget_high_f32(x));
+        return vget_lane_f32(vpadd_f32(x2, x2), 0);
+    }
+
+    //--- Convert 4 samples to floats
+    inline float32x4_t load4(const u8* src)
+    {
+        u8 x[8] = {src[0], src[1], src[2], src[3]};
+        float32x4_t f = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vld1_u8(x)))));
+        return vsubq_f32(f, vdupq_n_f32(128.0f));
+    }
+
+    inline float32x4_t load4(const s16* src)
+    {
+        return vcvtq_f32_s32(vmovl_s16(vld1_s16(src)));
+    }
+
+    inline float32x4_t load4(const s32* src)
+    {
+        return vcvtq_f32_s32(vld1q_s32(src));
+    }
+
+    inline float32x4_t load4(const f32* src)
+    {
+        return vld1q_f32(src);
+    }
+
+    //--- De-interleave 4 stereo frames
+    template<class T>
+    inline void load4x2(const T* src, float32x4_t& left, float32x4_t& right)
+    {
+        T l[4] = {src[0], src[2], src[4], src[6]};
+        T r[4] = {src[1], src[3], src[5], src[7]};
+        left = load4(l);
+        right = load4(r);
+    }
+
+    inline void load4x2(const s16* src, float32x4_t& left, float32x4_t& right)
+    {
+        int16x4x2_t x = vld2_s16(src);
+        left = vcvtq_f32_s32(vmovl_s16(x.val[0]));
+        right = vcvtq_f32_s32(vmovl_s16(x.val[1]));
+    }
+
+    inline void load4x2(const s32* src, float32x4_t& left, float32x4_t& right)
+    {
+        int32x4x2_t x = vld2q_s32(src);
+        left = vcvtq_f32_s32(x.val[0]);
+        right = vcvtq_f32_s32(x.val[1]);
+    }
+
+    inline void load4x2(const f32* src, float32x4_t& left, float32x4_t& right)
+    {
+        float32x4x2_t x = vld2q_f32(src);
+        left = x.val[0];
+        right = x.val[1];
+    }
+
+    template<class T>
+    void dot_neon_1(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        u32 j = 0;
+        for(; (j + 8) <= count; j += 8) {
+            acc0 = multiply_add(acc0, vld1q_f32(weights + j), load4(src + j));
+            acc1 = multiply_add(acc1, vld1q_f32(weights + j + 4), load4(src + j + 4));
+        }
+        f32 value = horizontal_add(vaddq_f32(acc0, acc1));
+        for(; j < count; ++j) {
+            value += weights[j] * load_sample(src[j]);
+        }
+        values[0] += value;
+    }
+
+    template<class T>
+    void dot_neon_2(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        float32x4_t left = vdupq_n_f32(0.0f);
+        float32x4_t right = vdupq_n_f32(0.0f);
+        u32 j = 0;
+        for(; (j + 4) <= count; j += 4) {
+            float32x4_t l;
+            float32x4_t r;
+            load4x2(src + j * 2, l, r);
+            float32x4_t w = vld1q_f32(weights + j);
+            left = multiply_add(left, w, l);
+            right = multiply_add(right, w, r);
+        }
+        f32 l = horizontal_add(left);
+        f32 r = horizontal_add(right);
+        for(; j < count; ++j) {
+            l += weights[j] * load_sample(src[j * 2 + 0]);
+            r += weights[j] * load_sample(src[j * 2 + 1]);
+        }
+        values[0] += l;
+        values[1] += r;
+    }
+
+    template<class T>
+    void dot_neon_6(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        // Load 8 samples per frame and ignore the last 2 lanes, the last frame is copied not to read over the input
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        if(0 < count) {
+            for(u32 j = 0; j < (count - 1); ++j) {
+                float32x4_t w = vdupq_n_f32(weights[j]);
+                acc0 = multiply_add(acc0, w, load4(src + j * 6));
+                acc1 = multiply_add(acc1, w, load4(src + j * 6 + 4));
+            }
+            T last[8] = {};
+            ::memcpy(last, src + (count - 1) * 6, sizeof(T) * 6);
+            float32x4_t w = vdupq_n_f32(weights[count - 1]);
+            acc0 = multiply_add(acc0, w, load4(last));
+            acc1 = multiply_add(acc1, w, load4(last + 4));
+        }
+        f32 x[8];
+        vst1q_f32(x, acc0);
+        vst1q_f32(x + 4, acc1);
+        for(u32 k = 0; k < 6; ++k) {
+            values[k] += x[k];
+        }
+    }
+
+    template<class T>
+    void dot_neon_8(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        for(u32 j = 0; j < count; ++j) {
+            float32x4_t w = vdupq_n_f32(weights[j]);
+            acc0 = multiply_add(acc0, w, load4(src + j * 8));
+            acc1 = multiply_add(acc1, w, load4(src + j * 8 + 4));
+        }
+        vst1q_f32(values, vaddq_f32(vld1q_f32(values), acc0));
+        vst1q_f32(values + 4, vaddq_f32(vld1q_f32(values + 4), acc1));
+    }
+
+    template<class T>
+    void dot_neon_16(f32* values, u32, u32 count, const f32* weights, const T* src)
+    {
+        float32x4_t acc[4] = {vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f)};
+        for(u32 j = 0; j < count; ++j) {
+            float32x4_t w = vdupq_n_f32(weights[j]);
+            for(u32 k = 0; k < 4; ++k) {
+                acc[k] = multiply_add(acc[k], w, load4(src + j * 16 + k * 4));
+            }
+        }
+        for(u32 k = 0; k < 4; ++k) {
+            vst1q_f32(values + k * 4, vaddq_f32(vld1q_f32(values + k * 4), acc[k]));
+        }
+    }
+
+    f32 dot_planar_neon(u32 count, const f32* weights, const f32* src)
+    {
+        f32 value = 0.0f;
+        dot_neon_1<f32>(&value, 1, count, weights, src);
+        return value;
+    }
+
+    template<class T, bool = Vectorizable<T>::value>
+    struct KernelsNEON
+    {
+        static DotFunction<T> get(u32)
+        {
+            return RESAMCPP_NULL;
+        }
+    };
+
+    template<class T>
+    struct KernelsNEON<T, true>
+    {
+        static DotFunction<T> get(u32 channels)
+        {
+            switch(channels) {
+            case 1:
+                return dot_neon_1<T>;
+            case 2:
+                return dot_neon_2<T>;
+            case 6:
+                return dot_neon_6<T>;
+            case 8:
+                return dot_neon_8<T>;
+            case 16:
+                return dot_neon_16<T>;
+            default:
+                return RESAMCPP_NULL;
+            }
+        }
+    };
+#endif
+
+    Resampler::Kernel detect_kernel()
+    {
+#if defined(RESAMCPP_X86)
+        return detect_x86();
+#elif defined(RESAMCPP_NEON)
+        return Resampler::Kernel::NEON;
+#else
+        return Resampler::Kernel::Scalar;
+#endif
+    }
+
+    template<class T>
+    DotFunction<T> get_dot(Resampler::Kernel kernel, u32 channels)
+    {
+        DotFunction<T> dot = RESAMCPP_NULL;
+        switch(kernel) {
+#ifdef RESAMCPP_X86
+        case Resampler::Kernel::AVX2:
+        case Resampler::Kernel::AVX512:
+            dot = KernelsX86<T>::get(kernel, channels);
+            break;
+#endif
+#ifdef RESAMCPP_NEON
+        case Resampler::Kernel::NEON:
+            dot = KernelsNEON<T>::get(channels);
+            break;
+#endif
+        default:
+            break;
+        }
+        if(RESAMCPP_NULL != dot) {
+            return dot;
+        }
+        switch(channels) {
+        case 1:
+            return dot_scalar<1, T>;
+        case 2:
+            return dot_scalar<2, T>;
+        case 6:
+            return dot_scalar<6, T>;
+        case 8:
+            return dot_scalar<8, T>;
+        case 16:
+            return dot_scalar<16, T>;
+        default:
+            return dot_scalar<0, T>;
+        }
+    }
+
+    DotPlanarFunction get_dot_planar(Resampler::Kernel kernel)
+    {
+        switch(kernel) {
+#ifdef RESAMCPP_X86
+        case Resampler::Kernel::AVX2:
+            return dot_planar_avx2;
+        case Resampler::Kernel::AVX512:
+            return dot_planar_avx512;
+#endif
+#ifdef RESAMCPP_NEON
+        case Resampler::Kernel::NEON:
+            return dot_planar_neon;
+#endif
+        default:
+            return dot_planar_scalar;
+        }
+    }
+
+    /**
+    @brief Advance the time register n + p/phases by step/phases
+    */
+    template<class T>
+    inline void advance(T& n, u32& p, u32 integerStep, u32 phaseStep, u32 phases)
+    {
+        n += integerStep;
+        p += phaseStep;
+        if(phases <= p) {
+            p -= phases;
+            ++n;
+        }
+    }
+
+    template<class T>
+    inline void clear_values(T* values, u32 channels)
+    {
+        for(u32 k = 0; k < channels; ++k) {
+            values[k] = 0;
+        }
+    }
+
+    //--- The full scale of sample types, samples are accumulated in their own units
+    template<class T>
+    struct Format;
+
+    template<>
+    struct Format<u8>
+    {
+        static constexpr f32 FullScale = 128.0f;
+        static constexpr s32 Minimum = -128;
+        static constexpr s32 Maximum = 127;
+    };
+
+    template<>
+    struct Format<s16>
+    {
+        static constexpr f32 FullScale = 32768.0f;
+        static constexpr s32 Minimum = -32768;
+        static constexpr s32 Maximum = 32767;
+    };
+
+    template<>
+    struct Format<s24>
+    {
+        static constexpr f32 FullScale = 8388608.0f;
+        static constexpr s32 Minimum = -8388608;
+        static constexpr s32 Maximum = 8388607;
+    };
+
+    template<>
+    struct Format<s32>
+    {
+        static constexpr f32 FullScale = 2147483648.0f;
+        static constexpr s32 Minimum = -2147483647 - 1;
+        static constexpr s32 Maximum = 2147483647;
+    };
+
+    template<>
+    struct Format<f32>
+    {
+        static constexpr f32 FullScale = 1.0f;
+    };
+
+    /**
+    @brief Triangular noise in (-1, 1) for the sample index, the same index always gives the same noise
+    */
+    inline f64 tpdf(u64 index)
+    {
+        // splitmix64
+        u64 x = index + 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        const f64 unit = 1.0 / 4294967296.0;
+        return (static_cast<f64>(x & 0xFFFFFFFFULL) - static_cast<f64>(x >> 32)) * unit;
+    }
+
+    /**
+    @brief Quantize to an integer sample
+
+    Without dither the value is truncated toward zero, with dither the value plus TPDF noise of 1 LSB is rounded to nearest.
+    Both saturate to the range of the type.
+    */
+    template<class T>
+    inline s32 quantize(f32 value, f32 gain, bool dither, u64 index)
+    {
+        if(!dither) {
+            f64 x = static_cast<f64>(value) * gain;
+            RESAMCPP_STATS_SATURATE(x < Format<T>::Minimum || Format<T>::Maximum < x);
+            x = clamp(x, static_cast<f64>(Format<T>::Minimum), static_cast<f64>(Format<T>::Maximum));
+            return static_cast<s32>(x);
+        }
+        f64 x = floor(static_cast<f64>(value) * gain + tpdf(index) + 0.5);
+        RESAMCPP_STATS_SATURATE(x < Format<T>::Minimum || Format<T>::Maximum < x);
+        x = clamp(x, static_cast<f64>(Format<T>::Minimum), static_cast<f64>(Format<T>::Maximum));
+        return static_cast<s32>(x);
+    }
+
+    template<>
+    inline s32 quantize<s16>(f32 value, f32 gain, bool dither, u64 index)
+    {
+        if(!dither) {
+            s32 x = (s32)(value * gain);
+            RESAMCPP_STATS_SATURATE(x < -32768 || 32767 < x);
+            return clamp(x, -32768, 32767);
+        }
+        f64 x = floor(static_cast<f64>(value) * gain + tpdf(index) + 0.5);
+        RESAMCPP_STATS_SATURATE(x < -32768.0 || 32767.0 < x);
+        return static_cast<s32>(clamp(x, -32768.0, 32767.0));
+    }
+
+    inline void store_sample(u8& dst, f32 value, f32 gain, bool dither, u64 index)
+    {
+        dst = static_cast<u8>(quantize<u8>(value, gain, dither, index) + 128);
+    }
+
+    inline void store_sample(s16& dst, f32 value, f32 gain, bool dither, u64 index)
+    {
+        dst = static_cast<s16>(quantize<s16>(value, gain, dither, index));
+    }
+
+    inline void store_sample(s24& dst, f32 value, f32 gain, bool dither, u64 index)
+    {
+        u32 x = static_cast<u32>(quantize<s24>(value, gain, dither, index));
+        dst.bytes_[0] = static_cast<u8>(x);
+        dst.bytes_[1] = static_cast<u8>(x >> 8);
+        dst.bytes_[2] = static_cast<u8>(x >> 16);
+    }
+
+    inline void store_sample(s32& dst, f32 value, f32 gain, bool dither, u64 index)
+    {
+        dst = quantize<s32>(value, gain, dither, index);
+    }
+
+    inline void store_sample(f32& dst, f32 value, f32 gain, bool, u64)
+    {
+        dst = value * gain;
+    }
+
+    /**
+    @param index ... the index of the first sample of the frame, which seeds the dither
+    */
+    template<class T>
+    inline void store_frame(T* dst, u32 channels, const f32* values, f32 gain, bool dither, u64 index)
+    {
+        for(u32 j = 0; j < channels; ++j) {
+            store_sample(dst[j], values[j], gain, dither, index + j);
+        }
+    }
+
+    /**
+    @brief The gain converting accumulated Src units into Dst units including the filter scale
+    */
+    template<class Dst, class Src>
+    inline f32 get_gain(f32 scale)
+    {
+        return scale * (Format<Dst>::FullScale / Format<Src>::FullScale);
+    }
+
+    /**
+    @brief The step through the table of a filter per input frame, which is stepped by whole indices
+    */
+    inline u32 get_index_step(const Filter& filter, f64 sampleRatio)
+    {
+        return static_cast<u32>(minimum(1.0f, static_cast<f32>(sampleRatio)) * filter.oversample_);
+    }
+
+    u32 gcd(u32 x0, u32 x1)
+    {
+        while(0 != x1) {
+            u32 t = x0 % x1;
+            x0 = x1;
+            x1 = t;
+        }
+        return x0;
+    }
+
+    void* aligned_malloc(size_t size, size_t alignment)
+    {
+        u8* memory = reinterpret_cast<u8*>(::malloc(size + alignment + sizeof(void*)));
+        if(RESAMCPP_NULL == memory) {
+            return RESAMCPP_NULL;
+        }
+        uintptr_t address = reinterpret_cast<uintptr_t>(memory + sizeof(void*));
+        address = (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        reinterpret_cast<void**>(address)[-1] = memory;
+        return reinterpret_cast<void*>(address);
+    }
+
+    void aligned_free(void* ptr)
+    {
+        if(RESAMCPP_NULL != ptr) {
+            ::free(reinterpret_cast<void**>(ptr)[-1]);
+        }
+    }
+
+    /**
+    @brief Evaluate the interpolated filter at every phase of a rational ratio
+
+    Row p holds the weights for the output time n + p/phases, the weight k is applied to the input frame n - wing + 1 + k.
+    */
+    void build_bank(f32* bank, u32 phases, u32 width, u32 wing, const Filter& filter, f32 scale, u32 indexStep)
+    {
+        for(u32 p = 0; p < phases; ++p) {
+            f64 frac = scale * (static_cast<f64>(p) / phases);
+            build_row(bank + static_cast<size_t>(p) * width, width, wing, filter, scale, indexStep, frac);
+        }
+    }
+
+    //--- Minimum phase
+    constexpr u32 MaxMinimumPhaseFFT = 1U << 21;
+    constexpr f64 MinimumPhaseFloor = 1.0e-10; //!< the magnitude floor relative to the peak, -200 dB
+
+    /**
+    @brief In-place complex FFT of a power of 2 size, the inverse is not scaled
+    @param twiddles ... exp(-2 pi i k / size) for k in [0, size/2), interleaved
+    */
+    void fft(f64* re, f64* im, u32 size, const f64* twiddles, bool inverse)
+    {
+        for(u32 i = 1, j = 0; i < size; ++i) {
+            u32 bit = size >> 1;
+            for(; 0 != (j & bit); bit >>= 1) {
+                j ^= bit;
+            }
+            j ^= bit;
+            if(i < j) {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+        f64 sign = inverse ? -1.0 : 1.0;
+        for(u32 length = 2; length <= size; length <<= 1) {
+            u32 half = length >> 1;
+            u32 stride = size / length;
+            for(u32 i = 0; i < size; i += length) {
+                for(u32 j = 0; j < half; ++j) {
+                    f64 wr = twiddles[j * stride * 2];
+                    f64 wi = sign * twiddles[j * stride * 2 + 1];
+                    u32 a = i + j;
+                    u32 b = a + half;
+                    f64 xr = re[b] * wr - im[b] * wi;
+                    f64 xi = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - xr;
+                    im[b] = im[a] - xi;
+                    re[a] += xr;
+                    im[a] += xi;
+                }
+            }
+        }
+    }
+
+    /**
+    @brief Replace taps with the minimum phase filter of the same magnitude response, by folding the real cepstrum
+
+    The FFT is longer than the filter to keep the cepstrum from aliasing, and zeros in the stopband are raised to a floor.
+    */
+    bool make_minimum_phase(f64* taps, u32 length)
+    {
+        const f64 pi = 3.14159265358979323846;
+        u32 size = 1;
+        while(size < length) {
+            size <<= 1;
+        }
+        size = maximum(minimum(size * 8, MaxMinimumPhaseFFT), size * 2);
+        if(MaxMinimumPhaseFFT < size) {
+            return false;
+        }
+        f64* memory = reinterpret_cast<f64*>(::calloc(static_cast<size_t>(size) * 3, sizeof(f64)));
+        if(RESAMCPP_NULL == memory) {
+            return false;
+        }
+        f64* re = memory;
+        f64* im = memory + size;
+        f64* twiddles = memory + size * 2;
+        for(u32 k = 0; k < size / 2; ++k) {
+            twiddles[k * 2] = cos(2.0 * pi * k / size);
+            twiddles[k * 2 + 1] = -sin(2.0 * pi * k / size);
+        }
+        for(u32 i = 0; i < size; ++i) {
+            re[i] = (i < length) ? taps[i] : 0.0;
+            im[i] = 0.0;
+        }
+
+        // The real cepstrum is the inverse transform of the log magnitude
+        fft(re, im, size, twiddles, false);
+        f64 peak = 0.0;
+        for(u32 i = 0; i < size; ++i) {
+            re[i] = sqrt(re[i] * re[i] + im[i] * im[i]);
+            peak = maximum(peak, re[i]);
+        }
+        f64 floor = peak * MinimumPhaseFloor;
+        for(u32 i = 0; i < size; ++i) {
+            re[i] = log(maximum(re[i], floor));
+            im[i] = 0.0;
+        }
+        fft(re, im, size, twiddles, true);
+
+        // Fold the anticausal part onto the causal one
+        for(u32 i = 1; i < size / 2; ++i) {
+            re[i] *= 2.0;
+        }
+        for(u32 i = size / 2 + 1; i < size; ++i) {
+            re[i] = 0.0;
+        }
+        for(u32 i = 0; i < size; ++i) {
+            re[i] /= size;
+            im[i] = 0.0;
+        }
+
+        // Back to the spectrum, and its exponential is the minimum phase response
+        fft(re, im, size, twiddles, false);
+        for(u32 i = 0; i < size; ++i) {
+            f64 magnitude = exp(re[i]);
+            f64 phase = im[i];
+            re[i] = magnitude * cos(phase);
+            im[i] = magnitude * sin(phase);
+        }
+        fft(re, im, size, twiddles, true);
+        for(u32 i = 0; i < length; ++i) {
+            taps[i] = re[i] / size;
+        }
+        ::free(memory);
+        return true;
+    }
+
+    /**
+    @brief Build a minimum phase bank, whose rows hold taps frames at or before the frame of the output time
+
+    The weight k of the row p samples a prototype at phases times the input frequency, at the index p + (taps - 1 - k) * phases.
+    The linear phase prototype is evaluated from the design in f64 at the exact scale, the table is too coarse for it,
+    then it is turned into minimum phase.
+    @param delay ... the group delay at DC in input frames
+    */
+    bool build_minimum_phase(f32* bank, u32 phases, u32 width, u32 taps, const FilterDesign& design, f64 scale, f64& delay)
+    {
+        u32 length = phases * taps;
+        f64* prototype = reinterpret_cast<f64*>(::malloc(sizeof(f64) * length));
+        if(RESAMCPP_NULL == prototype) {
+            return false;
+        }
+        // The time from the input frame to the output time is i/phases - taps/2
+        f64 center = 0.5 * taps;
+        f64 window = 1.0 / bessel_i0(design.beta_);
+        for(u32 i = 0; i < length; ++i) {
+            prototype[i] = get_filter_value(design, window, (static_cast<f64>(i) / phases - center) * scale);
+        }
+        if(!make_minimum_phase(prototype, length)) {
+            ::free(prototype);
+            return false;
+        }
+        f64 sum = 0.0;
+        f64 moment = 0.0;
+        for(u32 i = 0; i < length; ++i) {
+            sum += prototype[i];
+            moment += prototype[i] * i;
+        }
+        delay = moment / sum / phases;
+        ::memset(bank, 0, sizeof(f32) * phases * width);
+        for(u32 p = 0; p < phases; ++p) {
+            for(u32 k = 0; k < taps; ++k) {
+                bank[static_cast<size_t>(p) * width + k] = static_cast<f32>(prototype[p + (taps - 1 - k) * phases]);
+            }
+        }
+        ::free(prototype);
+        return true;
+    }
+
+    //--- Q15 fixed point for s16 pipelines, weights are s16, vector lanes accumulate products in s32 and their sum is s64
+    constexpr u32 FixedShift = 15;
+    constexpr u32 FixedResidues = 4; //!< a vector lane accumulates the taps of at most 2 residues modulo this
+    constexpr s64 FixedMaxLaneSum = 65535; //!< the sum of absolute weights of a lane, which can not overflow s32 with full scale samples
+
+    /**
+    @brief Round the rows of a polyphase bank times scale to Q15 to nearest
+    @param copy ... the phase 0 is a copy of the input frame, whose weight 1 is not representable
+    @return false if a lane can overflow its accumulator
+    */
+    bool build_fixed_bank(s16* fixedBank, const f32* bank, u32 phases, u32 width, f32 scale, bool copy)
+    {
+        const f64 one = static_cast<f64>(1 << FixedShift);
+        ::memset(fixedBank, 0, sizeof(s16) * phases * width);
+        for(u32 p = (copy ? 1 : 0); p < phases; ++p) {
+            const f32* row = bank + static_cast<size_t>(p) * width;
+            s16* fixedRow = fixedBank + static_cast<size_t>(p) * width;
+            for(u32 k = 0; k < width; ++k) {
+                s64 x = static_cast<s64>(floor(static_cast<f64>(row[k]) * scale * one + 0.5));
+                if(x < -32767 || 32767 < x) {
+                    return false;
+                }
+                fixedRow[k] = static_cast<s16>(x);
+            }
+
+            // The window is clipped at the edges, so a lane can start from any residue
+            s64 residues[FixedResidues] = {};
+            for(u32 k = 0; k < width; ++k) {
+                residues[k % FixedResidues] += std::abs(fixedRow[k]);
+            }
+            for(u32 r0 = 0; r0 < FixedResidues; ++r0) {
+                for(u32 r1 = r0 + 1; r1 < FixedResidues; ++r1) {
+                    if(FixedMaxLaneSum < residues[r0] + residues[r1]) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+    @brief Round a Q15 sum to nearest, adding TPDF noise of 1 LSB with dither, and saturate to s16
+    */
+    inline s16 round_fixed(s64 value, bool dither, u64 index)
+    {
+        s64 x = value + (1 << (FixedShift - 1));
+        if(dither) {
+            x += static_cast<s64>(floor(tpdf(index) * (1 << FixedShift) + 0.5));
+        }
+        // Arithmetic shift, which is the floor of the division
+        x >>= FixedShift;
+        RESAMCPP_STATS_SATURATE(x < -32768 || 32767 < x);
+        return static_cast<s16>(clamp(x, static_cast<s64>(-32768), static_cast<s64>(32767)));
+    }
+
+    using FixedDotFunction = void (*)(s64* values, u32 channels, u32 count, const s16* weights, const s16* src);
+
+    template<u32 C>
+    void dot_fixed_scalar(s64* values, u32 channels, u32 count, const s16* weights, const s16* src)
+    {
+        const u32 numChannels = (0 == C) ? channels : C;
+        for(u32 j = 0; j < count; ++j) {
+            s32 weight = weights[j];
+            const s16* s = src + j * numChannels;
+            for(u32 k = 0; k < numChannels; ++k) {
+                values[k] += weight * s[k];
+            }
+        }
+    }
+
+#ifdef RESAMCPP_X86
+    //--- Sum s32 lanes in s64, the even and odd lanes separately
+    RESAMCPP_TARGET_AVX2 inline void horizontal_add_2(s64 sums[2], __m256i x)
+    {
+        __m256i x4 = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)), _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+        __m128i x2 = _mm_add_epi64(_mm256_castsi256_si128(x4), _mm256_extracti128_si256(x4, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), x2);
+    }
+
+    //--- pmaddwd multiplies 16 pairs of s16 and adds neighbors into 8 s32
+    RESAMCPP_TARGET_AVX2 void dot_fixed_avx2_1(s64* values, u32, u32 count, const s16* weights, const s16* src)
+    {
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        u32 j = 0;
+        for(; (j + 32) <= count; j += 32) {
+            __m256i w0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + j));
+            __m256i w1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + j + 16));
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(w0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j))));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(w1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j + 16))));
+        }
+        for(; (j + 16) <= count; j += 16) {
+            __m256i w0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + j));
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(w0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j))));
+        }
+        s64 sums0[2];
+        s64 sums1[2];
+        horizontal_add_2(sums0, acc0);
+        horizontal_add_2(sums1, acc1);
+        s64 value = sums0[0] + sums0[1] + sums1[0] + sums1[1];
+        for(; j < count; ++j) {
+            value += static_cast<s32>(weights[j]) * src[j];
+        }
+        values[0] += value;
+    }
+
+    RESAMCPP_TARGET_AVX2 void dot_fixed_avx2_2(s64* values, u32, u32 count, const s16* weights, const s16* src)
+    {
+        // Pair 2 frames of a channel as L0 L1 R0 R1, and duplicate the pair of weights for both channels
+        const __m256i frames = _mm256_setr_epi8(
+            0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15,
+            0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15);
+        const __m256i pairs = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+        __m256i acc = _mm256_setzero_si256();
+        u32 j = 0;
+        for(; (j + 8) <= count; j += 8) {
+            __m256i s = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j * 2)), frames);
+            __m256i w = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + j))), pairs);
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(w, s));
+        }
+        s64 sums[2];
+        horizontal_add_2(sums, acc);
+        for(; j < count; ++j) {
+            sums[0] += static_cast<s32>(weights[j]) * src[j * 2 + 0];
+            sums[1] += static_cast<s32>(weights[j]) * src[j * 2 + 1];
+        }
+        values[0] += sums[0];
+        values[1] += sums[1];
+    }
+
+    template<u32 C>
+    RESAMCPP_TARGET_AVX2 inline __m128i load_frame(const s16* src)
+    {
+        if(8 == C) {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        }
+        s32 tail;
+        ::memcpy(&tail, src + 4, sizeof(s32));
+        return _mm_insert_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)), tail, 2);
+    }
+
+    //--- Interleave 2 frames of 6 or 8 channels into pairs of a channel, which are multiplied by a pair of weights
+    template<u32 C>
+    RESAMCPP_TARGET_AVX2 void dot_fixed_avx2_n(s64* values, u32, u32 count, const s16* weights, const s16* src)
+    {
+        // Alternate the accumulators, so that a lane sums 2 residues of taps modulo 4
+        __m256i acc[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+        u32 j = 0;
+        for(; (j + 2) <= count; j += 2) {
+            __m128i f0 = load_frame<C>(src + j * C);
+            __m128i f1 = load_frame<C>(src + (j + 1) * C);
+            __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(f0, f1)), _mm_unpackhi_epi16(f0, f1), 1);
+            s32 pair;
+            ::memcpy(&pair, weights + j, sizeof(s32));
+            __m256i& a = acc[(j >> 1) & 1];
+            a = _mm256_add_epi32(a, _mm256_madd_epi16(x, _mm256_set1_epi32(pair)));
+        }
+        alignas(32) s32 lanes0[8];
+        alignas(32) s32 lanes1[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes0), acc[0]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes1), acc[1]);
+        for(u32 k = 0; k < C; ++k) {
+            values[k] += static_cast<s64>(lanes0[k]) + lanes1[k];
+        }
+        for(; j < count; ++j) {
+            for(u32 k = 0; k < C; ++k) {
+                values[k] += static_cast<s32>(weights[j]) * src[j * C + k];
+            }
+        }
+    }
+#endif
+
+#ifdef RESAMCPP_NEON
+    inline s64 horizontal_add(int32x4_t x)
+    {
+        int64x2_t x2 = vpaddlq_s32(x);
+        return vgetq_lane_s64(x2, 0) + vgetq_lane_s64(x2, 1);
+    }
+
+    //--- vmlal multiplies 4 pairs of s16 and accumulates into 4 s32
+    void dot_fixed_neon_1(s64* values, u32, u32 count, const s16* weights, const s16* src)
+    {
+        int32x4_t acc0 = vdupq_n_s32(0);
+        int32x4_t acc1 = vdupq_n_s32(0);
+        u32 j = 0;
+        for(; (j + 8) <= count; j += 8) {
+            int16x8_t w = vld1q_s16(weights + j);
+            int16x8_t s = vld1q_s16(src + j);
+            acc0 = vmlal_s16(acc0, vget_low_s16(w), vget_low_s16(s));
+            acc1 = vmlal_s16(acc1, vget_high_s16(w), vget_high_s16(s));
+        }
+        s64 value = horizontal_add(acc0) + horizontal_add(acc1);
+        for(; j < count; ++j) {
+            value += static_cast<s32>(weights[j]) * src[j];
+        }
+        values[0] += value;
+    }
+
+    void dot_fixed_neon_2(s64* values, u32, u32 count, const s16* weights, const s16* src)
+    {
+        int32x4_t left = vdupq_n_s32(0);
+        int32x4_t right = vdupq_n_s32(0);
+        u32 j = 0;
+        for(; (j + 4) <= count; j += 4) {
+            int16x4x2_t s = vld2_s16(src + j * 2);
+            int16x4_t w = vld1_s16(weights + j);
+            left = vmlal_s16(left, w, s.val[0]);
+            right = vmlal_s16(right, w, s.val[1]);
+        }
+        s64 l = horizontal_add(left);
+        s64 r = horizontal_add(right);
+        for(; j < count; ++j) {
+            l += static_cast<s32>(weights[j]) * src[j * 2 + 0];
+            r += static_cast<s32>(weights[j]) * src[j * 2 + 1];
+        }
+        values[0] += l;
+        values[1] += r;
+    }
+
+    template<u32 C>
+    void dot_fixed_neon_n(s64* values, u32, u32 count, const s16* weights, const s16* src)
+    {
+        // Alternate the accumulators, so that a lane sums 2 residues of taps modulo 4
+        int32x4_t low[2] = {vdupq_n_s32(0), vdupq_n_s32(0)};
+        int32x4_t high[2] = {vdupq_n_s32(0), vdupq_n_s32(0)};
+        for(u32 j = 0; j < count; ++j) {
+            const s16* s = src + j * C;
+            int16x4_t h = vdup_n_s16(0);
+            if(8 == C) {
+                h = vld1_s16(s + 4);
+            } else {
+                h = vld1_lane_s16(s + 4, h, 0);
+                h = vld1_lane_s16(s + 5, h, 1);
+            }
+            u32 a = (j >> 1) & 1;
+            low[a] = vmlal_n_s16(low[a], vld1_s16(s), weights[j]);
+            high[a] = vmlal_n_s16(high[a], h, weights[j]);
+        }
+        s32 lanes[16];
+        vst1q_s32(lanes + 0, low[0]);
+        vst1q_s32(lanes + 4, high[0]);
+        vst1q_s32(lanes + 8, low[1]);
+        vst1q_s32(lanes + 12, high[1]);
+        for(u32 k = 0; k < C; ++k) {
+            values[k] += static_cast<s64>(lanes[k]) + lanes[8 + k];
+        }
+    }
+#endif
+
+    FixedDotFunction get_fixed_dot(Resampler::Kernel kernel, u32 channels)
+    {
+        switch(kernel) {
+#ifdef RESAMCPP_X86
+        case Resampler::Kernel::AVX2:
+        case Resampler::Kernel::AVX512:
+            switch(channels) {
+            case 1:
+                return dot_fixed_avx2_1;
+            case 2:
+                return dot_fixed_avx2_2;
+            case 6:
+                return dot_fixed_avx2_n<6>;
+            case 8:
+                return dot_fixed_avx2_n<8>;
+            default:
+                break;
+            }
+            break;
+#endif
+#ifdef RESAMCPP_NEON
+        case Resampler::Kernel::NEON:
+            switch(channels) {
+            case 1:
+                return dot_fixed_neon_1;
+            case 2:
+                return dot_fixed_neon_2;
+            case 6:
+                return dot_fixed_neon_n<6>;
+            case 8:
+                return dot_fixed_neon_n<8>;
+            default:
+                break;
+            }
+            break;
+#endif
+        default:
+            break;
+        }
+        switch(channels) {
+        case 1:
+            return dot_fixed_scalar<1>;
+        case 2:
+            return dot_fixed_scalar<2>;
+        case 6:
+            return dot_fixed_scalar<6>;
+        case 8:
+            return dot_fixed_scalar<8>;
+        default:
+            return dot_fixed_scalar<0>;
+        }
+    }
+
+    /**
+    @brief Whether a pipeline can run in fixed point, s16 to s16 only
+    */
+    template<class Dst, class Src>
+    struct FixedPipeline
+    {
+        static constexpr bool value = false;
+    };
+
+    template<>
+    struct FixedPipeline<s16, s16>
+    {
+        static constexpr bool value = true;
+    };
+
+    constexpr u32 DecimateBlock = 1024; //!< the number of output frames of a channel decimated at once
+
+    //--- values[i] += the sum of taps[k] * (left[i - k] + right[i + k])
+    using PairFunction = void (*)(f32* values, u32 count, const f32* left, const f32* right, u32 length, const f32* taps);
+
+    void filter_pairs_scalar(f32* values, u32 count, const f32* left, const f32* right, u32 length, const f32* taps)
+    {
+        for(u32 i = 0; i < count; ++i) {
+            f32 value = values[i];
+            for(u32 k = 0; k < length; ++k) {
+                value += taps[k] * ((left - k)[i] + right[i + k]);
+            }
+            values[i] = value;
+        }
+    }
+
+#ifdef RESAMCPP_X86
+    /**
+    @brief Accumulate 16 outputs in registers over all taps
+    */
+    RESAMCPP_TARGET_AVX2 void filter_pairs_avx2(f32* values, u32 count, const f32* left, const f32* right, u32 length, const f32* taps)
+    {
+        u32 i = 0;
+        for(; (i + 16) <= count; i += 16) {
+            __m256 acc0 = _mm256_loadu_ps(values + i);
+            __m256 acc1 = _mm256_loadu_ps(values + i + 8);
+            const f32* l = left + i;
+            const f32* r = right + i;
+            for(u32 k = 0; k < length; ++k) {
+                __m256 tap = _mm256_broadcast_ss(taps + k);
+                acc0 = _mm256_fmadd_ps(tap, _mm256_add_ps(_mm256_loadu_ps(l - k), _mm256_loadu_ps(r + k)), acc0);
+                acc1 = _mm256_fmadd_ps(tap, _mm256_add_ps(_mm256_loadu_ps(l - k + 8), _mm256_loadu_ps(r + k + 8)), acc1);
+            }
+            _mm256_storeu_ps(values + i, acc0);
+            _mm256_storeu_ps(values + i + 8, acc1);
+        }
+        filter_pairs_scalar(values + i, count - i, left + i, right + i, length, taps);
+    }
+#endif
+
+#ifdef RESAMCPP_NEON
+    void filter_pairs_neon(f32* values, u32 count, const f32* left, const f32* right, u32 length, const f32* taps)
+    {
+        u32 i = 0;
+        for(; (i + 8) <= count; i += 8) {
+            float32x4_t acc0 = vld1q_f32(values + i);
+            float32x4_t acc1 = vld1q_f32(values + i + 4);
+            const f32* l = left + i;
+            const f32* r = right + i;
+            for(u32 k = 0; k < length; ++k) {
+                float32x4_t tap = vdupq_n_f32(taps[k]);
+                acc0 = multiply_add(acc0, tap, vaddq_f32(vld1q_f32(l - k), vld1q_f32(r + k)));
+                acc1 = multiply_add(acc1, tap, vaddq_f32(vld1q_f32(l - k + 4), vld1q_f32(r + k + 4)));
+            }
+            vst1q_f32(values + i, acc0);
+            vst1q_f32(values + i + 4, acc1);
+        }
+        filter_pairs_scalar(values + i, count - i, left + i, right + i, length, taps);
+    }
+#endif
+
+    PairFunction get_pairs(Resampler::Kernel kernel)
+    {
+        switch(kernel) {
+#ifdef RESAMCPP_X86
+        case Resampler::Kernel::AVX2:
+        case Resampler::Kernel::AVX512:
+            return filter_pairs_avx2;
+#endif
+#ifdef RESAMCPP_NEON
+        case Resampler::Kernel::NEON:
+            return filter_pairs_neon;
+#endif
+        default:
+            return filter_pairs_scalar;
+        }
+    }
+
+    //--- values[i] = the sum of taps[k] * src[i + k]
+    using DenseFunction = void (*)(f32* values, u32 count, const f32* src, u32 length, const f32* taps);
+
+    void filter_dense_scalar(f32* values, u32 count, const f32* src, u32 length, const f32* taps)
+    {
+        for(u32 i = 0; i < count; ++i) {
+            f32 value = 0.0f;
+            for(u32 k = 0; k < length; ++k) {
+                value += taps[k] * src[i + k];
+            }
+            values[i] = value;
+        }
+    }
+
+#ifdef RESAMCPP_X86
+    RESAMCPP_TARGET_AVX2 void filter_dense_avx2(f32* values, u32 count, const f32* src, u32 length, const f32* taps)
+    {
+        u32 i = 0;
+        for(; (i + 16) <= count; i += 16) {
+            __m256 acc0 = _mm256_setzero_ps();
+            __m256 acc1 = _mm256_setzero_ps();
+            const f32* s = src + i;
+            for(u32 k = 0; k < length; ++k) {
+                __m256 tap = _mm256_broadcast_ss(taps + k);
+                acc0 = _mm256_fmadd_ps(tap, _mm256_loadu_ps(s + k), acc0);
+                acc1 = _mm256_fmadd_ps(tap, _mm256_loadu_ps(s + k + 8), acc1);
+            }
+            _mm256_storeu_ps(values + i, acc0);
+            _mm256_storeu_ps(values + i + 8, acc1);
+        }
+        filter_dense_scalar(values + i, count - i, src + i, length, taps);
+    }
+#endif
+
+#ifdef RESAMCPP_NEON
+    void filter_dense_neon(f32* values, u32 count, const f32* src, u32 length, const f32* taps)
+    {
+        u32 i = 0;
+        for(; (i + 8) <= count; i += 8) {
+            float32x4_t acc0 = vdupq_n_f32(0.0f);
+            float32x4_t acc1 = vdupq_n_f32(0.0f);
+            const f32* s = src + i;
+            for(u32 k = 0; k < length; ++k) {
+                float32x4_t tap = vdupq_n_f32(taps[k]);
+                acc0 = multiply_add(acc0, tap, vld1q_f32(s + k));
+                acc1 = multiply_add(acc1, tap, vld1q_f32(s + k + 4));
+            }
+            vst1q_f32(values + i, acc0);
+            vst1q_f32(values + i + 4, acc1);
+        }
+        filter_dense_scalar(values + i, count - i, src + i, length, taps);
+    }
+#endif
+
+    DenseFunction get_dense(Resampler::Kernel kernel)
+    {
+        switch(kernel) {
+#ifdef RESAMCPP_X86
+        case Resampler::Kernel::AVX2:
+        case Resampler::Kernel::AVX512:
+            return filter_dense_avx2;
+#endif
+#ifdef RESAMCPP_NEON
+        case Resampler::Kernel::NEON:
+            return filter_dense_neon;
+#endif
+        default:
+            return filter_dense_scalar;
+        }
+    }
+
+    /**
+    @brief Gather every step-th frame of a channel into f32, frames outside of [0, frames) are zero
+    */
+    template<class T>
+    void gather(f32* dst, u32 count, s64 first, u32 step, u32 channels, u32 frames, const T* src)
+    {
+        if(0 <= first && first + static_cast<s64>(count) * step <= frames) {
+            const T* s = src + first * channels;
+            size_t stride = static_cast<size_t>(channels) * step;
+            for(u32 i = 0; i < count; ++i) {
+                dst[i] = load_sample(s[i * stride]);
+            }
+            return;
+        }
+        for(u32 i = 0; i < count; ++i) {
+            s64 n = first + static_cast<s64>(i) * step;
+            dst[i] = (0 <= n && n < frames) ? load_sample(src[n * channels]) : 0.0f;
+        }
+    }
+
+    /**
+    @brief The floats of the scratch for decimate
+    */
+    constexpr size_t get_decimate_scratch(u32 factor, u32 reach)
+    {
+        return DecimateBlock + static_cast<size_t>(factor) * (DecimateBlock + reach * 2);
+    }
+
+    /**
+    @brief Decimate by factor with a Nyquist filter, whose taps at multiples of factor are zero except the center
+
+    The output frame m is centered at the input frame m * factor.
+    A block of a channel is split into factor phases of frames, then the frames at the same distance on both sides,
+    which are contiguous in two phases, are summed and multiplied by their tap. Zero taps are skipped.
+    @param taps ... lengths[r - 1] taps at the distances r, r + factor, r + factor * 2, ... for each r in [1, factor)
+    @param scratch ... get_decimate_scratch(factor, the maximum of lengths) floats
+    */
+    template<class Dst, class Src>
+    void decimate(PairFunction filter, u32 channels, u32 begin, u32 end, Dst* dst, u32 srcFrames, const Src* src, u32 factor, f32 center, const u32* lengths, const f32* taps, f32 gain, bool dither, f32* scratch)
+    {
+        u32 reach = 0;
+        for(u32 r = 1; r < factor; ++r) {
+            reach = maximum(reach, lengths[r - 1]);
+        }
+        // The phase q holds the frames (m - reach + i) * factor + q of a block from m
+        f32* values = scratch;
+        f32* phases[Resampler::MaxFactor];
+        for(u32 q = 0; q < factor; ++q) {
+            phases[q] = scratch + DecimateBlock + static_cast<size_t>(q) * (DecimateBlock + reach * 2);
+        }
+        for(u32 k = 0; k < channels; ++k) {
+            for(u32 m = begin; m < end; m += DecimateBlock) {
+                u32 count = minimum(DecimateBlock, end - m);
+                for(u32 q = 0; q < factor; ++q) {
+                    gather(phases[q], count + reach * 2, (static_cast<s64>(m) - reach) * factor + q, factor, channels, srcFrames, src + k);
+                }
+                for(u32 i = 0; i < count; ++i) {
+                    values[i] = center * phases[0][reach + i];
+                }
+                const f32* t = taps;
+                for(u32 r = 1; r < factor; ++r) {
+                    // The left frame at the distance r + factor * j is in the phase factor - r, and the right one is in the phase r
+                    filter(values, count, phases[factor - r] + reach - 1, phases[r] + reach, lengths[r - 1], t);
+                    t += lengths[r - 1];
+                }
+                for(u32 i = 0; i < count; ++i) {
+                    u64 index = static_cast<u64>(m + i) * channels + k;
+                    store_sample(dst[index], values[i], gain, dither, index);
+                }
+            }
+        }
+    }
+
+    /**
+    @brief The floats of the scratch for expand
+    */
+    constexpr size_t get_expand_scratch(u32 wing)
+    {
+        return DecimateBlock * 2 + static_cast<size_t>(wing) * 2;
+    }
+
+    /**
+    @brief Upsample by factor with a Nyquist filter, whose phase 0 is the input frame itself
+
+    A block of a channel is gathered into f32, then every other phase is a FIR over the contiguous frames for all outputs of the block.
+    The middle phase is symmetric, which multiplies the sum of the frames at the same distance on both sides.
+    @param bank ... the weight k of the row p is applied to the input frame n - wing + 1 + k for the output frame n * factor + p
+    @param scratch ... get_expand_scratch(wing) floats
+    */
+    template<class Dst, class Src>
+    void expand(PairFunction pairs, DenseFunction dense, u32 channels, u32 begin, u32 end, Dst* dst, u32 srcFrames, const Src* src, u32 factor, const f32* bank, u32 width, u32 wing, f32 gain, bool dither, f32* scratch)
+    {
+        f32* values = scratch;
+        f32* frames = scratch + DecimateBlock;
+        u32 first = begin / factor;
+        u32 last = (end + factor - 1) / factor;
+        for(u32 k = 0; k < channels; ++k) {
+            for(u32 n = first; n < last; n += DecimateBlock) {
+                u32 count = minimum(DecimateBlock, last - n);
+                gather(frames, count + wing * 2, static_cast<s64>(n) + 1 - wing, 1, channels, srcFrames, src + k);
+                for(u32 p = 0; p < factor; ++p) {
+                    const f32* row = bank + static_cast<size_t>(p) * width;
+                    if(0 == p) {
+                        ::memcpy(values, frames + wing - 1, sizeof(f32) * count);
+                    } else if(p * 2 == factor) {
+                        ::memset(values, 0, sizeof(f32) * count);
+                        pairs(values, count, frames + wing - 1, frames + wing, wing, row + wing);
+                    } else {
+                        dense(values, count, frames, wing * 2, row);
+                    }
+                    for(u32 i = 0; i < count; ++i) {
+                        u64 frame = static_cast<u64>(n + i) * factor + p;
+                        if(begin <= frame && frame < end) {
+                            u64 index = frame * channels + k;
+                            store_sample(dst[index], values[i], gain, dither, index);
+                        }
+                    }
+                }
+            }
+        }
+    }
+} // namespace
+
+Resampler Resampler::initialize(u32 srcFrequency, u32 dstFrequency, Quality quality, Phase phase)
+{
+    return initialize(srcFrequency, dstFrequency, design(quality), phase);
+}
+
+Resampler Resampler::initialize(u32 srcFrequency, u32 dstFrequency, const FilterDesign& design, Phase phase)
+{
+    Resampler resampler;
+#ifdef RESAMCPP_STATS
+    resampler.counters_ = new Counters();
+#endif
+    resampler.srcFrequency_ = srcFrequency;
+    resampler.dstFrequency_ = dstFrequency;
+    resampler.kernel_ = Resampler::supported_kernel();
+    if(srcFrequency <= 0 || dstFrequency <= 0) {
+        return resampler;
+    }
+    resampler.sampleRatio_ = static_cast<f64>(dstFrequency) / srcFrequency;
+    u32 divisor = gcd(srcFrequency, dstFrequency);
+    resampler.phases_ = dstFrequency / divisor;
+    resampler.step_ = srcFrequency / divisor;
+    resampler.phase_ = phase;
+
+    // Small integer ratios have a Nyquist filter, whose zero taps are skipped, minimum phase has no zero taps
+    FilterDesign filterDesign = design;
+    u32 factor = (1 == resampler.step_) ? resampler.phases_ : ((1 == resampler.phases_) ? resampler.step_ : 0);
+    if(Phase::Linear == phase && 1 < factor && factor <= MaxFactor && valid_design(design)) {
+        filterDesign = get_nyquist_design(design, factor);
+        resampler.factor_ = factor;
+    }
+    resampler.quality_ = get_quality(filterDesign);
+    resampler.kernels_ = get_kernels(resampler.quality_, 1.0 <= resampler.sampleRatio_);
+    if(!acquire_filter(resampler.filter_, filterDesign)) {
+        return resampler;
+    }
+    // A variable ratio and quantized phases interpolate the table of the design, a Nyquist filter is too coarse for it
+    if(!acquire_filter(resampler.ratioFilter_, design)) {
+        return Resampler();
+    }
+    resampler.ratioKernels_ = get_kernels(get_quality(design), 1.0 <= resampler.sampleRatio_);
+    resampler.ratioIndexStep_ = get_index_step(resampler.ratioFilter_, resampler.sampleRatio_);
+    resampler.ratioScale_ = static_cast<f32>(resampler.ratioIndexStep_) / resampler.ratioFilter_.oversample_;
+
+    // Precompute every phase if the ratio reduces to small integers
+    const Filter& filter = resampler.filter_;
+    u32 indexStep = get_index_step(filter, resampler.sampleRatio_);
+    // The table is stepped by whole indices, so the filter time is scaled by indexStep/oversample rather than the ratio,
+    // which scales the output too
+    f32 scale = static_cast<f32>(indexStep) / filter.oversample_;
+    resampler.indexStep_ = indexStep;
+    resampler.scale_ = scale;
+    if(indexStep <= 0) {
+        return (Phase::Linear == phase) ? static_cast<Resampler&&>(resampler) : Resampler();
+    }
+    u32 phases = resampler.phases_;
+    u32 wing = filter.taps_ / indexStep;
+    u32 width = (wing * 2 + BankAlign - 1) & ~(BankAlign - 1);
+    size_t size = sizeof(f32) * phases * width;
+    if(MaxPhases < phases || MaxBankSize < size) {
+        return (Phase::Linear == phase) ? static_cast<Resampler&&>(resampler) : Resampler();
+    }
+    resampler.bank_ = reinterpret_cast<f32*>(aligned_malloc(size, sizeof(f32) * BankAlign));
+    if(RESAMCPP_NULL == resampler.bank_) {
+        return (Phase::Linear == phase) ? static_cast<Resampler&&>(resampler) : Resampler();
+    }
+    resampler.width_ = width;
+    if(Phase::Minimum == phase) {
+        // Both wings move before the output time, the prototype is evaluated from the design at the exact scale
+        f32 exact = minimum(1.0f, static_cast<f32>(resampler.sampleRatio_));
+        if(!build_minimum_phase(resampler.bank_, phases, width, wing * 2, design, exact, resampler.delay_)) {
+            return Resampler();
+        }
+        resampler.scale_ = exact;
+        resampler.wing_ = wing * 2;
+        resampler.ahead_ = 0;
+        return resampler;
+    }
+    resampler.wing_ = wing;
+    resampler.ahead_ = wing;
+    build_bank(resampler.bank_, phases, width, wing, filter, scale, indexStep);
+    return resampler;
+}
+
+Resampler::Resampler()
+    : srcFrequency_(0)
+    , dstFrequency_(0)
+    , sampleRatio_(0.0)
+    , quality_(0)
+    , kernel_(Kernel::Scalar)
+    , dither_(false)
+    , kernels_(RESAMCPP_NULL)
+    , filter_()
+    , factor_(0)
+    , phases_(0)
+    , step_(0)
+    , indexStep_(0)
+    , scale_(0.0f)
+    , ratioFilter_()
+    , ratioKernels_(RESAMCPP_NULL)
+    , ratioIndexStep_(0)
+    , ratioScale_(0.0f)
+    , wing_(0)
+    , ahead_(0)
+    , width_(0)
+    , phase_(Phase::Linear)
+    , delay_(0.0)
+    , bank_(RESAMCPP_NULL)
+    , fixedBank_(RESAMCPP_NULL)
+    , phaseBits_(0)
+    , phaseWidth_(0)
+    , phaseCache_(RESAMCPP_NULL)
+#ifdef RESAMCPP_STATS
+    , counters_(RESAMCPP_NULL)
+#endif
+{
+}
+
+Resampler::Resampler(Resampler&& other)
+    : srcFrequency_(other.srcFrequency_)
+    , dstFrequency_(other.dstFrequency_)
+    , sampleRatio_(other.sampleRatio_)
+    , quality_(other.quality_)
+    , kernel_(other.kernel_)
+    , dither_(other.dither_)
+    , kernels_(other.kernels_)
+    , filter_(other.filter_)
+    , factor_(other.factor_)
+    , phases_(other.phases_)
+    , step_(other.step_)
+    , indexStep_(other.indexStep_)
+    , scale_(other.scale_)
+    , ratioFilter_(other.ratioFilter_)
+    , ratioKernels_(other.ratioKernels_)
+    , ratioIndexStep_(other.ratioIndexStep_)
+    , ratioScale_(other.ratioScale_)
+    , wing_(other.wing_)
+    , ahead_(other.ahead_)
+    , width_(other.width_)
+    , phase_(other.phase_)
+    , delay_(other.delay_)
+    , bank_(other.bank_)
+    , fixedBank_(other.fixedBank_)
+    , phaseBits_(other.phaseBits_)
+    , phaseWidth_(other.phaseWidth_)
+    , phaseCache_(other.phaseCache_)
+#ifdef RESAMCPP_STATS
+    , counters_(other.counters_)
+#endif
+{
+    other.filter_ = {};
+    other.ratioFilter_ = {};
+    other.bank_ = RESAMCPP_NULL;
+    other.fixedBank_ = RESAMCPP_NULL;
+    other.phaseBits_ = 0;
+    other.phaseCache_ = RESAMCPP_NULL;
+#ifdef RESAMCPP_STATS
+    other.counters_ = RESAMCPP_NULL;
+#endif
+}
+
+Resampler::~Resampler()
+{
+#ifdef RESAMCPP_STATS
+    delete counters_;
+#endif
+    aligned_free(phaseCache_);
+    aligned_free(fixedBank_);
+    aligned_free(bank_);
+    release_filter(ratioFilter_);
+    release_filter(filter_);
+}
+
+Resampler& Resampler::operator=(Resampler&& other)
+{
+    if(this != &other) {
+#ifdef RESAMCPP_STATS
+        delete counters_;
+#endif
+        aligned_free(phaseCache_);
+        aligned_free(fixedBank_);
+        aligned_free(bank_);
+        release_filter(ratioFilter_);
+        release_filter(filter_);
+        srcFrequency_ = other.srcFrequency_;
+        dstFrequency_ = other.dstFrequency_;
+        sampleRatio_ = other.sampleRatio_;
+        quality_ = other.quality_;
+        kernel_ = other.kernel_;
+        dither_ = other.dither_;
+        kernels_ = other.kernels_;
+        filter_ = other.filter_;
+        factor_ = other.factor_;
+        phases_ = other.phases_;
+        step_ = other.step_;
+        indexStep_ = other.indexStep_;
+        scale_ = other.scale_;
+        ratioFilter_ = other.ratioFilter_;
+        ratioKernels_ = other.ratioKernels_;
+        ratioIndexStep_ = other.ratioIndexStep_;
+        ratioScale_ = other.ratioScale_;
+        wing_ = other.wing_;
+        ahead_ = other.ahead_;
+        width_ = other.width_;
+        phase_ = other.phase_;
+        delay_ = other.delay_;
+        bank_ = other.bank_;
+        fixedBank_ = other.fixedBank_;
+        phaseBits_ = other.phaseBits_;
+        phaseWidth_ = other.phaseWidth_;
+        phaseCache_ = other.phaseCache_;
+        other.filter_ = {};
+        other.ratioFilter_ = {};
+        other.bank_ = RESAMCPP_NULL;
+        other.fixedBank_ = RESAMCPP_NULL;
+        other.phaseBits_ = 0;
+        other.phaseCache_ = RESAMCPP_NULL;
+#ifdef RESAMCPP_STATS
+        counters_ = other.counters_;
+        other.counters_ = RESAMCPP_NULL;
+#endif
+    }
+    return *this;
+}
+
+Resampler::Kernel Resampler::supported_kernel()
+{
+    static const Kernel kernel = detect_kernel();
+    return kernel;
+}
+
+FilterDesign Resampler::design(Quality quality)
+{
+    u32 index = static_cast<u32>(quality);
+    RESAMCPP_ASSERT(index < sizeof(Presets) / sizeof(Presets[0]));
+    return Presets[index];
+}
+
+const Filter& Resampler::filter() const
+{
+    return filter_;
+}
+
+const Filter& Resampler::ratio_filter() const
+{
+    return ratioFilter_;
+}
+
+bool Resampler::valid() const
+{
+    // A ratio below 1/oversample would not step through the filter table
+    return RESAMCPP_NULL != filter_.filter_ && 0 < phases_ && 0 < step_ && 0 < indexStep_;
+}
+
+const char* Resampler::kernel_name(Kernel kernel)
+{
+    switch(kernel) {
+    case Kernel::Scalar:
+        return "scalar";
+    case Kernel::AVX2:
+        return "avx2";
+    case Kernel::AVX512:
+        return "avx512";
+    case Kernel::NEON:
+        return "neon";
+    default:
+        return "unknown";
+    }
+}
+
+Resampler::Kernel Resampler::kernel() const
+{
+    return kernel_;
+}
+
+bool Resampler::set_kernel(Kernel kernel)
+{
+    Kernel supported = supported_kernel();
+    bool available = (Kernel::Scalar == kernel)
+                     || (kernel == supported)
+                     || (Kernel::AVX2 == kernel && Kernel::AVX512 == supported);
+    if(available) {
+        kernel_ = kernel;
+    }
+    return available;
+}
+
+void Resampler::set_dither(bool dither)
+{
+    dither_ = dither;
+}
+
+bool Resampler::dither() const
+{
+    return dither_;
+}
+
+bool Resampler::set_fixed_point(bool fixedPoint)
+{
+    aligned_free(fixedBank_);
+    fixedBank_ = RESAMCPP_NULL;
+    if(!fixedPoint) {
+        return true;
+    }
+    if(RESAMCPP_NULL == bank_) {
+        return false;
+    }
+    size_t size = sizeof(s16) * phases_ * width_;
+    s16* fixedBank = reinterpret_cast<s16*>(aligned_malloc(size, sizeof(f32) * BankAlign));
+    if(RESAMCPP_NULL == fixedBank) {
+        return false;
+    }
+    if(!build_fixed_bank(fixedBank, bank_, phases_, width_, scale_, 0 < factor_ && 1 < phases_)) {
+        aligned_free(fixedBank);
+        return false;
+    }
+    fixedBank_ = fixedBank;
+    return true;
+}
+
+bool Resampler::fixed_point() const
+{
+    return RESAMCPP_NULL != fixedBank_;
+}
+
+bool Resampler::set_phase_bits(u32 bits)
+{
+    aligned_free(phaseCache_);
+    phaseBits_ = 0;
+    phaseWidth_ = 0;
+    phaseCache_ = RESAMCPP_NULL;
+    if(bits <= 0) {
+        return true;
+    }
+    const Filter& filter = ratioFilter_;
+    if(MaxPhaseBits < bits || Phase::Linear != phase_ || RESAMCPP_NULL == filter.filter_) {
+        return false;
+    }
+    if(ratioIndexStep_ <= 0) {
+        return false;
+    }
+    u32 wing = filter.taps_ / ratioIndexStep_;
+    u32 width = (wing * 2 + BankAlign - 1) & ~(BankAlign - 1);
+    size_t size = sizeof(f32) * (static_cast<size_t>(1) << bits) * width;
+    if(MaxPhaseCacheSize < size) {
+        return false;
+    }
+    phaseCache_ = reinterpret_cast<f32*>(aligned_malloc(size, sizeof(f32) * BankAlign));
+    if(RESAMCPP_NULL == phaseCache_) {
+        return false;
+    }
+    // All rows are built here, so that reading them never waits or designs, like a polyphase bank
+    u32 bins = 1U << bits;
+    for(u32 bin = 0; bin < bins; ++bin) {
+        f64 frac = (bin + 0.5) / static_cast<f64>(bins);
+        build_row(phaseCache_ + static_cast<size_t>(bin) * width, width, wing, filter, ratioScale_, ratioIndexStep_, ratioScale_ * frac);
+    }
+    phaseBits_ = bits;
+    phaseWidth_ = width;
+    return true;
+}
+
+u32 Resampler::phase_bits() const
+{
+    return phaseBits_;
+}
+
+u32 Resampler::required_phase_bits(f64 snr) const
+{
+    // A time error uniform in a bin of 2^-bits frames is the noise 2*pi*f*2^-bits/sqrt(12) of a unit sine at f cycles per frame
+    const f64 pi = 3.14159265358979323846;
+    f64 frequency = 0.5 * minimum(1.0, sampleRatio_);
+    f64 bits = ceil((snr + 20.0 * log10(2.0 * pi * frequency / sqrt(12.0))) / (20.0 * log10(2.0)));
+    return static_cast<u32>(clamp(bits, 1.0, static_cast<f64>(MaxPhaseBits)));
+}
+
+const f32* Resampler::phase_row(u32 bin) const
+{
+    RESAMCPP_ASSERT(bin < (1U << phaseBits_));
+    return phaseCache_ + static_cast<size_t>(bin) * phaseWidth_;
+}
+
+void Resampler::statistics(Statistics& statistics) const
+{
+    statistics = {};
+#ifdef RESAMCPP_STATS
+    if(RESAMCPP_NULL == counters_) {
+        return;
+    }
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    statistics.inputFrames_ = counters_->inputFrames_.load(relaxed);
+    statistics.outputFrames_ = counters_->outputFrames_.load(relaxed);
+    statistics.taps_ = counters_->taps_.load(relaxed);
+    statistics.clippedWindows_ = counters_->clippedWindows_.load(relaxed);
+    statistics.clippedSamples_ = counters_->clippedSamples_.load(relaxed);
+    for(u32 i = 0; i < Statistics::Paths; ++i) {
+        statistics.calls_[i] = counters_->calls_[i].load(relaxed);
+    }
+    for(u32 i = 0; i < Statistics::LatencyBuckets; ++i) {
+        statistics.latency_[i] = counters_->latency_[i].load(relaxed);
+    }
+#endif
+}
+
+void Resampler::reset_statistics()
+{
+#ifdef RESAMCPP_STATS
+    if(RESAMCPP_NULL == counters_) {
+        return;
+    }
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    counters_->inputFrames_.store(0, relaxed);
+    counters_->outputFrames_.store(0, relaxed);
+    counters_->taps_.store(0, relaxed);
+    counters_->clippedWindows_.store(0, relaxed);
+    counters_->clippedSamples_.store(0, relaxed);
+    for(u32 i = 0; i < Statistics::Paths; ++i) {
+        counters_->calls_[i].store(0, relaxed);
+    }
+    for(u32 i = 0; i < Statistics::LatencyBuckets; ++i) {
+        counters_->latency_[i].store(0, relaxed);
+    }
+#endif
+}
+
+void Resampler::time_at(u64 index, u64& frame, u32& phase) const
+{
+    RESAMCPP_ASSERT(0 < phases_);
+    // index * step / phases without overflow
+    u64 q = index / phases_;
+    u64 r = (index % phases_) * step_;
+    frame = q * step_ + r / phases_;
+    phase = static_cast<u32>(r % phases_);
+}
+
+u64 Resampler::output_frames(u64 srcFrames) const
+{
+    RESAMCPP_ASSERT(0 < step_);
+    // The number of indices i, which satisfy i * step < srcFrames * phases
+    u64 q = srcFrames / step_;
+    u64 r = (srcFrames % step_) * phases_;
+    return q * phases_ + (r + step_ - 1) / step_;
+}
+
+u32 Resampler::window() const
+{
+    if(RESAMCPP_NULL != bank_) {
+        return wing_ + ahead_;
+    }
+    const Filter& filter = filter_;
+    if(RESAMCPP_NULL == filter.filter_) {
+        return 0;
+    }
+    return (0 < indexStep_) ? filter.taps_ / indexStep_ * 2 : 0;
+}
+
+f32 Resampler::scale() const
+{
+    return scale_;
+}
+
+Resampler::Phase Resampler::phase() const
+{
+    return phase_;
+}
+
+const f32* Resampler::bank() const
+{
+    return bank_;
+}
+
+u32 Resampler::width() const
+{
+    return width_;
+}
+
+u32 Resampler::lookahead() const
+{
+    return (RESAMCPP_NULL != bank_) ? ahead_ : window() / 2;
+}
+
+f64 Resampler::input_latency() const
+{
+    return lookahead() + delay_;
+}
+
+f64 Resampler::output_latency() const
+{
+    return input_latency() * sampleRatio_;
+}
+
+template<class Dst, class Src>
+u32 Resampler::run(u32 channels, u32 dstSamples, Dst* dst, u32 srcSamples, const Src* src) const
+{
+    return run_range(channels, 0, dstSamples, dst, srcSamples, src);
+}
+
+template<class Dst, class Src>
+u32 Resampler::run_parallel(u32 channels, u32 dstSamples, Dst* dst, u32 srcSamples, const Src* src, u32 threads) const
+{
+    if(channels <= 0 || MaxChannels < channels) {
+        return 0;
+    }
+    if(threads <= 0) {
+        threads = maximum(1U, std::thread::hardware_concurrency());
+    }
+    // Every chunk starts from its exact phase, so that the output does not depend on the split
+    u32 chunks = minimum(threads, (dstSamples + MinParallelChunk - 1) / MinParallelChunk);
+    if(chunks <= 1) {
+        return run_range(channels, 0, dstSamples, dst, srcSamples, src);
+    }
+    u32 chunkSize = (dstSamples + chunks - 1) / chunks;
+    std::thread* workers = new std::thread[chunks - 1];
+    u32* results = new u32[chunks - 1];
+    for(u32 i = 0; i < (chunks - 1); ++i) {
+        u32 begin = chunkSize * i;
+        u32 end = begin + chunkSize;
+        u32* result = results + i;
+        workers[i] = std::thread([this, channels, begin, end, dst, srcSamples, src, result]() {
+            *result = run_range(channels, begin, end, dst, srcSamples, src);
+        });
+    }
+    // No chunk is empty, so a zero result is a failure, which fails the whole call like run
+    u32 result = run_range(channels, chunkSize * (chunks - 1), dstSamples, dst, srcSamples, src);
+    for(u32 i = 0; i < (chunks - 1); ++i) {
+        workers[i].join();
+        if(results[i] <= 0) {
+            result = 0;
+        }
+    }
+    delete[] results;
+    delete[] workers;
+    return (0 < result) ? dstSamples : 0;
+}
+
+template<class Dst, class Src>
+u32 Resampler::run_range(u32 channels, u32 begin, u32 end, Dst* dst, u32 srcSamples, const Src* src) const
+{
+    if(channels <= 0 || MaxChannels < channels) {
+        return 0;
+    }
+    if(FixedPipeline<Dst, Src>::value && RESAMCPP_NULL != fixedBank_) {
+        return run_fixed(channels, begin, end, reinterpret_cast<s16*>(dst), srcSamples, reinterpret_cast<const s16*>(src));
+    }
+    if(0 < factor_) {
+        return run_integer(channels, begin, end, dst, srcSamples, src);
+    }
+    if(RESAMCPP_NULL != bank_) {
+        return run_bank(channels, begin, end, dst, srcSamples, src);
+    }
+    if(0 < phaseBits_) {
+        return run_quantized(channels, begin, end, dst, srcSamples, src);
+    }
+    const Filter& filter = filter_;
+    if(RESAMCPP_NULL == filter.filter_) {
+        return 0;
+    }
+    f32 scale = scale_;
+    u32 indexStep = indexStep_;
+    if(indexStep <= 0) {
+        return 0;
+    }
+    RESAMCPP_STATS_CALL(counters_, Statistics::Path::Interpolate);
+    RESAMCPP_STATS_WINDOWS(begin, end, srcSamples);
+    InterpolateFunction<Src> interpolate = get_interpolate<Src>(kernels_, channels);
+    f32 gain = get_gain<Dst, Src>(scale);
+
+    // The time register is kept exact as n + p/phases
+    u32 phases = phases_;
+    u32 integerStep = step_ / phases;
+    u32 phaseStep = step_ % phases;
+    u64 frame;
+    u32 p;
+    time_at(begin, frame, p);
+    u32 n = static_cast<u32>(frame);
+    for(u32 i = begin; i < end; ++i) {
+        RESAMCPP_ASSERT(n < srcSamples);
+
+        // Grab the fractional component ot the time index
+        f32 frac = scale * (static_cast<f32>(p) / phases);
+
+        f32 values[MaxChannels];
+        clear_values(values, channels);
+        interpolate(values, channels, filter, scale, indexStep, frac, n + 1, srcSamples - n - 1, src + n * channels);
+        store_frame(dst + i * channels, channels, values, gain, dither_, static_cast<u64>(i) * channels);
+
+        // Increment the time register
+        advance(n, p, integerStep, phaseStep, phases);
+    }
+    return end - begin;
+}
+
+template<class Dst, class Src>
+u32 Resampler::run_bank(u32 channels, u32 begin, u32 end, Dst* dst, u32 srcSamples, const Src* src) const
+{
+    RESAMCPP_ASSERT(RESAMCPP_NULL != bank_);
+    RESAMCPP_STATS_CALL(counters_, Statistics::Path::Bank);
+    RESAMCPP_STATS_WINDOWS(begin, end, srcSamples);
+    f32 gain = get_gain<Dst, Src>(scale_);
+    u32 phases = phases_;
+    u32 wing = wing_;
+    u32 window = wing_ + ahead_;
+    DotFunction<Src> dot = get_dot<Src>(kernel_, channels);
+
+    // The time register is kept exact as n + p/phases
+    u32 integerStep = step_ / phases;
+    u32 phaseStep = step_ % phases;
+    u64 frame;
+    u32 p;
+    time_at(begin, frame, p);
+    u32 n = static_cast<u32>(frame);
+    for(u32 i = begin; i < end; ++i) {
+        RESAMCPP_ASSERT(n < srcSamples);
+        // Clip the window at both ends of the input
+        u32 first = (n + 1 < wing) ? wing - 1 - n : 0;
+        u32 last = minimum(window, srcSamples + wing - 1 - n);
+        const f32* row = bank_ + static_cast<size_t>(p) * width_;
+
+        f32 values[MaxChannels];
+        clear_values(values, channels);
+        dot(values, channels, last - first, row + first, src + (n + first + 1 - wing) * channels);
+        store_frame(dst + i * channels, channels, values, gain, dither_, static_cast<u64>(i) * channels);
+
+        advance(n, p, integerStep, phaseStep, phases);
+    }
+    return end - begin;
+}
+
+template<class Dst, class Src>
+u32 Resampler::run_quantized(u32 channels, u32 begin, u32 end, Dst* dst, u32 srcSamples, const Src* src) const
+{
+    RESAMCPP_ASSERT(RESAMCPP_NULL != phaseCache_);
+    RESAMCPP_STATS_CALL(counters_, Statistics::Path::Quantized);
+    RESAMCPP_STATS_WINDOWS(begin, end, srcSamples);
+    f32 gain = get_gain<Dst, Src>(scale_);
+    u32 phases = phases_;
+    u32 wing = window() / 2;
+    u32 window = wing * 2;
+    u32 bits = phaseBits_;
+    DotFunction<Src> dot = get_dot<Src>(kernel_, channels);
+
+    // The time register is kept exact as n + p/phases, only the weights are quantized
+    u32 integerStep = step_ / phases;
+    u32 phaseStep = step_ % phases;
+    u64 frame;
+    u32 p;
+    time_at(begin, frame, p);
+    u32 n = static_cast<u32>(frame);
+    for(u32 i = begin; i < end; ++i) {
+        RESAMCPP_ASSERT(n < srcSamples);
+        // Clip the window at both ends of the input
+        u32 first = (n + 1 < wing) ? wing - 1 - n : 0;
+        u32 last = minimum(window, srcSamples + wing - 1 - n);
+        const f32* row = phase_row(static_cast<u32>((static_cast<u64>(p) << bits) / phases));
+
+        f32 values[MaxChannels];
+        clear_values(values, channels);
+        dot(values, channels, last - first, row + first, src + (n + first + 1 - wing) * channels);
+        store_frame(dst + i * channels, channels, values, gain, dither_, static_cast<u64>(i) * channels);
+
+        advance(n, p, integerStep, phaseStep, phases);
+    }
+    return end - begin;
+}
+
+u32 Resampler::run_fixed(u32 channels, u32 begin, u32 end, s16* dst, u32 srcSamples, const s16* src) const
+{
+    RESAMCPP_ASSERT(RESAMCPP_NULL != fixedBank_);
+    RESAMCPP_STATS_CALL(counters_, Statistics::Path::Fixed);
+    RESAMCPP_STATS_WINDOWS(begin, end, srcSamples);
+    u32 phases = phases_;
+    u32 wing = wing_;
+    u32 window = wing_ + ahead_;
+    bool copy = 0 < factor_ && 1 < phases;
+    FixedDotFunction dot = get_fixed_dot(kernel_, channels);
+
+    // The time register is kept exact as n + p/phases
+    u32 integerStep = step_ / phases;
+    u32 phaseStep = step_ % phases;
+    u64 frame;
+    u32 p;
+    time_at(begin, frame, p);
+    u32 n = static_cast<u32>(frame);
+    for(u32 i = begin; i < end; ++i) {
+        RESAMCPP_ASSERT(n < srcSamples);
+        s16* output = dst + static_cast<size_t>(i) * channels;
+        if(copy && 0 == p) {
+            ::memcpy(output, src + static_cast<size_t>(n) * channels, sizeof(s16) * channels);
+        } else {
+            // Clip the window at both ends of the input
+            u32 first = (n + 1 < wing) ? wing - 1 - n : 0;
+            u32 last = minimum(window, srcSamples + wing - 1 - n);
+            const s16* row = fixedBank_ + static_cast<size_t>(p) * width_;
+
+            s64 values[MaxChannels];
+            clear_values(values, channels);
+            dot(values, channels, last - first, row + first, src + (n + first + 1 - wing) * channels);
+            for(u32 k = 0; k < channels; ++k) {
+                output[k] = round_fixed(values[k], dither_, static_cast<u64>(i) * channels + k);
+            }
+        }
+        advance(n, p, integerStep, phaseStep, phases);
+    }
+    return end - begin;
+}
+
+template<class Dst, class Src>
+u32 Resampler::run_integer(u32 channels, u32 begin, u32 end, Dst* dst, u32 srcSamples, const Src* src) const
+{
+    const Filter& filter = filter_;
+    if(RESAMCPP_NULL == filter.filter_) {
+        return 0;
+    }
+    RESAMCPP_STATS_CALL(counters_, Statistics::Path::Integer);
+    RESAMCPP_STATS_WINDOWS(begin, end, srcSamples);
+    u32 factor = factor_;
+    if(1 < phases_) {
+        RESAMCPP_ASSERT(RESAMCPP_NULL != bank_);
+        f32* scratch = reinterpret_cast<f32*>(::malloc(sizeof(f32) * get_expand_scratch(wing_)));
+        if(RESAMCPP_NULL == scratch) {
+            return 0;
+        }
+        expand(get_pairs(kernel_), get_dense(kernel_), channels, begin, end, dst, srcSamples, src, factor, bank_, width_, wing_, get_gain<Dst, Src>(1.0f), dither_, scratch);
+        ::free(scratch);
+        return end - begin;
+    }
+
+    // The table is sampled factor times per zero crossing, so that the weight at the distance d is filter[d]
+    u32 length = (filter.taps_ - 1) / factor;
+    size_t size = get_decimate_scratch(factor, length) + static_cast<size_t>(factor - 1) * length;
+    f32* scratch = reinterpret_cast<f32*>(::malloc(sizeof(f32) * size));
+    if(RESAMCPP_NULL == scratch) {
+        return 0;
+    }
+    f32* taps = scratch + get_decimate_scratch(factor, length);
+    u32 lengths[MaxFactor];
+    for(u32 r = 1; r < factor; ++r) {
+        lengths[r - 1] = length;
+        for(u32 j = 0; j < length; ++j) {
+            taps[(r - 1) * length + j] = filter.filter_[r + j * factor];
+        }
+    }
+    f32 scale = 1.0f / factor;
+    decimate(get_pairs(kernel_), channels, begin, end, dst, srcSamples, src, factor, filter.filter_[0], lengths, taps, get_gain<Dst, Src>(scale), dither_, scratch);
+    ::free(scratch);
+    return end - begin;
+}
+
+#define RESAMCPP_INSTANTIATE(Dst, Src) \
+    template u32 Resampler::run<Dst, Src>(u32, u32, Dst*, u32, const Src*) const; \
+    template u32 Resampler::run_parallel<Dst, Src>(u32, u32, Dst*, u32, const Src*, u32) const;
+
+#define RESAMCPP_INSTANTIATE_SRC(Dst) \
+    RESAMCPP_INSTANTIATE(Dst, u8) \
+    RESAMCPP_INSTANTIATE(Dst, s16) \
+    RESAMCPP_INSTANTIATE(Dst, s24) \
+    RESAMCPP_INSTANTIATE(Dst, s32) \
+    RESAMCPP_INSTANTIATE(Dst, f32)
+
+RESAMCPP_INSTANTIATE_SRC(u8)
+RESAMCPP_INSTANTIATE_SRC(s16)
+RESAMCPP_INSTANTIATE_SRC(s24)
+RESAMCPP_INSTANTIATE_SRC(s32)
+RESAMCPP_INSTANTIATE_SRC(f32)
+#undef RESAMCPP_INSTANTIATE_SRC
+#undef RESAMCPP_INSTANTIATE
+
+#ifdef RESAMCPP_STATS
+void Resampler::count_windows(u32 begin, u32 end, u32 srcSamples) const
+{
+    // Walk the time register apart from the loops of the kernels, which stay as they are
+    u32 ahead = lookahead();
+    u32 wing = window() - ahead;
+    u32 phases = phases_;
+    u32 integerStep = step_ / phases;
+    u32 phaseStep = step_ % phases;
+    u64 frame;
+    u32 p;
+    time_at(begin, frame, p);
+    u64 n = frame;
+    for(u32 i = begin; i < end; ++i) {
+        u64 left = minimum<u64>(n + 1, wing);
+        u64 right = (n < srcSamples) ? minimum<u64>(srcSamples - n - 1, ahead) : 0;
+        RESAMCPP_STATS_WINDOW(left + right, wing + ahead);
+        advance(n, p, integerStep, phaseStep, phases);
+    }
+    RESAMCPP_STATS_FRAMES(n - frame, end - begin);
+}
+#endif
+
+u32 Resampler::run_planar(u32 channels, u32 dstSamples, f32* const* dst, u32 srcSamples, const f32* const* src) const
+{
+    if(channels <= 0 || MaxChannels < channels) {
+        return 0;
+    }
+    const Filter& filter = filter_;
+    if(RESAMCPP_NULL == filter.filter_) {
+        return 0;
+    }
+    f32 scale = scale_;
+    u32 indexStep = indexStep_;
+    if(indexStep <= 0) {
+        return 0;
+    }
+    RESAMCPP_STATS_CALL(counters_, Statistics::Path::Planar);
+    RESAMCPP_STATS_WINDOWS(0, dstSamples, srcSamples);
+    DotPlanarFunction dot = get_dot_planar(kernel_);
+    u32 wing = (RESAMCPP_NULL != bank_) ? wing_ : filter.taps_ / indexStep;
+    u32 window = (RESAMCPP_NULL != bank_) ? wing_ + ahead_ : wing * 2;
+    // Weights for one output frame when they are neither in a bank nor cached, a Nyquist filter is exact at its phases
+    bool quantized = 0 < phaseBits_ && factor_ <= 0;
+    f32* weights = RESAMCPP_NULL;
+    if(RESAMCPP_NULL == bank_ && !quantized) {
+        weights = reinterpret_cast<f32*>(::malloc(sizeof(f32) * window));
+        if(RESAMCPP_NULL == weights) {
+            return 0;
+        }
+    }
+
+    u32 phases = phases_;
+    u32 integerStep = step_ / phases;
+    u32 phaseStep = step_ % phases;
+    u32 n = 0;
+    u32 p = 0;
+    for(u32 i = 0; i < dstSamples; ++i) {
+        RESAMCPP_ASSERT(n < srcSamples);
+        // The weights are shared with all channels
+        const f32* row;
+        if(RESAMCPP_NULL != bank_) {
+            row = bank_ + static_cast<size_t>(p) * width_;
+        } else if(quantized) {
+            row = phase_row(static_cast<u32>((static_cast<u64>(p) << phaseBits_) / phases));
+        } else {
+            build_row(weights, window, wing, filter, scale, indexStep, scale * (static_cast<f64>(p) / phases));
+            row = weights;
+        }
+        // Clip the window at both ends of the input
+        u32 first = (n + 1 < wing) ? wing - 1 - n : 0;
+        u32 last = minimum(window, srcSamples + wing - 1 - n);
+        u32 offset = n + first + 1 - wing;
+        for(u32 k = 0; k < channels; ++k) {
+            dst[k][i] = scale * dot(last - first, row + first, src[k] + offset);
+        }
+        advance(n, p, integerStep, phaseStep, phases);
+    }
+    ::free(weights);
+    return dstSamples;
+}
+
+u32 Resampler::run_ispc(u32 channels, u32 dstSamples, s16* dst, u32 srcSamples, const s16* src) const
+{
+#ifdef RESAMCPP_ISPC
+    if(channels <= 0 || MaxChannels < channels) {
+        return 0;
+    }
+    // The Nyquist filters and Q15 weights have their own kernels
+    if(0 < factor_ || RESAMCPP_NULL != fixedBank_) {
+        return run(channels, dstSamples, dst, srcSamples, src);
+    }
+    const Filter& filter = filter_;
+    if(RESAMCPP_NULL == filter.filter_) {
+        return 0;
+    }
+    f32 scale = scale_;
+    u32 indexStep = indexStep_;
+    if(indexStep <= 0) {
+        return 0;
+    }
+    RESAMCPP_STATS_CALL(counters_, Statistics::Path::ISPC);
+    RESAMCPP_STATS_WINDOWS(0, dstSamples, srcSamples);
+    f32 gain = get_gain<s16, s16>(scale);
+    u32 wing = (RESAMCPP_NULL != bank_) ? wing_ : filter.taps_ / indexStep;
+    u32 window = (RESAMCPP_NULL != bank_) ? wing_ + ahead_ : wing * 2;
+    // Weights for one output frame when they are neither in a bank nor cached, the kernel only sees contiguous windows
+    f32* weights = RESAMCPP_NULL;
+    if(RESAMCPP_NULL == bank_ && phaseBits_ <= 0) {
+        weights = reinterpret_cast<f32*>(::malloc(sizeof(f32) * window));
+        if(RESAMCPP_NULL == weights) {
+            return 0;
+        }
+    }
+
+    u32 phases = phases_;
+    u32 integerStep = step_ / phases;
+    u32 phaseStep = step_ % phases;
+    u32 n = 0;
+    u32 p = 0;
+    for(u32 i = 0; i < dstSamples; ++i) {
+        RESAMCPP_ASSERT(n < srcSamples);
+        const f32* row;
+        if(RESAMCPP_NULL != bank_) {
+            row = bank_ + static_cast<size_t>(p) * width_;
+        } else if(0 < phaseBits_) {
+            row = phase_row(static_cast<u32>((static_cast<u64>(p) << phaseBits_) / phases));
+        } else {
+            build_row(weights, window, wing, filter, scale, indexStep, scale * (static_cast<f64>(p) / phases));
+            row = weights;
+        }
+        // Clip the window at both ends of the input
+        u32 first = (n + 1 < wing) ? wing - 1 - n : 0;
+        u32 last = minimum(window, srcSamples + wing - 1 - n);
+
+        f32 values[MaxChannels];
+        clear_values(values, channels);
+        ispc::dot(values, channels, last - first, row + first, src + static_cast<size_t>(n + first + 1 - wing) * channels);
+        store_frame(dst + static_cast<size_t>(i) * channels, channels, values, gain, dither_, static_cast<u64>(i) * channels);
+
+        advance(n, p, integerStep, phaseStep, phases);
+    }
+    ::free(weights);
+    return dstSamples;
+#else
+    return run(channels, dstSamples, dst, srcSamples, src);
+#endif
+}
+
+//--- Stream
+//-----------------------------------------------------------
+Stream Stream::initialize(const Resampler& resampler, u32 channels)
+{
+    Stream stream;
+    const Filter& filter = resampler.filter_;
+    if(channels <= 0 || Resampler::MaxChannels < channels || RESAMCPP_NULL == filter.filter_) {
+        return stream;
+    }
+    f32 scale = resampler.scale_;
+    u32 indexStep = resampler.indexStep_;
+    f32 ratioScale = resampler.ratioScale_;
+    u32 ratioIndexStep = resampler.ratioIndexStep_;
+    if(indexStep <= 0 || ratioIndexStep <= 0) {
+        return stream;
+    }
+    // Each wing touches at most taps/indexStep frames, the ring holds both wings
+    u32 wing = filter.taps_ / indexStep;
+    u32 ahead = wing;
+    if(RESAMCPP_NULL != resampler.bank_) {
+        wing = resampler.wing_;
+        ahead = resampler.ahead_;
+    }
+    // A variable ratio interpolates the table of the design, whose wings are longer than the ones of a Nyquist filter
+    u32 ratioWing = resampler.ratioFilter_.taps_ / ratioIndexStep;
+    u32 history = maximum(wing, ratioWing);
+    // Besides the wings of either, the ring holds a block of input frames to emit at once
+    u32 capacity = history + maximum(ahead, ratioWing) + BlockFrames;
+    stream.ring_ = reinterpret_cast<s16*>(::malloc(sizeof(s16) * capacity * 2 * channels));
+    if(RESAMCPP_NULL == stream.ring_) {
+        return stream;
+    }
+    stream.resampler_ = &resampler;
+    stream.channels_ = channels;
+    stream.wing_ = wing;
+    stream.ahead_ = ahead;
+    stream.ratioWing_ = ratioWing;
+    stream.history_ = history;
+    stream.capacity_ = capacity;
+    stream.scale_ = scale;
+    stream.indexStep_ = indexStep;
+    stream.gain_ = get_gain<s16, s16>(scale);
+    stream.ratioScale_ = ratioScale;
+    stream.ratioIndexStep_ = ratioIndexStep;
+    stream.ratioGain_ = get_gain<s16, s16>(ratioScale);
+    stream.dot_ = get_dot<s16>(resampler.kernel_, channels);
+    stream.interpolate_ = get_interpolate<s16>(resampler.kernels_, channels);
+    stream.ratioInterpolate_ = get_interpolate<s16>(resampler.ratioKernels_, channels);
+    stream.fixedDot_ = get_fixed_dot(resampler.kernel_, channels);
+    stream.reset();
+    return stream;
+}
+
+Stream::Stream()
+    : resampler_(RESAMCPP_NULL)
+    , channels_(0)
+    , wing_(0)
+    , ahead_(0)
+    , ratioWing_(0)
+    , history_(0)
+    , capacity_(0)
+    , scale_(0.0f)
+    , indexStep_(0)
+    , gain_(0.0f)
+    , ratioScale_(0.0f)
+    , ratioIndexStep_(0)
+    , ratioGain_(0.0f)
+    , dot_(RESAMCPP_NULL)
+    , interpolate_(RESAMCPP_NULL)
+    , ratioInterpolate_(RESAMCPP_NULL)
+    , fixedDot_(RESAMCPP_NULL)
+    , position_(0)
+    , phase_(0)
+    , fraction_(0)
+    , step_(0)
+    , startStep_(0)
+    , targetStep_(0)
+    , rampFrames_(0)
+    , rampPosition_(0)
+    , written_(0)
+    , outputs_(0)
+    , ring_(RESAMCPP_NULL)
+{
+}
+
+Stream::Stream(Stream&& other)
+    : resampler_(other.resampler_)
+    , channels_(other.channels_)
+    , wing_(other.wing_)
+    , ahead_(other.ahead_)
+    , ratioWing_(other.ratioWing_)
+    , history_(other.history_)
+    , capacity_(other.capacity_)
+    , scale_(other.scale_)
+    , indexStep_(other.indexStep_)
+    , gain_(other.gain_)
+    , ratioScale_(other.ratioScale_)
+    , ratioIndexStep_(other.ratioIndexStep_)
+    , ratioGain_(other.ratioGain_)
+    , dot_(other.dot_)
+    , interpolate_(other.interpolate_)
+    , ratioInterpolate_(other.ratioInterpolate_)
+    , fixedDot_(other.fixedDot_)
+    , position_(other.position_)
+    , phase_(other.phase_)
+    , fraction_(other.fraction_)
+    , step_(other.step_)
+    , startStep_(other.startStep_)
+    , targetStep_(other.targetStep_)
+    , rampFrames_(other.rampFrames_)
+    , rampPosition_(other.rampPosition_)
+    , written_(other.written_)
+    , outputs_(other.outputs_)
+    , ring_(other.ring_)
+{
+    other.resampler_ = RESAMCPP_NULL;
+    other.ring_ = RESAMCPP_NULL;
+}
+
+Stream::~Stream()
+{
+    ::free(ring_);
+}
+
+Stream& Stream::operator=(Stream&& other)
+{
+    if(this != &other) {
+        ::free(ring_);
+        resampler_ = other.resampler_;
+        channels_ = other.channels_;
+        wing_ = other.wing_;
+        ahead_ = other.ahead_;
+        ratioWing_ = other.ratioWing_;
+        history_ = other.history_;
+        capacity_ = other.capacity_;
+        scale_ = other.scale_;
+        indexStep_ = other.indexStep_;
+        gain_ = other.gain_;
+        ratioScale_ = other.ratioScale_;
+        ratioIndexStep_ = other.ratioIndexStep_;
+        ratioGain_ = other.ratioGain_;
+        dot_ = other.dot_;
+        interpolate_ = other.interpolate_;
+        ratioInterpolate_ = other.ratioInterpolate_;
+        fixedDot_ = other.fixedDot_;
+        position_ = other.position_;
+        phase_ = other.phase_;
+        fraction_ = other.fraction_;
+        step_ = other.step_;
+        startStep_ = other.startStep_;
+        targetStep_ = other.targetStep_;
+        rampFrames_ = other.rampFrames_;
+        rampPosition_ = other.rampPosition_;
+        written_ = other.written_;
+        outputs_ = other.outputs_;
+        ring_ = other.ring_;
+        other.resampler_ = RESAMCPP_NULL;
+        other.ring_ = RESAMCPP_NULL;
+    }
+    return *this;
+}
+
+bool Stream::valid() const
+{
+    return RESAMCPP_NULL != ring_;
+}
+
+void Stream::reset()
+{
+    position_ = 0;
+    phase_ = 0;
+    fraction_ = 0;
+    step_ = 0;
+    startStep_ = 0;
+    targetStep_ = 0;
+    rampFrames_ = 0;
+    rampPosition_ = 0;
+    written_ = 0;
+    outputs_ = 0;
+    if(RESAMCPP_NULL != ring_) {
+        ::memset(ring_, 0, sizeof(s16) * capacity_ * 2 * channels_);
+    }
+}
+
+bool Stream::set_ratio(f64 ratio, u32 rampFrames)
+{
+    RESAMCPP_ASSERT(valid());
+    const f64 one = 4294967296.0;
+    if(!(1.0 / 65536.0 <= ratio && ratio <= 65536.0)) {
+        return false;
+    }
+    // The interpolated filter is linear phase
+    if(Resampler::Phase::Linear != resampler_->phase_) {
+        return false;
+    }
+    // Steps are rounded up, so that the times on input frames do not fall just before them,
+    // where the filter would be evaluated at the clipped end of the table
+    const Resampler& resampler = *resampler_;
+    if(step_ <= 0) {
+        // Continue from the exact time register
+        fraction_ = static_cast<u32>(((static_cast<u64>(phase_) << 32) + resampler.phases_ - 1) / resampler.phases_);
+        step_ = static_cast<u64>(ceil(one * resampler.step_ / resampler.phases_));
+    }
+    startStep_ = step_;
+    targetStep_ = static_cast<u64>(ceil(one / ratio));
+    rampFrames_ = rampFrames;
+    rampPosition_ = 0;
+    if(rampFrames <= 0) {
+        step_ = targetStep_;
+    }
+    return true;
+}
+
+f64 Stream::ratio() const
+{
+    RESAMCPP_ASSERT(valid());
+    if(step_ <= 0) {
+        return resampler_->sampleRatio_;
+    }
+    return 4294967296.0 / static_cast<f64>(step_);
+}
+
+u32 Stream::process(const s16* src, u32 srcFrames, s16* dst, u32 dstCapacity, u32* consumed)
+{
+    RESAMCPP_ASSERT(valid());
+    RESAMCPP_STATS_CALL(resampler_->counters_, Resampler::Statistics::Path::Stream);
+    u32 count = 0;
+    u32 produced = 0;
+    u32 ahead = lookahead();
+    for(;;) {
+        // Emit every output whose right wing is complete
+        if(ahead < written_) {
+            produced += emit(dst + produced * channels_, dstCapacity - produced, written_ - ahead);
+        }
+        if(position_ + ahead < written_ || srcFrames <= count) {
+            break;
+        }
+        // Push into the slots before the left wing of the next output, at least a block
+        u64 oldest = (history_ <= position_ + 1) ? position_ + 1 - history_ : 0;
+        u32 frames = static_cast<u32>(minimum<u64>(srcFrames - count, capacity_ - (written_ - oldest)));
+        push(src + count * channels_, frames);
+        count += frames;
+    }
+    RESAMCPP_ASSERT(RESAMCPP_NULL != consumed || count == srcFrames);
+    if(RESAMCPP_NULL != consumed) {
+        *consumed = count;
+    }
+    return produced;
+}
+
+u64 Stream::input_frames(u32 dstFrames) const
+{
+    RESAMCPP_ASSERT(valid());
+    if(dstFrames <= 0) {
+        return 0;
+    }
+    // The frame of the last output time
+    const Resampler& resampler = *resampler_;
+    u64 last;
+    if(step_ <= 0) {
+        last = position_ + (phase_ + static_cast<u64>(dstFrames - 1) * resampler.step_) / resampler.phases_;
+    } else {
+        last = position_;
+        u64 fraction = fraction_;
+        u64 step = step_;
+        u32 rampPosition = rampPosition_;
+        for(u32 i = 1; i < dstFrames; ++i) {
+            fraction += step;
+            last += fraction >> 32;
+            fraction &= 0xFFFFFFFFULL;
+            if(rampPosition < rampFrames_) {
+                ++rampPosition;
+                f64 delta = static_cast<f64>(targetStep_) - static_cast<f64>(startStep_);
+                step = static_cast<u64>(static_cast<f64>(startStep_) + floor(delta * rampPosition / rampFrames_ + 0.5));
+            }
+        }
+    }
+    // Its right wing needs the lookahead after it
+    u64 end = last + lookahead() + 1;
+    return (written_ < end) ? end - written_ : 0;
+}
+
+u32 Stream::flush(s16* dst, u32 dstCapacity)
+{
+    RESAMCPP_ASSERT(valid());
+    RESAMCPP_STATS_CALL(resampler_->counters_, Resampler::Statistics::Path::Stream);
+    return emit(dst, dstCapacity, written_);
+}
+
+u32 Stream::lookahead() const
+{
+    return (0 < step_) ? ratioWing_ : ahead_;
+}
+
+void Stream::advance_ratio()
+{
+    u64 time = fraction_ + step_;
+    position_ += time >> 32;
+    fraction_ = static_cast<u32>(time);
+    if(rampPosition_ < rampFrames_) {
+        ++rampPosition_;
+        f64 delta = static_cast<f64>(targetStep_) - static_cast<f64>(startStep_);
+        step_ = static_cast<u64>(static_cast<f64>(startStep_) + floor(delta * rampPosition_ / rampFrames_ + 0.5));
+    }
+}
+
+void Stream::push(const s16* src, u32 frames)
+{
+    // Mirror every frame, so that any window of capacity frames is contiguous
+    for(u32 i = 0; i < frames; ++i) {
+        u32 slot = static_cast<u32>(written_ % capacity_);
+        s16* s0 = ring_ + slot * channels_;
+        s16* s1 = ring_ + (slot + capacity_) * channels_;
+        for(u32 k = 0; k < channels_; ++k) {
+            s0[k] = s1[k] = src[k];
+        }
+        src += channels_;
+        ++written_;
+    }
+}
+
+u32 Stream::emit(s16* dst, u32 dstCapacity, u64 end)
+{
+    const Resampler& resampler = *resampler_;
+    const Filter& filter = resampler.filter_;
+    if(RESAMCPP_NULL == filter.filter_) {
+        return 0;
+    }
+    bool dither = resampler.dither_;
+    bool copy = 0 < resampler.factor_ && 1 < resampler.phases_;
+    // The rows of quantized phases have the wings of the table of a variable ratio, which a linear phase bank shares,
+    // the exact ratio takes them without a bank unless a Nyquist filter is exact at its phases
+    u32 quantized = resampler.phaseBits_;
+    RESAMCPP_ASSERT(quantized <= 0 || ratioWing_ * 2 <= resampler.phaseWidth_);
+    bool rows = 0 < quantized && RESAMCPP_NULL == resampler.bank_ && resampler.factor_ <= 0;
+    u32 wing = (0 < step_) ? ratioWing_ : wing_;
+    u32 ahead = lookahead();
+
+    // Follow the same exact time register as Resampler::run
+    u32 phases = resampler.phases_;
+    u32 integerStep = resampler.step_ / phases;
+    u32 phaseStep = resampler.step_ % phases;
+    u32 produced = 0;
+#ifdef RESAMCPP_STATS
+    u64 position = position_;
+#endif
+    for(; position_ < end && produced < dstCapacity; ++produced) {
+        u32 start = static_cast<u32>((position_ + capacity_ + 1 - wing) % capacity_);
+        const s16* window = ring_ + start * channels_;
+        u32 left = static_cast<u32>(minimum<u64>(position_ + 1, wing));
+        u32 right = static_cast<u32>(minimum<u64>(written_ - position_ - 1, ahead));
+        RESAMCPP_STATS_WINDOW(left + right, wing + ahead);
+
+        s16* output = dst + produced * channels_;
+        if(0 < step_ || rows) {
+            // A variable ratio interpolates the table of the design at the fixed point time, or takes the row of its bin
+            f32 values[Resampler::MaxChannels];
+            clear_values(values, channels_);
+            if(0 < quantized) {
+                u32 bin = (0 < step_) ? fraction_ >> (32 - quantized) : static_cast<u32>((static_cast<u64>(phase_) << quantized) / phases);
+                u32 first = wing - left;
+                dot_(values, channels_, left + right, resampler.phase_row(bin) + first, window + first * channels_);
+            } else {
+                f32 frac = ratioScale_ * static_cast<f32>(fraction_ * (1.0 / 4294967296.0));
+                ratioInterpolate_(values, channels_, resampler.ratioFilter_, ratioScale_, ratioIndexStep_, frac, left, right, window + (wing - 1) * channels_);
+            }
+            store_frame(output, channels_, values, ratioGain_, dither, outputs_ * channels_);
+        } else if(RESAMCPP_NULL != resampler.fixedBank_) {
+            if(copy && 0 == phase_) {
+                ::memcpy(output, window + (wing - 1) * channels_, sizeof(s16) * channels_);
+            } else {
+                const s16* row = resampler.fixedBank_ + static_cast<size_t>(phase_) * resampler.width_;
+                u32 first = wing - left;
+                s64 values[Resampler::MaxChannels];
+                clear_values(values, channels_);
+                fixedDot_(values, channels_, left + right, row + first, window + first * channels_);
+                for(u32 k = 0; k < channels_; ++k) {
+                    output[k] = round_fixed(values[k], dither, outputs_ * channels_ + k);
+                }
+            }
+        } else {
+            f32 values[Resampler::MaxChannels];
+            clear_values(values, channels_);
+            if(RESAMCPP_NULL != resampler.bank_) {
+                const f32* row = resampler.bank_ + static_cast<size_t>(phase_) * resampler.width_;
+                u32 first = wing - left;
+                dot_(values, channels_, left + right, row + first, window + first * channels_);
+            } else {
+                f32 frac = scale_ * (static_cast<f32>(phase_) / phases);
+                interpolate_(values, channels_, filter, scale_, indexStep_, frac, left, right, window + (wing - 1) * channels_);
+            }
+            store_frame(output, channels_, values, gain_, dither, outputs_ * channels_);
+        }
+
+        if(0 < step_) {
+            advance_ratio();
+        } else {
+            advance(position_, phase_, integerStep, phaseStep, phases);
+        }
+        ++outputs_;
+    }
+    RESAMCPP_STATS_FRAMES(position_ - position, produced);
+    return produced;
+}
+
+//--- RealtimeStream
+//-----------------------------------------------------------
+RealtimeStream RealtimeStream::initialize(const Resampler& resampler, u32 channels, u32 capacity)
+{
+    RealtimeStream stream;
+    if(capacity <= 0 || 0x80000000U < capacity) {
+        return stream;
+    }
+    stream.stream_ = Stream::initialize(resampler, channels);
+    if(!stream.stream_.valid()) {
+        return stream;
+    }
+    // A power of two wraps the counters with a mask
+    u32 size = 1;
+    while(size < capacity) {
+        size <<= 1;
+    }
+    stream.ring_ = reinterpret_cast<s16*>(::malloc(sizeof(s16) * size * channels));
+    if(RESAMCPP_NULL == stream.ring_) {
+        return stream;
+    }
+    stream.channels_ = channels;
+    stream.capacity_ = size;
+    return stream;
+}
+
+RealtimeStream::RealtimeStream()
+    : channels_(0)
+    , capacity_(0)
+    , ring_(RESAMCPP_NULL)
+    , head_(0)
+    , tail_(0)
+    , underruns_(0)
+    , overruns_(0)
+{
+}
+
+RealtimeStream::RealtimeStream(RealtimeStream&& other)
+    : stream_(static_cast<Stream&&>(other.stream_))
+    , channels_(other.channels_)
+    , capacity_(other.capacity_)
+    , ring_(other.ring_)
+    , head_(other.head_.load())
+    , tail_(other.tail_.load())
+    , underruns_(other.underruns_.load())
+    , overruns_(other.overruns_.load())
+{
+    other.ring_ = RESAMCPP_NULL;
+}
+
+RealtimeStream::~RealtimeStream()
+{
+    ::free(ring_);
+}
+
+RealtimeStream& RealtimeStream::operator=(RealtimeStream&& other)
+{
+    if(this != &other) {
+        ::free(ring_);
+        stream_ = static_cast<Stream&&>(other.stream_);
+        channels_ = other.channels_;
+        capacity_ = other.capacity_;
+        ring_ = other.ring_;
+        head_.store(other.head_.load());
+        tail_.store(other.tail_.load());
+        underruns_.store(other.underruns_.load());
+        overruns_.store(other.overruns_.load());
+        other.ring_ = RESAMCPP_NULL;
+    }
+    return *this;
+}
+
+bool RealtimeStream::valid() const
+{
+    return RESAMCPP_NULL != ring_;
+}
+
+u32 RealtimeStream::channels() const
+{
+    return channels_;
+}
+
+u32 RealtimeStream::capacity() const
+{
+    return capacity_;
+}
+
+u32 RealtimeStream::push(const s16* src, u32 frames)
+{
+    RESAMCPP_ASSERT(valid());
+    // The consumer releases the frames it has read
+    u64 head = head_.load(std::memory_order_relaxed);
+    u64 tail = tail_.load(std::memory_order_acquire);
+    u32 count = static_cast<u32>(minimum<u64>(frames, capacity_ - (head - tail)));
+    for(u32 written = 0; written < count;) {
+        u32 index = static_cast<u32>(head & (capacity_ - 1));
+        u32 chunk = minimum(count - written, capacity_ - index);
+        ::memcpy(ring_ + static_cast<size_t>(index) * channels_, src + static_cast<size_t>(written) * channels_, sizeof(s16) * chunk * channels_);
+        written += chunk;
+        head += chunk;
+    }
+    head_.store(head, std::memory_order_release);
+    if(count < frames) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+u32 RealtimeStream::pull(s16* dst, u32 frames)
+{
+    RESAMCPP_ASSERT(valid());
+    // The producer releases the frames it has written
+    u64 tail = tail_.load(std::memory_order_relaxed);
+    u64 head = head_.load(std::memory_order_acquire);
+    u64 count = minimum(stream_.input_frames(frames), head - tail);
+    u32 produced = 0;
+    for(;;) {
+        // The stream consumes only the frames for the outputs, which fit in dst
+        u32 index = static_cast<u32>(tail & (capacity_ - 1));
+        u32 chunk = static_cast<u32>(minimum<u64>(count, capacity_ - index));
+        u32 consumed = 0;
+        produced += stream_.process(ring_ + static_cast<size_t>(index) * channels_, chunk, dst + static_cast<size_t>(produced) * channels_, frames - produced, &consumed);
+        tail += consumed;
+        count -= consumed;
+        if(count <= 0 || consumed < chunk) {
+            break;
+        }
+    }
+    tail_.store(tail, std::memory_order_release);
+    if(produced < frames) {
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        ::memset(dst + static_cast<size_t>(produced) * channels_, 0, sizeof(s16) * (frames - produced) * channels_);
+    }
+    return produced;
+}
+
+u64 RealtimeStream::input_frames(u32 frames) const
+{
+    RESAMCPP_ASSERT(valid());
+    return stream_.input_frames(frames);
+}
+
+u32 RealtimeStream::queued() const
+{
+    u64 tail = tail_.load(std::memory_order_acquire);
+    u64 head = head_.load(std::memory_order_acquire);
+    return static_cast<u32>(head - tail);
+}
+
+u32 RealtimeStream::space() const
+{
+    return capacity_ - queued();
+}
+
+u64 RealtimeStream::underruns() const
+{
+    return underruns_.load(std::memory_order_relaxed);
+}
+
+u64 RealtimeStream::overruns() const
+{
+    return overruns_.load(std::memory_order_relaxed);
+}
+
+//--- StreamEngine
+//-----------------------------------------------------------
+namespace
+{
+    u32 count_lanes(u32 active)
+    {
+        u32 count = 0;
+        for(; 0 != active; active &= active - 1) {
+            ++count;
+        }
+        return count;
+    }
+} // namespace
+
+struct StreamEngine::Batch
+{
+    Batch();
+    ~Batch();
+
+    /**
+    @brief Silence the history of a lane, so that the next stream in it starts from silence
+    */
+    void clear_lane(u32 lane);
+    void push(const s16* const* src, u32 offset, u32 frames);
+    u32 emit(s16* const* dst, u32 offset, u32 dstCapacity, u64 end);
+
+    const Resampler* resampler_; //!< owned by a group of the engine
+    u32 srcFrequency_;
+    u32 dstFrequency_;
+    Resampler::Quality quality_;
+    DotFunction<f32> dot_;
+    f32 gain_;
+    u32 phases_;
+    u32 integerStep_;
+    u32 phaseStep_;
+    u32 wing_;
+    u32 ahead_;
+    u32 capacity_;
+    u32 active_; //!< a bit per lane of the joined streams
+    u64 position_;
+    u32 phase_;
+    u64 written_;
+    u64 calls_;
+    u64 samples_;
+    f64 seconds_;
+    f32* ring_; //!< capacity_ * 2 frames of BatchSize samples, every frame is mirrored like Stream
+};
+
+StreamEngine::Batch::Batch()
+    : resampler_(RESAMCPP_NULL)
+    , srcFrequency_(0)
+    , dstFrequency_(0)
+    , quality_(Resampler::Quality::Best)
+    , dot_(RESAMCPP_NULL)
+    , gain_(0.0f)
+    , phases_(0)
+    , integerStep_(0)
+    , phaseStep_(0)
+    , wing_(0)
+    , ahead_(0)
+    , capacity_(0)
+    , active_(0)
+    , position_(0)
+    , phase_(0)
+    , written_(0)
+    , calls_(0)
+    , samples_(0)
+    , seconds_(0.0)
+    , ring_(RESAMCPP_NULL)
+{
+}
+
+StreamEngine::Batch::~Batch()
+{
+    ::free(ring_);
+}
+
+void StreamEngine::Batch::clear_lane(u32 lane)
+{
+    for(u32 i = 0; i < capacity_ * 2; ++i) {
+        ring_[static_cast<size_t>(i) * BatchSize + lane] = 0.0f;
+    }
+}
+
+void StreamEngine::Batch::push(const s16* const* src, u32 offset, u32 frames)
+{
+    for(u32 i = 0; i < frames; ++i) {
+        u32 slot = static_cast<u32>(written_ % capacity_);
+        f32* s0 = ring_ + static_cast<size_t>(slot) * BatchSize;
+        f32* s1 = ring_ + static_cast<size_t>(slot + capacity_) * BatchSize;
+        for(u32 k = 0; k < BatchSize; ++k) {
+            s0[k] = s1[k] = (RESAMCPP_NULL != src[k]) ? static_cast<f32>(src[k][offset + i]) : 0.0f;
+        }
+        ++written_;
+    }
+}
+
+u32 StreamEngine::Batch::emit(s16* const* dst, u32 offset, u32 dstCapacity, u64 end)
+{
+    const f32* bank = resampler_->bank();
+    u32 width = resampler_->width();
+    u32 produced = 0;
+    for(; position_ < end && produced < dstCapacity; ++produced) {
+        u32 start = static_cast<u32>((position_ + capacity_ + 1 - wing_) % capacity_);
+        const f32* window = ring_ + static_cast<size_t>(start) * BatchSize;
+        u32 left = static_cast<u32>(minimum<u64>(position_ + 1, wing_));
+        u32 right = static_cast<u32>(minimum<u64>(written_ - position_ - 1, ahead_));
+        const f32* row = bank + static_cast<size_t>(phase_) * width;
+        u32 first = wing_ - left;
+
+        // One row of weights for all lanes
+        f32 values[BatchSize];
+        clear_values(values, BatchSize);
+        dot_(values, BatchSize, left + right, row + first, window + static_cast<size_t>(first) * BatchSize);
+        for(u32 k = 0; k < BatchSize; ++k) {
+            if(RESAMCPP_NULL != dst[k]) {
+                store_sample(dst[k][offset + produced], values[k], gain_, false, 0);
+            }
+        }
+        advance(position_, phase_, integerStep_, phaseStep_, phases_);
+    }
+    return produced;
+}
+
+struct StreamEngine::Group
+{
+    u32 phases_;
+    u32 step_;
+    Resampler::Quality quality_;
+    Resampler resampler_;
+};
+
+StreamEngine::StreamEngine()
+    : batches_(0)
+    , allocated_(0)
+    , batch_(RESAMCPP_NULL)
+    , groups_(0)
+    , allocatedGroups_(0)
+    , group_(RESAMCPP_NULL)
+{
+}
+
+StreamEngine::StreamEngine(StreamEngine&& other)
+    : batches_(other.batches_)
+    , allocated_(other.allocated_)
+    , batch_(other.batch_)
+    , groups_(other.groups_)
+    , allocatedGroups_(other.allocatedGroups_)
+    , group_(other.group_)
+{
+    other.batches_ = 0;
+    other.allocated_ = 0;
+    other.batch_ = RESAMCPP_NULL;
+    other.groups_ = 0;
+    other.allocatedGroups_ = 0;
+    other.group_ = RESAMCPP_NULL;
+}
+
+StreamEngine::~StreamEngine()
+{
+    for(u32 i = 0; i < batches_; ++i) {
+        delete batch_[i];
+    }
+    ::free(batch_);
+    for(u32 i = 0; i < groups_; ++i) {
+        delete group_[i];
+    }
+    ::free(group_);
+}
+
+StreamEngine& StreamEngine::operator=(StreamEngine&& other)
+{
+    if(this != &other) {
+        for(u32 i = 0; i < batches_; ++i) {
+            delete batch_[i];
+        }
+        ::free(batch_);
+        for(u32 i = 0; i < groups_; ++i) {
+            delete group_[i];
+        }
+        ::free(group_);
+        batches_ = other.batches_;
+        allocated_ = other.allocated_;
+        batch_ = other.batch_;
+        groups_ = other.groups_;
+        allocatedGroups_ = other.allocatedGroups_;
+        group_ = other.group_;
+        other.batches_ = 0;
+        other.allocated_ = 0;
+        other.batch_ = RESAMCPP_NULL;
+        other.groups_ = 0;
+        other.allocatedGroups_ = 0;
+        other.group_ = RESAMCPP_NULL;
+    }
+    return *this;
+}
+
+const Resampler* StreamEngine::find(u32 srcFrequency, u32 dstFrequency, Resampler::Quality quality)
+{
+    u32 divisor = gcd(srcFrequency, dstFrequency);
+    if(divisor <= 0) {
+        return RESAMCPP_NULL;
+    }
+    // The bank depends only on the reduced ratio and the quality, so batches of the same ratio share it
+    u32 phases = dstFrequency / divisor;
+    u32 step = srcFrequency / divisor;
+    for(u32 i = 0; i < groups_; ++i) {
+        if(phases == group_[i]->phases_ && step == group_[i]->step_ && quality == group_[i]->quality_) {
+            return &group_[i]->resampler_;
+        }
+    }
+    Resampler resampler = Resampler::initialize(step, phases, quality);
+    if(RESAMCPP_NULL == resampler.bank()) {
+        return RESAMCPP_NULL;
+    }
+    if(allocatedGroups_ <= groups_) {
+        u32 allocated = maximum(4U, allocatedGroups_ * 2);
+        Group** groups = reinterpret_cast<Group**>(::realloc(group_, sizeof(Group*) * allocated));
+        if(RESAMCPP_NULL == groups) {
+            return RESAMCPP_NULL;
+        }
+        group_ = groups;
+        allocatedGroups_ = allocated;
+    }
+    Group* group = new Group();
+    group->phases_ = phases;
+    group->step_ = step;
+    group->quality_ = quality;
+    group->resampler_ = static_cast<Resampler&&>(resampler);
+    group_[groups_++] = group;
+    return &group->resampler_;
+}
+
+u32 StreamEngine::join(u32 srcFrequency, u32 dstFrequency, Resampler::Quality quality)
+{
+    // A lane of a batch of the same ratio, or an empty batch of any ratio
+    u32 empty = InvalidStream;
+    for(u32 i = 0; i < batches_; ++i) {
+        Batch& batch = *batch_[i];
+        if(0 == batch.active_) {
+            empty = (InvalidStream == empty) ? i : empty;
+        }
+        if(srcFrequency != batch.srcFrequency_ || dstFrequency != batch.dstFrequency_ || quality != batch.quality_ || 0xFFFFU == batch.active_) {
+            continue;
+        }
+        for(u32 lane = 0; lane < BatchSize; ++lane) {
+            if(0 == (batch.active_ & (1U << lane))) {
+                batch.active_ |= 1U << lane;
+                return i * BatchSize + lane;
+            }
+        }
+    }
+
+    const Resampler* resampler = find(srcFrequency, dstFrequency, quality);
+    if(RESAMCPP_NULL == resampler) {
+        return InvalidStream;
+    }
+    u32 wing = resampler->window() - resampler->lookahead();
+    u32 ahead = resampler->lookahead();
+    u32 capacity = wing + ahead;
+    f32* ring = reinterpret_cast<f32*>(::calloc(static_cast<size_t>(capacity) * 2 * BatchSize, sizeof(f32)));
+    if(RESAMCPP_NULL == ring) {
+        return InvalidStream;
+    }
+    u32 index = empty;
+    if(InvalidStream == index) {
+        if(allocated_ <= batches_) {
+            u32 allocated = maximum(4U, allocated_ * 2);
+            Batch** batches = reinterpret_cast<Batch**>(::realloc(batch_, sizeof(Batch*) * allocated));
+            if(RESAMCPP_NULL == batches) {
+                ::free(ring);
+                return InvalidStream;
+            }
+            batch_ = batches;
+            allocated_ = allocated;
+        }
+        batch_[batches_] = new Batch();
+        index = batches_++;
+    }
+    Batch& batch = *batch_[index];
+    ::free(batch.ring_);
+    u32 divisor = gcd(srcFrequency, dstFrequency);
+    batch.phases_ = dstFrequency / divisor;
+    batch.integerStep_ = (srcFrequency / divisor) / batch.phases_;
+    batch.phaseStep_ = (srcFrequency / divisor) % batch.phases_;
+    batch.dot_ = get_dot<f32>(resampler->kernel(), BatchSize);
+    batch.gain_ = get_gain<s16, s16>(resampler->scale());
+    batch.resampler_ = resampler;
+    batch.srcFrequency_ = srcFrequency;
+    batch.dstFrequency_ = dstFrequency;
+    batch.quality_ = quality;
+    batch.wing_ = wing;
+    batch.ahead_ = ahead;
+    batch.capacity_ = capacity;
+    batch.active_ = 1U;
+    batch.position_ = 0;
+    batch.phase_ = 0;
+    batch.written_ = 0;
+    batch.calls_ = 0;
+    batch.samples_ = 0;
+    batch.seconds_ = 0.0;
+    batch.ring_ = ring;
+    return index * BatchSize;
+}
+
+void StreamEngine::leave(u32 stream)
+{
+    u32 index = stream / BatchSize;
+    u32 lane = stream % BatchSize;
+    if(batches_ <= index || 0 == (batch_[index]->active_ & (1U << lane))) {
+        return;
+    }
+    batch_[index]->active_ &= ~(1U << lane);
+    batch_[index]->clear_lane(lane);
+}
+
+u32 StreamEngine::capacity() const
+{
+    return batches_ * BatchSize;
+}
+
+u32 StreamEngine::batches() const
+{
+    return batches_;
+}
+
+u32 StreamEngine::groups() const
+{
+    return groups_;
+}
+
+void StreamEngine::statistics(Statistics& statistics, u32 batch) const
+{
+    RESAMCPP_ASSERT(batch < batches_);
+    const Batch& b = *batch_[batch];
+    statistics.srcFrequency_ = b.srcFrequency_;
+    statistics.dstFrequency_ = b.dstFrequency_;
+    statistics.quality_ = b.quality_;
+    statistics.streams_ = count_lanes(b.active_);
+    statistics.calls_ = b.calls_;
+    statistics.samples_ = b.samples_;
+    statistics.seconds_ = b.seconds_;
+}
+
+void StreamEngine::reset_statistics()
+{
+    for(u32 i = 0; i < batches_; ++i) {
+        batch_[i]->calls_ = 0;
+        batch_[i]->samples_ = 0;
+        batch_[i]->seconds_ = 0.0;
+    }
+}
+
+void StreamEngine::process(u32 srcFrames, const s16* const* src, s16* const* dst, u32 dstCapacity, u32* dstFrames)
+{
+    for(u32 i = 0; i < batches_; ++i) {
+        Batch& batch = *batch_[i];
+        if(0 == batch.active_) {
+            continue;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // The lanes without a stream are silent and discarded
+        const s16* inputs[BatchSize];
+        s16* outputs[BatchSize];
+        for(u32 lane = 0; lane < BatchSize; ++lane) {
+            bool active = 0 != (batch.active_ & (1U << lane));
+            inputs[lane] = active ? src[i * BatchSize + lane] : RESAMCPP_NULL;
+            outputs[lane] = active ? dst[i * BatchSize + lane] : RESAMCPP_NULL;
+        }
+
+        // The same steps as Stream::process
+        u32 count = 0;
+        u32 produced = 0;
+        for(;;) {
+            if(batch.ahead_ < batch.written_) {
+                produced += batch.emit(outputs, produced, dstCapacity - produced, batch.written_ - batch.ahead_);
+            }
+            if(batch.position_ + batch.ahead_ < batch.written_ || srcFrames <= count) {
+                break;
+            }
+            u32 frames = static_cast<u32>(minimum<u64>(srcFrames - count, batch.position_ + batch.ahead_ + 1 - batch.written_));
+            batch.push(inputs, count, frames);
+            count += frames;
+        }
+        RESAMCPP_ASSERT(count == srcFrames);
+        for(u32 lane = 0; lane < BatchSize; ++lane) {
+            dstFrames[i * BatchSize + lane] = (0 != (batch.active_ & (1U << lane))) ? produced : 0;
+        }
+        ++batch.calls_;
+        batch.samples_ += static_cast<u64>(produced) * count_lanes(batch.active_);
+        batch.seconds_ += std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+//--- Cascade
+//-----------------------------------------------------------
+namespace
+{
+    /**
+    @brief The number of odd taps in a half of a half-band filter, which passes [0, band] and attenuates [1/2 - band, 1/2]
+    @param band ... the passband edge relative to the input frequency, below 1/4
+    */
+    u32 get_half_band_length(f64 band, f64 attenuation)
+    {
+        const f64 pi = 3.14159265358979323846;
+        // Kaiser's estimate of the order for the transition width
+        f64 transition = 2.0 * pi * maximum(0.5 - 2.0 * band, 0.005);
+        f64 order = (attenuation - 7.95) / (2.285 * transition);
+        u32 reach = static_cast<u32>(ceil(order * 0.5)) | 1U;
+        return (reach + 1) / 2;
+    }
+
+    f64 get_half_band_tap(u32 distance, u32 length, f64 beta)
+    {
+        const f64 pi = 3.14159265358979323846;
+        f64 x = pi * 0.5 * distance;
+        f64 r = static_cast<f64>(distance) / (length * 2);
+        return 0.5 * sin(x) / x * bessel_i0(beta * sqrt(maximum(0.0, 1.0 - r * r)));
+    }
+
+    /**
+    @brief Design the odd taps of a Kaiser windowed half-band filter, the even taps are zero except the center 1/2
+    */
+    void design_half_band(f32* taps, u32 length, f64 attenuation)
+    {
+        f64 beta = 0.1102 * (attenuation - 8.7);
+        // Normalize the odd taps of a side to 1/4, so that the gain at DC is one
+        f64 sum = 0.0;
+        for(u32 j = 0; j < length; ++j) {
+            sum += get_half_band_tap(j * 2 + 1, length, beta);
+        }
+        f64 scale = 0.25 / sum;
+        for(u32 j = 0; j < length; ++j) {
+            taps[j] = static_cast<f32>(get_half_band_tap(j * 2 + 1, length, beta) * scale);
+        }
+    }
+} // namespace
+
+Cascade Cascade::initialize(u32 srcFrequency, u32 dstFrequency, Resampler::Quality quality)
+{
+    return initialize(srcFrequency, dstFrequency, Resampler::design(quality));
+}
+
+Cascade Cascade::initialize(u32 srcFrequency, u32 dstFrequency, const FilterDesign& design)
+{
+    Cascade cascade;
+    if(srcFrequency <= 0 || dstFrequency <= 0) {
+        return cascade;
+    }
+    // Halve while the output of the stage is not below the destination
+    u32 stages = 0;
+    while(stages < MaxStages && (static_cast<u64>(dstFrequency) << (stages + 1)) <= srcFrequency) {
+        ++stages;
+    }
+    cascade.resampler_ = Resampler::initialize(srcFrequency, dstFrequency << stages, design);
+    if(!cascade.resampler_.valid() || cascade.resampler_.window() <= 0) {
+        cascade.resampler_ = Resampler();
+        return cascade;
+    }
+    if(stages <= 0) {
+        return cascade;
+    }
+
+    // Every stage keeps the passband of the final stage free of aliases
+    f64 attenuation = get_attenuation(design.beta_);
+    f64 passband = 0.5 * design.rolloff_ * dstFrequency;
+    u32 total = 0;
+    for(u32 i = 0; i < stages; ++i) {
+        f64 frequency = static_cast<f64>(srcFrequency) / (1U << i);
+        cascade.lengths_[i] = get_half_band_length(passband / frequency, attenuation);
+        total += cascade.lengths_[i];
+    }
+    cascade.taps_ = reinterpret_cast<f32*>(::malloc(sizeof(f32) * total));
+    if(RESAMCPP_NULL == cascade.taps_) {
+        cascade.resampler_ = Resampler();
+        return cascade;
+    }
+    f32* taps = cascade.taps_;
+    for(u32 i = 0; i < stages; ++i) {
+        design_half_band(taps, cascade.lengths_[i], attenuation);
+        taps += cascade.lengths_[i];
+    }
+    cascade.stages_ = stages;
+    return cascade;
+}
+
+Cascade::Cascade()
+    : stages_(0)
+    , lengths_()
+    , taps_(RESAMCPP_NULL)
+    , capacity_(0)
+    , buffer_(RESAMCPP_NULL)
+{
+}
+
+Cascade::Cascade(Cascade&& other)
+    : stages_(other.stages_)
+    , taps_(other.taps_)
+    , capacity_(other.capacity_)
+    , buffer_(other.buffer_)
+{
+    ::memcpy(lengths_, other.lengths_, sizeof(lengths_));
+    resampler_ = static_cast<Resampler&&>(other.resampler_);
+    other.stages_ = 0;
+    other.taps_ = RESAMCPP_NULL;
+    other.capacity_ = 0;
+    other.buffer_ = RESAMCPP_NULL;
+}
+
+Cascade::~Cascade()
+{
+    ::free(buffer_);
+    ::free(taps_);
+}
+
+Cascade& Cascade::operator=(Cascade&& other)
+{
+    if(this != &other) {
+        ::free(buffer_);
+        ::free(taps_);
+        stages_ = other.stages_;
+        ::memcpy(lengths_, other.lengths_, sizeof(lengths_));
+        taps_ = other.taps_;
+        capacity_ = other.capacity_;
+        buffer_ = other.buffer_;
+        resampler_ = static_cast<Resampler&&>(other.resampler_);
+        other.stages_ = 0;
+        other.taps_ = RESAMCPP_NULL;
+        other.capacity_ = 0;
+        other.buffer_ = RESAMCPP_NULL;
+    }
+    return *this;
+}
+
+bool Cascade::valid() const
+{
+    return resampler_.valid();
+}
+
+u32 Cascade::stages() const
+{
+    return stages_;
+}
+
+u32 Cascade::taps(u32 stage) const
+{
+    RESAMCPP_ASSERT(stage < stages_);
+    return lengths_[stage] * 2 + 1;
+}
+
+const f32* Cascade::half_band(u32 stage) const
+{
+    RESAMCPP_ASSERT(stage < stages_);
+    const f32* taps = taps_;
+    for(u32 i = 0; i < stage; ++i) {
+        taps += lengths_[i];
+    }
+    return taps;
+}
+
+Resampler& Cascade::resampler()
+{
+    return resampler_;
+}
+
+const Resampler& Cascade::resampler() const
+{
+    return resampler_;
+}
+
+u64 Cascade::output_frames(u64 srcFrames) const
+{
+    for(u32 i = 0; i < stages_; ++i) {
+        srcFrames = (srcFrames + 1) / 2;
+    }
+    return resampler_.output_frames(srcFrames);
+}
+
+bool Cascade::reserve(size_t size)
+{
+    if(size <= capacity_) {
+        return true;
+    }
+    ::free(buffer_);
+    buffer_ = reinterpret_cast<f32*>(::malloc(sizeof(f32) * size));
+    capacity_ = (RESAMCPP_NULL != buffer_) ? size : 0;
+    return RESAMCPP_NULL != buffer_;
+}
+
+template<class Dst, class Src>
+u32 Cascade::run(u32 channels, u32 dstSamples, Dst* dst, u32 srcSamples, const Src* src)
+{
+    if(channels <= 0 || Resampler::MaxChannels < channels || !valid()) {
+        return 0;
+    }
+    if(stages_ <= 0) {
+        return resampler_.run(channels, dstSamples, dst, srcSamples, src);
+    }
+    // Stages alternate between two parts of the buffer, which hold ceil(n/2) and ceil(n/4) frames, and the scratch follows them
+    size_t first = (static_cast<size_t>(srcSamples) + 1) / 2 * channels;
+    size_t second = (static_cast<size_t>(srcSamples) + 3) / 4 * channels;
+    u32 length = 0;
+    for(u32 i = 0; i < stages_; ++i) {
+        length = maximum(length, lengths_[i]);
+    }
+    if(!reserve(first + second + get_decimate_scratch(2, length))) {
+        return 0;
+    }
+    f32* buffers[2] = {buffer_, buffer_ + first};
+    f32* scratch = buffer_ + first + second;
+    PairFunction filter = get_pairs(resampler_.kernel());
+    u32 frames = (srcSamples + 1) / 2;
+    decimate(filter, channels, 0, frames, buffers[0], srcSamples, src, 2, 0.5f, lengths_, taps_, 1.0f / Format<Src>::FullScale, false, scratch);
+    const f32* taps = taps_ + lengths_[0];
+    for(u32 i = 1; i < stages_; ++i) {
+        u32 half = (frames + 1) / 2;
+        decimate(filter, channels, 0, half, buffers[i & 1], frames, static_cast<const f32*>(buffers[(i - 1) & 1]), 2, 0.5f, lengths_ + i, taps, 1.0f, false, scratch);
+        frames = half;
+        taps += lengths_[i];
+    }
+    return resampler_.run(channels, dstSamples, dst, frames, static_cast<const f32*>(buffers[(stages_ - 1) & 1]));
+}
+
+#define RESAMCPP_INSTANTIATE(Dst, Src) \
+    template u32 Cascade::run<Dst, Src>(u32, u32, Dst*, u32, const Src*);
+
+#define RESAMCPP_INSTANTIATE_SRC(Dst) \
+    RESAMCPP_INSTANTIATE(Dst, u8) \
+    RESAMCPP_INSTANTIATE(Dst, s16) \
+    RESAMCPP_INSTANTIATE(Dst, s24) \
+    RESAMCPP_INSTANTIATE(Dst, s32) \
+    RESAMCPP_INSTANTIATE(Dst, f32)
+
+RESAMCPP_INSTANTIATE_SRC(u8)
+RESAMCPP_INSTANTIATE_SRC(s16)
+RESAMCPP_INSTANTIATE_SRC(s24)
+RESAMCPP_INSTANTIATE_SRC(s32)
+RESAMCPP_INSTANTIATE_SRC(f32)
+#undef RESAMCPP_INSTANTIATE_SRC
+#undef RESAMCPP_INSTANTIATE
+
+//--- BatchResampler
+//-----------------------------------------------------------
+namespace
+{
+    /**
+    @brief The output frames of a clip, the same as Resampler::output_frames without building one
+    */
+    u64 get_output_frames(u64 srcFrames, u32 srcFrequency, u32 dstFrequency)
+    {
+        if(srcFrequency <= 0 || dstFrequency <= 0) {
+            return 0;
+        }
+        u32 divisor = gcd(srcFrequency, dstFrequency);
+        u32 phases = dstFrequency / divisor;
+        u32 step = srcFrequency / divisor;
+        u64 q = srcFrames / step;
+        u64 r = (srcFrames % step) * phases;
+        return q * phases + (r + step - 1) / step;
+    }
+
+    /**
+    @brief The jobs of a thread, the owner pops the front and thieves pop the back of the same word
+    */
+    struct alignas(64) JobQueue
+    {
+        std::atomic<u64> range_; //!< the begin in the low half and the end in the high half
+    };
+
+    bool pop_front(JobQueue& queue, u32& index)
+    {
+        u64 range = queue.range_.load(std::memory_order_relaxed);
+        for(;;) {
+            u32 begin = static_cast<u32>(range);
+            u32 end = static_cast<u32>(range >> 32);
+            if(end <= begin) {
+                return false;
+            }
+            if(queue.range_.compare_exchange_weak(range, (static_cast<u64>(end) << 32) | (begin + 1), std::memory_order_relaxed)) {
+                index = begin;
+                return true;
+            }
+        }
+    }
+
+    bool pop_back(JobQueue& queue, u32& index)
+    {
+        u64 range = queue.range_.load(std::memory_order_relaxed);
+        for(;;) {
+            u32 begin = static_cast<u32>(range);
+            u32 end = static_cast<u32>(range >> 32);
+            if(end <= begin) {
+                return false;
+            }
+            if(queue.range_.compare_exchange_weak(range, (static_cast<u64>(end - 1) << 32) | begin, std::memory_order_relaxed)) {
+                index = end - 1;
+                return true;
+            }
+        }
+    }
+
+    /**
+    @brief Resample the jobs of a thread, then steal from the others until every queue is empty
+    */
+    template<class Dst, class Src>
+    void run_jobs(u32 worker, u32 workers, JobQueue* queues, const u32* order, BatchJob<Dst, Src>* jobs, const Resampler* const* resamplers, Dst* arena)
+    {
+        for(;;) {
+            u32 slot;
+            bool found = pop_front(queues[worker], slot);
+            for(u32 i = 1; !found && i < workers; ++i) {
+                found = pop_back(queues[(worker + i) % workers], slot);
+            }
+            if(!found) {
+                return;
+            }
+            u32 index = order[slot];
+            BatchJob<Dst, Src>& job = jobs[index];
+            resamplers[index]->run(job.channels_, job.dstFrames_, arena + job.offset_, job.srcFrames_, job.src_);
+        }
+    }
+} // namespace
+
+/**
+@brief The resampler of a reduced ratio
+*/
+struct BatchResampler::Group
+{
+    u32 phases_;
+    u32 step_;
+    Resampler resampler_;
+};
+
+BatchResampler BatchResampler::initialize(Resampler::Quality quality)
+{
+    BatchResampler batch;
+    batch.quality_ = quality;
+    return batch;
+}
+
+BatchResampler::BatchResampler()
+    : quality_(Resampler::Quality::Best)
+    , groups_(0)
+    , allocated_(0)
+    , group_(RESAMCPP_NULL)
+{
+}
+
+BatchResampler::BatchResampler(BatchResampler&& other)
+    : quality_(other.quality_)
+    , groups_(other.groups_)
+    , allocated_(other.allocated_)
+    , group_(other.group_)
+{
+    other.groups_ = 0;
+    other.allocated_ = 0;
+    other.group_ = RESAMCPP_NULL;
+}
+
+BatchResampler::~BatchResampler()
+{
+    for(u32 i = 0; i < groups_; ++i) {
+        delete group_[i];
+    }
+    ::free(group_);
+}
+
+BatchResampler& BatchResampler::operator=(BatchResampler&& other)
+{
+    if(this != &other) {
+        for(u32 i = 0; i < groups_; ++i) {
+            delete group_[i];
+        }
+        ::free(group_);
+        quality_ = other.quality_;
+        groups_ = other.groups_;
+        allocated_ = other.allocated_;
+        group_ = other.group_;
+        other.groups_ = 0;
+        other.allocated_ = 0;
+        other.group_ = RESAMCPP_NULL;
+    }
+    return *this;
+}
+
+u32 BatchResampler::groups() const
+{
+    return groups_;
+}
+
+const Resampler* BatchResampler::find(u32 srcFrequency, u32 dstFrequency)
+{
+    if(srcFrequency <= 0 || dstFrequency <= 0) {
+        return RESAMCPP_NULL;
+    }
+    u32 divisor = gcd(srcFrequency, dstFrequency);
+    // The filter and the bank depend only on the reduced ratio
+    u32 phases = dstFrequency / divisor;
+    u32 step = srcFrequency / divisor;
+    for(u32 i = 0; i < groups_; ++i) {
+        if(phases == group_[i]->phases_ && step == group_[i]->step_) {
+            return &group_[i]->resampler_;
+        }
+    }
+    // A ratio below 1/oversample has no window, its jobs are rejected instead of dividing by zero
+    Resampler resampler = Resampler::initialize(step, phases, quality_);
+    if(!resampler.valid() || resampler.window() <= 0) {
+        return RESAMCPP_NULL;
+    }
+    if(allocated_ <= groups_) {
+        u32 allocated = maximum(4U, allocated_ * 2);
+        Group** groups = reinterpret_cast<Group**>(::realloc(group_, sizeof(Group*) * allocated));
+        if(RESAMCPP_NULL == groups) {
+            return RESAMCPP_NULL;
+        }
+        group_ = groups;
+        allocated_ = allocated;
+    }
+    Group* group = new Group();
+    group->phases_ = phases;
+    group->step_ = step;
+    group->resampler_ = static_cast<Resampler&&>(resampler);
+    group_[groups_++] = group;
+    return &group->resampler_;
+}
+
+template<class Dst, class Src>
+u64 BatchResampler::arena_samples(u32 count, const BatchJob<Dst, Src>* jobs)
+{
+    u64 samples = 0;
+    for(u32 i = 0; i < count; ++i) {
+        const BatchJob<Dst, Src>& job = jobs[i];
+        if(0 < job.channels_ && job.channels_ <= Resampler::MaxChannels) {
+            samples += get_output_frames(job.srcFrames_, job.srcFrequency_, job.dstFrequency_) * job.channels_;
+        }
+    }
+    return samples;
+}
+
+template<class Dst, class Src>
+u32 BatchResampler::run(u32 count, BatchJob<Dst, Src>* jobs, u64 arenaSamples, Dst* arena, u32 threads)
+{
+    if(count <= 0 || arenaSamples < arena_samples(count, jobs)) {
+        return 0;
+    }
+    const Resampler** resamplers = reinterpret_cast<const Resampler**>(::malloc(sizeof(const Resampler*) * count));
+    u32* order = reinterpret_cast<u32*>(::malloc(sizeof(u32) * count * 2));
+    if(RESAMCPP_NULL == resamplers || RESAMCPP_NULL == order) {
+        ::free(order);
+        ::free(resamplers);
+        return 0;
+    }
+
+    // Pack the outputs in the order of the jobs, the resamplers are set up before any thread starts
+    u32 valid = 0;
+    u64 offset = 0;
+    for(u32 i = 0; i < count; ++i) {
+        BatchJob<Dst, Src>& job = jobs[i];
+        bool supported = 0 < job.channels_ && job.channels_ <= Resampler::MaxChannels;
+        resamplers[i] = supported ? find(job.srcFrequency_, job.dstFrequency_) : RESAMCPP_NULL;
+        u64 frames = supported ? get_output_frames(job.srcFrames_, job.srcFrequency_, job.dstFrequency_) : 0;
+        job.offset_ = offset;
+        job.dstFrames_ = (RESAMCPP_NULL != resamplers[i] && frames <= 0xFFFFFFFFULL) ? static_cast<u32>(frames) : 0;
+        offset += frames * (supported ? job.channels_ : 0);
+        if(0 < job.dstFrames_) {
+            order[valid++] = i;
+        }
+    }
+    // Deal the longest jobs first, so that every thread starts with a long one and steals short ones at the end
+    std::sort(order, order + valid, [jobs, resamplers](u32 x, u32 y) {
+        return static_cast<u64>(jobs[x].dstFrames_) * jobs[x].channels_ * resamplers[x]->window() > static_cast<u64>(jobs[y].dstFrames_) * jobs[y].channels_ * resamplers[y]->window();
+    });
+    if(threads <= 0) {
+        threads = maximum(1U, std::thread::hardware_concurrency());
+    }
+    u32 workers = maximum(1U, minimum(threads, valid));
+    JobQueue* queues = new JobQueue[workers]();
+    u32* dealt = order + count;
+    u32 slot = 0;
+    for(u32 w = 0; w < workers; ++w) {
+        u32 begin = slot;
+        for(u32 i = w; i < valid; i += workers) {
+            dealt[slot++] = order[i];
+        }
+        queues[w].range_.store((static_cast<u64>(slot) << 32) | begin, std::memory_order_relaxed);
+    }
+
+    std::thread* others = new std::thread[workers - 1];
+    for(u32 w = 1; w < workers; ++w) {
+        others[w - 1] = std::thread(run_jobs<Dst, Src>, w, workers, queues, dealt, jobs, resamplers, arena);
+    }
+    run_jobs<Dst, Src>(0, workers, queues, dealt, jobs, resamplers, arena);
+    for(u32 w = 1; w < workers; ++w) {
+        others[w - 1].join();
+    }
+    delete[] others;
+    delete[] queues;
+    ::free(order);
+    ::free(resamplers);
+    return valid;
+}
+
+#define RESAMCPP_INSTANTIATE(Dst, Src) \
+    template u64 BatchResampler::arena_samples<Dst, Src>(u32, const BatchJob<Dst, Src>*); \
+    template u32 BatchResampler::run<Dst, Src>(u32, BatchJob<Dst, Src>*, u64, Dst*, u32);
+
+#define RESAMCPP_INSTANTIATE_SRC(Dst) \
+    RESAMCPP_INSTANTIATE(Dst, u8) \
+    RESAMCPP_INSTANTIATE(Dst, s16) \
+    RESAMCPP_INSTANTIATE(Dst, s24) \
+    RESAMCPP_INSTANTIATE(Dst, s32) \
+    RESAMCPP_INSTANTIATE(Dst, f32)
+
+RESAMCPP_INSTANTIATE_SRC(u8)
+RESAMCPP_INSTANTIATE_SRC(s16)
+RESAMCPP_INSTANTIATE_SRC(s24)
+RESAMCPP_INSTANTIATE_SRC(s32)
+RESAMCPP_INSTANTIATE_SRC(f32)
+#undef RESAMCPP_INSTANTIATE_SRC
+#undef RESAMCPP_INSTANTIATE
 } // namespace resamcpp
@@ -25,7 +25,11 @@ WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
 ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
 OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
+#include <atomic>
 #include <cstdint>
+#ifdef RESAMCPP_WAV
+#    include <cstdio>
+#endif
 
 namespace resamcpp
 {
@@ -63,6 +67,14 @@ typedef uint64_t size_t;
 #    define RESAMCPP_ASSERT(exp) assert(exp)
 #endif
 
+/**
+@brief A packed little endian 24 bit sample
+*/
+struct s24
+{
+    u8 bytes_[3];
+};
+
 #ifdef RESAMCPP_WAV
 struct HEAD
 {
@@ -80,6 +92,8 @@ struct RIFF
 struct FMT
 {
     static constexpr u32 ID = 0x20746d66U;
+    static constexpr u16 Format_PCM = 0x0001U;
+    static constexpr u16 Format_Extensible = 0xFFFEU;
     u16 format_;
     u16 channels_;
     u32 frequency_;
@@ -100,31 +114,870 @@ struct WAVE
     FMT format_;
     u64 numSamples_;
     u8* data_;
+    void* mapping_; //!< the mapped file, which data_ points into, or null if data_ is allocated
+    u64 mappingSize_;
 };
 
 WAVE load(const char* filepath);
+
+/**
+@brief Map a file instead of reading it, data_ points into the mapping
+
+Pages are read on demand and hinted as sequential. Writes to data_ are private to the process.
+*/
+WAVE map(const char* filepath);
+
+/**
+@brief Create a file of numSamples frames with its headers, and map it
+
+The file is preallocated, samples written to data_ go to the file, and destroy unmaps it.
+Fails if the file does not fit in 4 GB.
+*/
+WAVE create(const char* filepath, const FMT& format, u64 numSamples);
+
 bool save(const char* filepath, const WAVE& wave);
+
+/**
+@brief Free or unmap the samples
+*/
 void destroy(WAVE& wave);
+
+/**
+@brief Read the frames of a RIFF or RF64 file block by block
+
+Chunks before the data chunk are parsed or skipped, and frames are read sequentially into caller buffers.
+After each block, the kernel is asked to read ahead the next readAhead bytes while the caller processes this one.
+*/
+class WaveReader
+{
+public:
+    static constexpr u32 DefaultReadAhead = 1U << 20;
+
+    static WaveReader initialize(const char* filepath, u32 readAhead = DefaultReadAhead);
+
+    WaveReader();
+    WaveReader(WaveReader&& other);
+    ~WaveReader();
+    WaveReader& operator=(WaveReader&& other);
+
+    bool valid() const;
+    const FMT& format() const;
+
+    /**
+    @brief The number of frames of the data chunk, which is clamped to the size of the file
+    */
+    u64 frames() const;
+
+    /**
+    @brief The number of frames read so far
+    */
+    u64 position() const;
+
+    /**
+    @brief Read up to frames frames into dst, which has frames*blockAlign_ bytes
+    @return the number of frames read, zero at the end of the data
+    */
+    u32 read(void* dst, u32 frames);
+
+private:
+    WaveReader(const WaveReader&) = delete;
+    WaveReader& operator=(const WaveReader&) = delete;
+
+    FILE* file_;
+    FMT format_;
+    u64 frames_;
+    u64 position_;
+    u64 dataOffset_; //!< the offset of the first frame in the file
+    u32 readAhead_;
+};
+
+/**
+@brief Write frames block by block to a file, whose sizes are patched when it is closed
+
+A JUNK chunk reserves the room of a ds64 chunk, so a file over 4 GB becomes RF64 at close.
+*/
+class WaveWriter
+{
+public:
+    static WaveWriter initialize(const char* filepath, const FMT& format);
+
+    WaveWriter();
+    WaveWriter(WaveWriter&& other);
+    ~WaveWriter();
+    WaveWriter& operator=(WaveWriter&& other);
+
+    bool valid() const;
+    const FMT& format() const;
+
+    /**
+    @brief The number of frames written so far
+    */
+    u64 frames() const;
+
+    /**
+    @brief Append frames from src, which has frames*blockAlign_ bytes
+    */
+    bool write(const void* src, u32 frames);
+
+    /**
+    @brief Pad the data chunk to an even size, patch the sizes and close the file, the destructor closes it too
+    @return false if any write failed
+    */
+    bool close();
+
+private:
+    WaveWriter(const WaveWriter&) = delete;
+    WaveWriter& operator=(const WaveWriter&) = delete;
+
+    FILE* file_;
+    FMT format_;
+    u64 frames_;
+    bool failed_;
+};
+#endif
+
+class Stream;
+struct InterpolateKernels;
+#ifdef RESAMCPP_STATS
+struct Counters;
 #endif
 
+/**
+@brief The right half of a windowed sinc, sampled oversample_ times per zero crossing, and the differences of neighbors
+*/
+struct Filter
+{
+    u32 oversample_;
+    u32 taps_;
+    const f32* filter_;
+    const f32* filterDelta_;
+};
+
+/**
+@brief Parameters of a Kaiser windowed sinc, which is designed in f64 and stored in f32
+
+The filter is rolloff*sinc(rolloff*k/oversample)*I0(beta*sqrt(1-(k/n)^2))/I0(beta) for k in [0, n], n = zeroCrossings*oversample.
+*/
+struct FilterDesign
+{
+    f64 beta_; //!< the shape of the Kaiser window
+    f64 rolloff_; //!< the cutoff relative to the Nyquist frequency
+    u32 zeroCrossings_; //!< the number of zero crossings in a half of the sinc
+    u32 oversample_; //!< the number of samples per zero crossing
+};
+
 class Resampler
 {
 public:
-    static constexpr u32 MaxFilterSize = 257;
+    static constexpr u32 MaxFilterSize = 257; //!< the taps of the largest preset
+    static constexpr u32 MaxZeroCrossings = 256;
+    static constexpr u32 MaxOversample = 4096;
+    static constexpr u32 MaxChannels = 32;
+    static constexpr u32 MaxPhases = 1024; //!< the maximum number of phases in a polyphase bank
+    static constexpr u32 MaxFactor = 4; //!< the maximum integer ratio, up or down, which has a Nyquist filter
+    static constexpr u64 MaxBankSize = 4 * 1024 * 1024; //!< the maximum bytes of a polyphase bank
+    static constexpr u32 BankAlign = 16; //!< the alignment of a row in a polyphase bank, in floats
+    static constexpr u32 MinParallelChunk = 4096; //!< the minimum output frames for a thread
+    static constexpr u32 MaxPhaseBits = 16; //!< the finest quantization of the time of an interpolated filter
+    static constexpr u64 MaxPhaseCacheSize = 64 * 1024 * 1024; //!< the maximum bytes of the rows of quantized phases
     enum class Quality
     {
         Fast,
         Best,
     };
 
-    static Resampler initialize(u32 srcFrequency, u32 dstFrequency, Quality quality = Quality::Best);
-    u32 run(u32 channels, u32 dstSamples, s16* dst, u32 srcSamples, const s16* src);
-    u32 run_ispc(u32 channels, u32 dstSamples, s16* dst, u32 srcSamples, const s16* src);
+    enum class Kernel
+    {
+        Scalar,
+        AVX2,
+        AVX512,
+        NEON,
+    };
+
+    /**
+    @brief A snapshot of the counters of a resampler since the last reset_statistics
+
+    The counters are collected only if the library is built with RESAMCPP_STATS, otherwise they stay zero and cost nothing.
+    They are relaxed atomics, which are shared by run_parallel and every Stream of the resampler.
+    */
+    struct Statistics
+    {
+        /**
+        @brief The loop, which produced the outputs of a call
+        */
+        enum class Path
+        {
+            Interpolate, //!< run with the filter interpolated for each output
+            Bank, //!< run over the polyphase bank
+            Integer, //!< run with a Nyquist filter
+            Fixed, //!< run with Q15 weights
+            Quantized, //!< run with the cached rows of quantized phases
+            Planar, //!< run_planar
+            ISPC, //!< run_ispc, whose fallbacks count as the path of run
+            Stream, //!< Stream::process and Stream::flush
+        };
+        static constexpr u32 Paths = 8;
+        static constexpr u32 LatencyBuckets = 32; //!< the bucket b counts calls of [2^b, 2^(b+1)) nanoseconds, the last one also longer calls
+#ifdef RESAMCPP_STATS
+        static constexpr bool Enabled = true;
+#else
+        static constexpr bool Enabled = false;
+#endif
+
+        u64 inputFrames_; //!< the input frames, which the time register advanced over
+        u64 outputFrames_;
+        u64 taps_; //!< the input frames inside of the windows of the outputs, the weights applied to each channel
+        u64 clippedWindows_; //!< the outputs whose window was clipped at either end of the input
+        u64 clippedSamples_; //!< the integer output samples, which saturated to the range of their type
+        u64 calls_[Paths]; //!< indexed by Path, a thread of run_parallel is a call
+        u64 latency_[LatencyBuckets]; //!< the histogram of the durations of calls
+    };
+
+    /**
+    @brief The phase response of the filter
+    */
+    enum class Phase
+    {
+        Linear, //!< symmetric, the right wing looks ahead of the output time
+        Minimum, //!< the same magnitude response with all taps at or before the output time, which needs a polyphase bank
+    };
+
+    /**
+    @brief Setup a resampler
+
+    If the ratio reduces to L/M with a small L, every phase of the filter is precomputed into a polyphase bank.
+    Otherwise, the filter is interpolated for each output.
+    Integer ratios up to MaxFactor get a Nyquist filter with the same passband and attenuation as the design instead,
+    whose zero taps are skipped, and the outputs on input frames are copied when upsampling.
+    A minimum phase resampler always uses the bank, and is not valid if the ratio does not fit in one.
+    */
+    static Resampler initialize(u32 srcFrequency, u32 dstFrequency, Quality quality = Quality::Best, Phase phase = Phase::Linear);
+
+    /**
+    @brief Setup a resampler with a filter designed at runtime
+
+    Designed filters are cached and shared by resamplers with the same design, the last resampler frees it.
+    */
+    static Resampler initialize(u32 srcFrequency, u32 dstFrequency, const FilterDesign& design, Phase phase = Phase::Linear);
+
+    Resampler();
+    Resampler(Resampler&& other);
+    ~Resampler();
+    Resampler& operator=(Resampler&& other);
+
+    /**
+    @brief The best kernel for the running CPU, detected once with cpuid
+    */
+    static Kernel supported_kernel();
+    static const char* kernel_name(Kernel kernel);
+
+    /**
+    @brief The design of a quality preset
+    */
+    static FilterDesign design(Quality quality);
+
+    /**
+    @brief Whether the design and the ratio are supported
+    */
+    bool valid() const;
+    const Filter& filter() const;
+
+    /**
+    @brief The table of the design, which a variable ratio of a Stream and quantized phases interpolate
+
+    It is filter() unless that is the Nyquist filter of an integer ratio, which is sampled only factor times per zero crossing.
+    */
+    const Filter& ratio_filter() const;
+
+    /**
+    @brief The kernel for dot products over a polyphase bank, the best supported one by default
+    */
+    Kernel kernel() const;
+    /**
+    @brief Force a kernel, fails if the CPU does not support it
+    */
+    bool set_kernel(Kernel kernel);
+
+    /**
+    @brief The time of the output frame index is exactly frame + phase/L for the reduced ratio L/M
+    */
+    void time_at(u64 index, u64& frame, u32& phase) const;
+
+    /**
+    @brief The number of output frames whose time is inside of srcFrames input frames
+    */
+    u64 output_frames(u64 srcFrames) const;
+
+    /**
+    @brief The number of input frames weighted for an output frame, zero if the ratio is not supported
+    */
+    u32 window() const;
+
+    /**
+    @brief The scale of the filter time, which scales the output too
+
+    It is min(1, ratio) rounded down to a whole step through the filter table, or min(1, ratio) for minimum phase.
+    */
+    f32 scale() const;
+
+    Phase phase() const;
+
+    /**
+    @brief The polyphase bank of L rows, null if the filter is interpolated for each output
+
+    The weight k of the row p is applied to the input frame n - (window() - lookahead()) + 1 + k for the output time n + p/L,
+    and the output is scaled by scale().
+    */
+    const f32* bank() const;
+
+    /**
+    @brief The floats of a row of the bank, which is window() padded to BankAlign
+    */
+    u32 width() const;
+
+    /**
+    @brief The input frames after the frame of an output time, which its weights need, and Stream waits for
+    */
+    u32 lookahead() const;
+
+    /**
+    @brief The delay of the output behind the input, in input frames
+
+    The lookahead plus the group delay of the filter at DC, which is zero for linear phase.
+    A pipeline compensates for it to align the output with the input.
+    */
+    f64 input_latency() const;
+
+    /**
+    @brief The same delay in output frames
+    */
+    f64 output_latency() const;
+
+    /**
+    @brief Add TPDF dither to integer outputs, which are rounded instead of truncated. Off by default
+    */
+    void set_dither(bool dither);
+    bool dither() const;
+
+    /**
+    @brief Resample s16 to s16 with Q15 weights and s32 accumulators instead of f32, off by default
+
+    The rows of the polyphase bank times the filter scale are rounded to Q15 to nearest.
+    Outputs are rounded to nearest, plus TPDF noise of 1 LSB with dither, then saturated.
+    Vector lanes accumulate every other pair of taps in s32, and their sum is s64.
+    Fails without a polyphase bank, or if the absolute weights of a lane sum to 2 or more, which could overflow it.
+    Stream uses the same weights. Integer ratios are faster with the f32 block kernels.
+    */
+    bool set_fixed_point(bool fixedPoint);
+    bool fixed_point() const;
+
+    /**
+    @brief Quantize the time of the interpolated filter to 2^bits bins per input frame, zero evaluates the exact time. Off by default
+
+    The weights of a bin are evaluated at its center into a row like a polyphase bank, and kept in a cache of 2^bits rows,
+    so that any ratio becomes a dense dot product. All rows are built by this call, so that running never locks or designs.
+    The time error is at most half a bin, every bit halves it and trades 6 dB of SNR for twice the memory of the cache.
+    It applies to run, run_planar and run_ispc without a polyphase bank, and to Stream with a variable ratio or without a bank.
+    Fails for minimum phase, or if the cache is larger than MaxPhaseCacheSize.
+    */
+    bool set_phase_bits(u32 bits);
+    u32 phase_bits() const;
+
+    /**
+    @brief The fewest phase bits, up to MaxPhaseBits, whose noise of a full scale sine at the Nyquist frequency is snr dB below it
+    */
+    u32 required_phase_bits(f64 snr) const;
+
+    /**
+    @brief Copy the counters, which are all zero without RESAMCPP_STATS
+    */
+    void statistics(Statistics& statistics) const;
+    void reset_statistics();
+
+    /**
+    @brief Resample interleaved frames of up to MaxChannels channels
+
+    Dst and Src are any of u8, s16, s24, s32 and f32. Samples are converted while loading and storing them in the kernel,
+    f32 samples are in [-1, 1] and the others are scaled to the full range of their types.
+    */
+    template<class Dst, class Src>
+    u32 run(u32 channels, u32 dstSamples, Dst* dst, u32 srcSamples, const Src* src) const;
+
+    /**
+    @brief Resample planar channels, the weights of an output frame are computed once for all channels
+    */
+    u32 run_planar(u32 channels, u32 dstSamples, f32* const* dst, u32 srcSamples, const f32* const* src) const;
+
+    /**
+    @brief Split the output into chunks and resample them on multiple threads
+    @param threads ... the number of threads including the caller, zero for the hardware concurrency
+
+    The output is identical to run.
+    */
+    template<class Dst, class Src>
+    u32 run_parallel(u32 channels, u32 dstSamples, Dst* dst, u32 srcSamples, const Src* src, u32 threads = 0) const;
+
+    /**
+    @brief Resample with the ISPC kernel if it is built with RESAMCPP_ISPC, otherwise the same as run
+    */
+    u32 run_ispc(u32 channels, u32 dstSamples, s16* dst, u32 srcSamples, const s16* src) const;
 private:
+    friend class Stream;
+
+    Resampler(const Resampler&) = delete;
+    Resampler& operator=(const Resampler&) = delete;
+
+    template<class Dst, class Src>
+    u32 run_range(u32 channels, u32 begin, u32 end, Dst* dst, u32 srcSamples, const Src* src) const;
+    template<class Dst, class Src>
+    u32 run_bank(u32 channels, u32 begin, u32 end, Dst* dst, u32 srcSamples, const Src* src) const;
+    template<class Dst, class Src>
+    u32 run_integer(u32 channels, u32 begin, u32 end, Dst* dst, u32 srcSamples, const Src* src) const;
+    u32 run_fixed(u32 channels, u32 begin, u32 end, s16* dst, u32 srcSamples, const s16* src) const;
+    template<class Dst, class Src>
+    u32 run_quantized(u32 channels, u32 begin, u32 end, Dst* dst, u32 srcSamples, const Src* src) const;
+    const f32* phase_row(u32 bin) const;
+#ifdef RESAMCPP_STATS
+    void count_windows(u32 begin, u32 end, u32 srcSamples) const;
+#endif
+
     u32 srcFrequency_;
     u32 dstFrequency_;
-    f32 sampleRatio_;
+    f64 sampleRatio_;
     u32 quality_;
+    Kernel kernel_;
+    bool dither_;
+    const InterpolateKernels* kernels_; //!< the interpolation kernels specialized for the quality
+    Filter filter_; //!< shared with other resamplers of the same design
+    u32 factor_; //!< the integer ratio of a Nyquist filter, or zero
+    u32 phases_; //!< L of the reduced ratio L/M
+    u32 step_; //!< M of the reduced ratio L/M
+    u32 indexStep_; //!< the step through the filter table per input frame, zero if the ratio is too low for the table
+    f32 scale_; //!< the scale of the filter time and of the output
+    Filter ratioFilter_; //!< the table of the design for a variable ratio and quantized phases
+    const InterpolateKernels* ratioKernels_;
+    u32 ratioIndexStep_;
+    f32 ratioScale_;
+    u32 wing_; //!< the frames of a row of the bank at or before the frame of the output time
+    u32 ahead_; //!< the frames of a row of the bank after the frame of the output time
+    u32 width_;
+    Phase phase_;
+    f64 delay_; //!< the group delay of the filter at DC in input frames
+    f32* bank_;
+    s16* fixedBank_; //!< Q15 rows of the polyphase bank when fixed point is enabled
+    u32 phaseBits_;
+    u32 phaseWidth_; //!< the floats of a row of the cache of quantized phases
+    f32* phaseCache_;
+#ifdef RESAMCPP_STATS
+    Counters* counters_;
+#endif
+};
+
+/**
+@brief Per stream state to resample arbitrary sized blocks of a continuous signal
+
+The output does not depend on how the input is split into blocks.
+The resampler must outlive the stream.
+*/
+class Stream
+{
+public:
+    static constexpr u32 BlockFrames = 256; //!< the input frames pushed at once besides both wings
+
+    static Stream initialize(const Resampler& resampler, u32 channels);
+
+    Stream();
+    Stream(Stream&& other);
+    ~Stream();
+    Stream& operator=(Stream&& other);
+
+    bool valid() const;
+
+    /**
+    @brief Clear the history and return to the exact ratio of the resampler
+    */
+    void reset();
+
+    /**
+    @brief Change the ratio of the output to the input frequency, linearly over rampFrames output frames
+
+    The time stays continuous, it moves from the exact register of the resampler to 32.32 fixed point,
+    and every output frame interpolates the table of the design like a resampler without a polyphase bank,
+    also for an integer ratio, whose Nyquist filter is too coarse to interpolate.
+    The cutoff stays at the one of the resampler, so the ratio should stay near its ratio, like a drifting clock.
+    Q15 weights are not used after this.
+    @return false if the ratio is out of [1/65536, 65536], or the filter is minimum phase
+    */
+    bool set_ratio(f64 ratio, u32 rampFrames = 0);
+
+    /**
+    @brief The current ratio of the output to the input frequency
+    */
+    f64 ratio() const;
+
+    /**
+    @brief Consume input frames and write output frames as far as both wings of the filter are available
+    @return the number of output frames
+    @param consumed ... the number of consumed input frames. If null, the whole input must be consumed
+    */
+    u32 process(const s16* src, u32 srcFrames, s16* dst, u32 dstCapacity, u32* consumed = RESAMCPP_NULL);
+
+    /**
+    @brief The number of input frames to process until dstFrames more output frames are written, zero if they are ready
+    */
+    u64 input_frames(u32 dstFrames) const;
+
+    /**
+    @brief Write the remaining output frames assuming silence after the last input frame
+    @return the number of output frames, zero when all frames have been written
+    */
+    u32 flush(s16* dst, u32 dstCapacity);
+
+private:
+    typedef void (*DotFunction)(f32* values, u32 channels, u32 count, const f32* weights, const s16* src);
+    typedef void (*InterpolateFunction)(f32* values, u32 channels, const Filter& filter, f32 scale, u32 indexStep, f32 frac, u32 left, u32 right, const s16* src);
+    typedef void (*FixedDotFunction)(s64* values, u32 channels, u32 count, const s16* weights, const s16* src);
+
+    Stream(const Stream&) = delete;
+    Stream& operator=(const Stream&) = delete;
+
+    void push(const s16* src, u32 frames);
+    u32 emit(s16* dst, u32 dstCapacity, u64 end);
+    u32 lookahead() const;
+    void advance_ratio();
+
+    const Resampler* resampler_;
+    u32 channels_;
+    u32 wing_; //!< the frames at or before the frame of the output time at the exact ratio
+    u32 ahead_; //!< the frames after the frame of the output time at the exact ratio
+    u32 ratioWing_; //!< the frames of either wing of the table of a variable ratio
+    u32 history_; //!< the frames at or before the frame of the output time, which the ring keeps for both
+    u32 capacity_;
+    f32 scale_;
+    u32 indexStep_;
+    f32 gain_;
+    f32 ratioScale_;
+    u32 ratioIndexStep_;
+    f32 ratioGain_;
+    DotFunction dot_; //!< the kernels for the channels, resolved at initialize
+    InterpolateFunction interpolate_;
+    InterpolateFunction ratioInterpolate_;
+    FixedDotFunction fixedDot_;
+    u64 position_;
+    u32 phase_; //!< the fractional time of the next output is phase_/L
+    u32 fraction_; //!< the fractional time of the next output is fraction_/2^32 with a variable ratio
+    u64 step_; //!< the input frames per output frame in 32.32 fixed point, zero for the exact ratio
+    u64 startStep_; //!< the step at the start of a ramp
+    u64 targetStep_; //!< the step at the end of a ramp
+    u32 rampFrames_;
+    u32 rampPosition_;
+    u64 written_;
+    u64 outputs_; //!< the number of output frames, which seeds the dither
+    s16* ring_;
+};
+
+/**
+@brief A Stream behind a wait-free single producer and single consumer ring of input frames, for pull model audio callbacks
+
+A producer thread pushes input frames, and a consumer thread pulls a fixed number of output frames.
+Neither push nor pull allocates, locks or waits for the other thread.
+The counters of underruns and overruns can be read from any thread.
+*/
+class RealtimeStream
+{
+public:
+    /**
+    @param capacity ... the input frames of the ring, which is rounded up to a power of two
+    */
+    static RealtimeStream initialize(const Resampler& resampler, u32 channels, u32 capacity);
+
+    RealtimeStream();
+    RealtimeStream(RealtimeStream&& other);
+    ~RealtimeStream();
+    RealtimeStream& operator=(RealtimeStream&& other);
+
+    bool valid() const;
+    u32 channels() const;
+
+    /**
+    @brief The input frames, which the ring holds
+    */
+    u32 capacity() const;
+
+    /**
+    @brief Write input frames into the ring, only from the producer thread
+    @return the number of written frames, an overrun drops the rest
+    */
+    u32 push(const s16* src, u32 frames);
+
+    /**
+    @brief Resample the input frames in the ring into dst, only from the consumer thread
+    @return the number of resampled frames, an underrun fills the rest of the frames with silence
+    */
+    u32 pull(s16* dst, u32 frames);
+
+    /**
+    @brief The input frames, which pull of the frames output frames needs in the ring, only from the consumer thread
+    */
+    u64 input_frames(u32 frames) const;
+
+    /**
+    @brief The input frames in the ring, the producer can push more at any time
+    */
+    u32 queued() const;
+
+    /**
+    @brief The free frames in the ring, the consumer can pull more at any time
+    */
+    u32 space() const;
+
+    /**
+    @brief The number of pulls, which ran out of input frames
+    */
+    u64 underruns() const;
+
+    /**
+    @brief The number of pushes, which did not fit in the ring
+    */
+    u64 overruns() const;
+
+private:
+    RealtimeStream(const RealtimeStream&) = delete;
+    RealtimeStream& operator=(const RealtimeStream&) = delete;
+
+    Stream stream_;
+    u32 channels_;
+    u32 capacity_;
+    s16* ring_;
+    alignas(64) std::atomic<u64> head_; //!< the written frames, which only the producer stores
+    alignas(64) std::atomic<u64> tail_; //!< the read frames, which only the consumer stores
+    alignas(64) std::atomic<u64> underruns_;
+    std::atomic<u64> overruns_;
+};
+
+/**
+@brief Resample many mono s16 streams, which are grouped into batches of the same ratio and quality
+
+A batch runs up to BatchSize streams in lockstep like a Stream of BatchSize channels.
+Its history is a structure of arrays, whose frame holds one sample of every stream,
+so that the weights of an output phase are loaded once and applied to all streams of the batch in vector lanes.
+Streams join and leave at any time, a joining stream starts from silence at the current time of its batch.
+Batches need a polyphase bank.
+*/
+class StreamEngine
+{
+public:
+    static constexpr u32 BatchSize = 16; //!< the streams of a batch, which are the lanes of the dot products
+    static constexpr u32 InvalidStream = 0xFFFFFFFFU;
+
+    /**
+    @brief Throughput of a batch since the last reset_statistics
+    */
+    struct Statistics
+    {
+        u32 srcFrequency_;
+        u32 dstFrequency_;
+        Resampler::Quality quality_;
+        u32 streams_; //!< the joined streams
+        u64 calls_; //!< the calls of process, which had a joined stream
+        u64 samples_; //!< the output samples of all joined streams
+        f64 seconds_;
+    };
+
+    StreamEngine();
+    StreamEngine(StreamEngine&& other);
+    ~StreamEngine();
+    StreamEngine& operator=(StreamEngine&& other);
+
+    /**
+    @brief Add a stream to a batch of the same ratio and quality, a new batch is created if all of them are full
+    @return the handle of the stream, InvalidStream if the ratio does not fit in a polyphase bank
+    */
+    u32 join(u32 srcFrequency, u32 dstFrequency, Resampler::Quality quality = Resampler::Quality::Best);
+
+    /**
+    @brief Remove a stream, its handle can be returned by a later join
+    */
+    void leave(u32 stream);
+
+    /**
+    @brief The size of arrays indexed by the handles of streams
+    */
+    u32 capacity() const;
+
+    /**
+    @brief The number of batches, a batch holds the handles [batch * BatchSize, (batch + 1) * BatchSize)
+    */
+    u32 batches() const;
+
+    /**
+    @brief The number of resamplers of distinct reduced ratios and qualities, which the batches share
+    */
+    u32 groups() const;
+
+    void statistics(Statistics& statistics, u32 batch) const;
+    void reset_statistics();
+
+    /**
+    @brief Consume srcFrames input frames of every joined stream and write their output frames
+    @param src ... the input of each handle, null is silence
+    @param dst ... the output of each handle, which holds dstCapacity frames, null discards it
+    @param dstFrames ... the number of output frames of each handle, which is the same for a batch
+
+    dstCapacity should hold srcFrames * dstFrequency / srcFrequency + 1 frames, so that the whole input is consumed.
+    */
+    void process(u32 srcFrames, const s16* const* src, s16* const* dst, u32 dstCapacity, u32* dstFrames);
+
+private:
+    StreamEngine(const StreamEngine&) = delete;
+    StreamEngine& operator=(const StreamEngine&) = delete;
+
+    struct Batch;
+    struct Group;
+
+    const Resampler* find(u32 srcFrequency, u32 dstFrequency, Resampler::Quality quality);
+
+    u32 batches_;
+    u32 allocated_; //!< the allocated pointers of batches
+    Batch** batch_;
+    u32 groups_;
+    u32 allocatedGroups_; //!< the allocated pointers of groups
+    Group** group_;
+};
+
+/**
+@brief Downsample by large ratios with half-band 2:1 stages followed by a fractional stage
+
+The planner halves the frequency while the result is not below the destination frequency,
+then the final stage resamples the rest of the ratio, which is in (1/2, 1].
+Each half-band stage has the shortest filter, which keeps aliases out of the passband of the final stage.
+Intermediate frames are f32 in buffers reused across calls, so a cascade is not shared by threads.
+*/
+class Cascade
+{
+public:
+    static constexpr u32 MaxStages = 16;
+
+    static Cascade initialize(u32 srcFrequency, u32 dstFrequency, Resampler::Quality quality = Resampler::Quality::Best);
+    static Cascade initialize(u32 srcFrequency, u32 dstFrequency, const FilterDesign& design);
+
+    Cascade();
+    Cascade(Cascade&& other);
+    ~Cascade();
+    Cascade& operator=(Cascade&& other);
+
+    bool valid() const;
+
+    /**
+    @brief The number of half-band stages, zero if the ratio is resampled by the final stage only
+    */
+    u32 stages() const;
+
+    /**
+    @brief The number of non-zero taps of a half-band stage
+    */
+    u32 taps(u32 stage) const;
+
+    /**
+    @brief The odd taps of the right half of a half-band stage, the center is 1/2 and the other even taps are zero
+    */
+    const f32* half_band(u32 stage) const;
+
+    /**
+    @brief The final fractional stage, its kernel is used by the half-band stages too
+    */
+    Resampler& resampler();
+    const Resampler& resampler() const;
+
+    /**
+    @brief The number of output frames for srcFrames input frames
+    */
+    u64 output_frames(u64 srcFrames) const;
+
+    /**
+    @brief Resample interleaved frames through all stages, same types as Resampler::run
+    */
+    template<class Dst, class Src>
+    u32 run(u32 channels, u32 dstSamples, Dst* dst, u32 srcSamples, const Src* src);
+
+private:
+    Cascade(const Cascade&) = delete;
+    Cascade& operator=(const Cascade&) = delete;
+
+    bool reserve(size_t size);
+
+    u32 stages_;
+    u32 lengths_[MaxStages]; //!< the number of odd taps in a half of each half-band filter
+    f32* taps_; //!< the odd taps of all half-band filters
+    size_t capacity_; //!< the number of floats of the intermediate buffer
+    f32* buffer_;
+    Resampler resampler_; //!< the final fractional stage
+};
+
+/**
+@brief A clip of a batch conversion, the last two members are written by BatchResampler::run
+*/
+template<class Dst, class Src>
+struct BatchJob
+{
+    const Src* src_; //!< interleaved frames
+    u32 srcFrames_;
+    u32 srcFrequency_;
+    u32 dstFrequency_;
+    u32 channels_;
+    u64 offset_; //!< the first sample of the output in the arena
+    u32 dstFrames_; //!< the output frames, zero if the ratio or the channels are not supported
+};
+
+/**
+@brief Resample many short clips of mixed ratios in one call
+
+Jobs of the same reduced ratio share a resampler, which is kept for later calls.
+The outputs are packed into one arena in the order of the jobs, each one is the same as Resampler::run of the clip.
+The jobs are dealt to threads from the longest one, a thread takes its longest job first, and steals the shortest one of another thread,
+when its own jobs are done, so that long and short clips balance.
+*/
+class BatchResampler
+{
+public:
+    static BatchResampler initialize(Resampler::Quality quality = Resampler::Quality::Best);
+
+    BatchResampler();
+    BatchResampler(BatchResampler&& other);
+    ~BatchResampler();
+    BatchResampler& operator=(BatchResampler&& other);
+
+    /**
+    @brief The number of resamplers of distinct reduced ratios
+    */
+    u32 groups() const;
+
+    /**
+    @brief The samples of an arena, which holds the outputs of all jobs
+    */
+    template<class Dst, class Src>
+    static u64 arena_samples(u32 count, const BatchJob<Dst, Src>* jobs);
+
+    /**
+    @brief Resample every job into the arena
+    @param threads ... the number of threads including the caller, zero for the hardware concurrency
+    @return the number of resampled jobs, zero if the arena is smaller than arena_samples
+    */
+    template<class Dst, class Src>
+    u32 run(u32 count, BatchJob<Dst, Src>* jobs, u64 arenaSamples, Dst* arena, u32 threads = 0);
+
+private:
+    BatchResampler(const BatchResampler&) = delete;
+    BatchResampler& operator=(const BatchResampler&) = delete;
+
+    struct Group;
+
+    const Resampler* find(u32 srcFrequency, u32 dstFrequency);
+
+    Resampler::Quality quality_;
+    u32 groups_;
+    u32 allocated_; //!< the allocated pointers of groups
+    Group** group_;
 };
 }
 #endif // INC_RESAMCPP_H_